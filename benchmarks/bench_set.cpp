@@ -0,0 +1,588 @@
+// Throughput of my_stl::Set against std::set, of IntervalSet overlap
+// queries against a linear scan of the same intervals, of parallel scans
+// by thread count, and of concurrent inserts into ShardedSet against a Set
+// behind one mutex, by thread count.
+//
+//   set_bench [--format=csv|json] [--min-size=N] [--max-size=N]
+//             [--repeat=N] [--filter=SUBSTRING]
+//
+// Sizes run in powers of ten from --min-size (default 1e3) to --max-size
+// (default 1e6; pass 1e8 for the full sweep). Every case runs --repeat
+// times and the fastest run is reported, one row per
+// (container, key, op, size), on stdout.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "interval_set.h"
+#include "my_set.h"
+#include "set_parallel.h"
+#include "sharded_set.h"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+namespace {
+
+// Same shape as the key in demo/main.cpp: user-defined copy and destructor,
+// compared only through operator<.
+struct StrangeInt {
+    int x;
+    static int counter;
+    StrangeInt() : x(0) { ++counter; }
+    explicit StrangeInt(int v) : x(v) { ++counter; }
+    StrangeInt(const StrangeInt& rs) : x(rs.x) { ++counter; }
+    StrangeInt& operator=(const StrangeInt& rs) {
+        x = rs.x;
+        return *this;
+    }
+    ~StrangeInt() { --counter; }
+    bool operator<(const StrangeInt& rs) const { return x < rs.x; }
+};
+int StrangeInt::counter;
+
+template <class Key>
+struct KeyTraits;
+
+template <>
+struct KeyTraits<int> {
+    static const char* Name() { return "int"; }
+    static int Make(std::uint64_t v) { return static_cast<int>(v); }
+};
+
+template <>
+struct KeyTraits<std::string> {
+    static const char* Name() { return "string"; }
+    // Shared prefix, as in URL- or identifier-like keys.
+    static std::string Make(std::uint64_t v) {
+        return "user:" + std::to_string(v * 2654435761u % 1000000007u) + ":" +
+               std::to_string(v);
+    }
+};
+
+template <>
+struct KeyTraits<std::pair<int, int>> {
+    static const char* Name() { return "pair<int,int>"; }
+    static std::pair<int, int> Make(std::uint64_t v) {
+        return {static_cast<int>(v >> 8), static_cast<int>(v & 0xff)};
+    }
+};
+
+template <>
+struct KeyTraits<StrangeInt> {
+    static const char* Name() { return "StrangeInt"; }
+    static StrangeInt Make(std::uint64_t v) {
+        return StrangeInt(static_cast<int>(v));
+    }
+};
+
+template <class Container>
+struct ContainerTraits;
+
+template <class Key>
+struct ContainerTraits<my_stl::Set<Key>> {
+    static const char* Name() { return "my_stl::Set"; }
+};
+
+template <class Key>
+struct ContainerTraits<
+    my_stl::Set<Key, my_rbt::stats::NullStats, my_rbt::augment::None, 0,
+                my_stl::filter::BlockedBloom<Key>>> {
+    static const char* Name() { return "my_stl::Set+bloom"; }
+};
+
+template <class Key>
+struct ContainerTraits<
+    my_stl::Set<Key, my_rbt::stats::NullStats, my_rbt::augment::None, 0,
+                my_stl::filter::None, false, my_rbt::balance::Avl>> {
+    static const char* Name() { return "my_stl::Set+avl"; }
+};
+
+template <class Key>
+struct ContainerTraits<
+    my_stl::Set<Key, my_rbt::stats::NullStats, my_rbt::augment::None, 0,
+                my_stl::filter::None, false, my_rbt::balance::Wavl>> {
+    static const char* Name() { return "my_stl::Set+wavl"; }
+};
+
+template <class Key>
+struct ContainerTraits<std::set<Key>> {
+    static const char* Name() { return "std::set"; }
+};
+
+struct Options {
+    std::string format = "csv";
+    std::uint64_t min_size = 1000;
+    std::uint64_t max_size = 1000000;
+    int repeat = 3;
+    std::string filter;
+};
+
+struct Result {
+    std::string container;
+    std::string key;
+    std::string op;
+    std::uint64_t size;
+    std::uint64_t ops;
+    std::int64_t ns;
+};
+
+class Reporter {
+   public:
+    explicit Reporter(const Options& options) : options_(options), rows_(0) {
+        if (options_.format == "json") {
+            std::cout << "{\"version\": \"" << BENCH_VERSION
+                      << "\", \"results\": [\n";
+        } else {
+            std::cout << "version,container,key,op,size,ops,total_ns,"
+                         "ns_per_op\n";
+        }
+    }
+
+    ~Reporter() {
+        if (options_.format == "json") std::cout << "\n]}\n";
+        std::cout.flush();
+    }
+
+    void Add(const Result& r) {
+        double per_op = r.ops ? static_cast<double>(r.ns) / r.ops : 0.0;
+        if (options_.format == "json") {
+            std::cout << (rows_ ? ",\n" : "") << "  {\"container\": \""
+                      << r.container << "\", \"key\": \"" << r.key
+                      << "\", \"op\": \"" << r.op << "\", \"size\": " << r.size
+                      << ", \"ops\": " << r.ops << ", \"total_ns\": " << r.ns
+                      << ", \"ns_per_op\": " << per_op << "}";
+        } else {
+            std::cout << BENCH_VERSION << ',' << r.container << ',' << r.key
+                      << ',' << r.op << ',' << r.size << ',' << r.ops << ','
+                      << r.ns << ',' << per_op << '\n';
+        }
+        ++rows_;
+    }
+
+   private:
+    const Options& options_;
+    std::uint64_t rows_;
+};
+
+// Keeps results observable so the optimiser cannot drop the work.
+std::uint64_t g_sink = 0;
+
+template <class Fn>
+std::int64_t TimeNs(Fn&& fn) {
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+        .count();
+}
+
+template <class Container, class Key>
+class Suite {
+   public:
+    Suite(const Options& options, Reporter& reporter, std::uint64_t n)
+        : options_(options), reporter_(reporter), n_(n) {
+        std::mt19937_64 rng(n);
+        // Present keys are odd, so their even neighbours are misses.
+        std::vector<std::uint64_t> ids(n);
+        std::iota(ids.begin(), ids.end(), 0);
+        std::shuffle(ids.begin(), ids.end(), rng);
+        for (std::uint64_t id : ids) {
+            random_.push_back(KeyTraits<Key>::Make(2 * id + 1));
+            missing_.push_back(KeyTraits<Key>::Make(2 * id));
+        }
+        std::uint64_t distinct = std::max<std::uint64_t>(n / 16, 1);
+        for (std::uint64_t i = 0; i < n; ++i) {
+            std::uint64_t id = rng() % distinct;
+            duplicates_.push_back(KeyTraits<Key>::Make(2 * id + 1));
+        }
+        sorted_ = random_;
+        std::sort(sorted_.begin(), sorted_.end());
+    }
+
+    void Run() {
+        Measure("insert_random", n_, [this] {
+            Container s;
+            for (const Key& k : random_) s.insert(k);
+            g_sink += s.size();
+        });
+        Measure("insert_sorted", n_, [this] {
+            Container s;
+            for (const Key& k : sorted_) s.insert(k);
+            g_sink += s.size();
+        });
+        Measure("insert_duplicates", n_, [this] {
+            Container s;
+            for (const Key& k : duplicates_) s.insert(k);
+            g_sink += s.size();
+        });
+
+        Container full;
+        for (const Key& k : random_) full.insert(k);
+
+        Measure("find_hit", n_, [this, &full] {
+            for (const Key& k : random_) g_sink += full.find(k) != full.end();
+        });
+        Measure("find_miss", n_, [this, &full] {
+            for (const Key& k : missing_) g_sink += full.find(k) != full.end();
+        });
+        Measure("lower_bound", n_, [this, &full] {
+            for (const Key& k : missing_) {
+                g_sink += full.lower_bound(k) != full.end();
+            }
+        });
+        Measure("iterate", n_, [&full] {
+            std::uint64_t count = 0;
+            for (auto it = full.begin(); it != full.end(); ++it) ++count;
+            g_sink += count;
+        });
+        Measure("copy", n_, [&full] {
+            Container copy(full);
+            g_sink += copy.size();
+        });
+        MeasureWithSetup("destroy", n_, [&full](std::optional<Container>& s) {
+            s.emplace(full);
+        }, [](std::optional<Container>& s) { s.reset(); });
+        MeasureWithSetup("erase", n_, [&full](std::optional<Container>& s) {
+            s.emplace(full);
+        }, [this](std::optional<Container>& s) {
+            for (const Key& k : random_) g_sink += s->erase(k);
+        });
+    }
+
+   private:
+    bool Selected(const std::string& op) const {
+        if (options_.filter.empty()) return true;
+        std::string name = std::string(ContainerTraits<Container>::Name()) +
+                           "/" + KeyTraits<Key>::Name() + "/" + op;
+        return name.find(options_.filter) != std::string::npos;
+    }
+
+    template <class Fn>
+    void Measure(const char* op, std::uint64_t ops, Fn&& fn) {
+        if (!Selected(op)) return;
+        std::int64_t best = -1;
+        for (int i = 0; i < options_.repeat; ++i) {
+            std::int64_t ns = TimeNs(fn);
+            if (best < 0 || ns < best) best = ns;
+        }
+        Report(op, ops, best);
+    }
+
+    template <class Setup, class Fn>
+    void MeasureWithSetup(const char* op, std::uint64_t ops, Setup&& setup,
+                          Fn&& fn) {
+        if (!Selected(op)) return;
+        std::int64_t best = -1;
+        for (int i = 0; i < options_.repeat; ++i) {
+            std::optional<Container> s;
+            setup(s);
+            std::int64_t ns = TimeNs([&] { fn(s); });
+            if (best < 0 || ns < best) best = ns;
+        }
+        Report(op, ops, best);
+    }
+
+    void Report(const char* op, std::uint64_t ops, std::int64_t ns) {
+        reporter_.Add(Result{ContainerTraits<Container>::Name(),
+                             KeyTraits<Key>::Name(), op, n_, ops, ns});
+    }
+
+    const Options& options_;
+    Reporter& reporter_;
+    std::uint64_t n_;
+    std::vector<Key> random_;
+    std::vector<Key> sorted_;
+    std::vector<Key> missing_;
+    std::vector<Key> duplicates_;
+};
+
+template <class Key>
+void RunKey(const Options& options, Reporter& reporter) {
+    for (std::uint64_t n = options.min_size; n <= options.max_size; n *= 10) {
+        Suite<my_stl::Set<Key>, Key>(options, reporter, n).Run();
+        if constexpr (requires(const Key& key) { std::hash<Key>()(key); }) {
+            typedef my_stl::Set<Key, my_rbt::stats::NullStats,
+                                my_rbt::augment::None, 0,
+                                my_stl::filter::BlockedBloom<Key>>
+                BloomSet;
+            Suite<BloomSet, Key>(options, reporter, n).Run();
+        }
+        typedef my_stl::Set<Key, my_rbt::stats::NullStats,
+                            my_rbt::augment::None, 0, my_stl::filter::None,
+                            false, my_rbt::balance::Avl>
+            AvlSet;
+        typedef my_stl::Set<Key, my_rbt::stats::NullStats,
+                            my_rbt::augment::None, 0, my_stl::filter::None,
+                            false, my_rbt::balance::Wavl>
+            WavlSet;
+        Suite<AvlSet, Key>(options, reporter, n).Run();
+        Suite<WavlSet, Key>(options, reporter, n).Run();
+        Suite<std::set<Key>, Key>(options, reporter, n).Run();
+    }
+}
+
+// Time windows of mixed length over a 1e9-wide axis; each query is answered
+// by IntervalSet and by scanning every window.
+class IntervalSuite {
+   public:
+    typedef std::pair<std::int64_t, std::int64_t> Interval;
+
+    IntervalSuite(const Options& options, Reporter& reporter, std::uint64_t n)
+        : options_(options), reporter_(reporter), n_(n) {
+        std::mt19937_64 rng(n);
+        const std::int64_t axis = 1000000000;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            std::int64_t start = static_cast<std::int64_t>(rng() % axis);
+            std::uint64_t max_length = i % 64 == 0 ? 1000000 : 2000;
+            std::int64_t length = static_cast<std::int64_t>(rng() % max_length);
+            intervals_.push_back({start, start + length});
+        }
+        for (std::uint64_t i = 0; i < kQueries; ++i) {
+            std::int64_t lo = static_cast<std::int64_t>(rng() % axis);
+            std::int64_t width = static_cast<std::int64_t>(rng() % 500);
+            queries_.push_back({lo, lo + width});
+        }
+    }
+
+    void Run() {
+        my_stl::IntervalSet<std::int64_t> set;
+        Measure("my_stl::IntervalSet", "insert", n_, [this, &set] {
+            set.clear();
+            for (const Interval& i : intervals_) set.insert(i);
+            g_sink += set.size();
+        });
+        Measure("my_stl::IntervalSet", "overlap_point", kQueries, [&] {
+            for (const Interval& q : queries_) {
+                g_sink += set.overlapping(q.first).size();
+            }
+        });
+        Measure("my_stl::IntervalSet", "overlap_range", kQueries, [&] {
+            for (const Interval& q : queries_) {
+                g_sink += set.overlapping(q.first, q.second).size();
+            }
+        });
+        Measure("my_stl::IntervalSet", "any_overlap", kQueries, [&] {
+            for (const Interval& q : queries_) {
+                g_sink += set.any_overlap(q.first, q.second);
+            }
+        });
+
+        Measure("linear_scan", "overlap_point", kQueries, [this] {
+            for (const Interval& q : queries_) g_sink += Scan(q.first, q.first);
+        });
+        Measure("linear_scan", "overlap_range", kQueries, [this] {
+            for (const Interval& q : queries_) {
+                g_sink += Scan(q.first, q.second);
+            }
+        });
+    }
+
+   private:
+    static constexpr std::uint64_t kQueries = 1000;
+
+    std::uint64_t Scan(std::int64_t lo, std::int64_t hi) const {
+        std::uint64_t count = 0;
+        for (const Interval& i : intervals_) {
+            count += i.first <= hi && lo <= i.second;
+        }
+        return count;
+    }
+
+    template <class Fn>
+    void Measure(const char* container, const char* op, std::uint64_t ops,
+                 Fn&& fn) {
+        std::string name = std::string(container) + "/interval<int64>/" + op;
+        if (!options_.filter.empty() &&
+            name.find(options_.filter) == std::string::npos) {
+            return;
+        }
+        std::int64_t best = -1;
+        for (int i = 0; i < options_.repeat; ++i) {
+            std::int64_t ns = TimeNs(fn);
+            if (best < 0 || ns < best) best = ns;
+        }
+        reporter_.Add(Result{container, "interval<int64>", op, n_, ops, best});
+    }
+
+    const Options& options_;
+    Reporter& reporter_;
+    std::uint64_t n_;
+    std::vector<Interval> intervals_;
+    std::vector<Interval> queries_;
+};
+
+void RunIntervals(const Options& options, Reporter& reporter) {
+    for (std::uint64_t n = options.min_size; n <= options.max_size; n *= 10) {
+        IntervalSuite(options, reporter, n).Run();
+    }
+}
+
+// Summing every key with a serial walk and with parallel_reduce on 1, 2,
+// 4, ... up to the hardware's threads.
+void RunParallel(const Options& options, Reporter& reporter) {
+    struct Sum {
+        typedef std::uint64_t value_type;
+        static std::uint64_t Identity() { return 0; }
+        static std::uint64_t Of(int key) { return key; }
+        static std::uint64_t Combine(std::uint64_t a, std::uint64_t b) {
+            return a + b;
+        }
+    };
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    for (std::uint64_t n = options.min_size; n <= options.max_size; n *= 10) {
+        my_stl::Set<int> set;
+        std::mt19937 rng(static_cast<unsigned>(n));
+        while (set.size() < n) set.insert(static_cast<int>(rng()));
+
+        auto measure = [&](const std::string& op, auto&& fn) {
+            std::string name = "my_stl::Set/int/" + op;
+            if (!options.filter.empty() &&
+                name.find(options.filter) == std::string::npos) {
+                return;
+            }
+            std::int64_t best = -1;
+            for (int i = 0; i < options.repeat; ++i) {
+                std::int64_t ns = TimeNs(fn);
+                if (best < 0 || ns < best) best = ns;
+            }
+            reporter.Add(Result{"my_stl::Set", "int", op, n, n, best});
+        };
+        measure("serial_sum", [&set] {
+            std::uint64_t sum = 0;
+            for (int key : set) sum += static_cast<unsigned>(key);
+            g_sink += sum;
+        });
+        for (unsigned threads = 1;; threads = std::min(threads * 2, hardware)) {
+            my_stl::parallel::Options parallel;
+            parallel.threads = threads;
+            measure("parallel_sum_t" + std::to_string(threads), [&] {
+                g_sink += my_stl::parallel_reduce<Sum>(set, parallel);
+            });
+            if (threads == hardware) break;
+        }
+    }
+}
+
+// Inserting n random keys from 1, 2, 4, ... up to the hardware's threads,
+// each taking every threads-th key, into a ShardedSet and into a Set behind
+// a single mutex.
+void RunConcurrent(const Options& options, Reporter& reporter) {
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    for (std::uint64_t n = options.min_size; n <= options.max_size; n *= 10) {
+        std::vector<int> keys(n);
+        std::mt19937 rng(static_cast<unsigned>(n));
+        for (int& key : keys) key = static_cast<int>(rng());
+
+        auto measure = [&](const char* container, unsigned threads,
+                           auto&& insert) {
+            std::string op = "insert_t" + std::to_string(threads);
+            std::string name = std::string(container) + "/int/" + op;
+            if (!options.filter.empty() &&
+                name.find(options.filter) == std::string::npos) {
+                return;
+            }
+            std::int64_t best = -1;
+            for (int i = 0; i < options.repeat; ++i) {
+                std::int64_t ns = TimeNs([&] { insert(threads); });
+                if (best < 0 || ns < best) best = ns;
+            }
+            reporter.Add(Result{container, "int", op, n, n, best});
+        };
+        auto run = [&keys](unsigned threads, auto&& insert) {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([&keys, &insert, t, threads] {
+                    for (std::size_t i = t; i < keys.size(); i += threads) {
+                        insert(keys[i]);
+                    }
+                });
+            }
+            for (std::thread& worker : workers) worker.join();
+        };
+        for (unsigned threads = 1;; threads = std::min(threads * 2, hardware)) {
+            measure("my_stl::ShardedSet", threads, [&](unsigned count) {
+                my_stl::ShardedSet<int> set;
+                run(count, [&set](int key) { set.insert(key); });
+                g_sink += set.size();
+            });
+            measure("locked_set", threads, [&](unsigned count) {
+                my_stl::Set<int> set;
+                std::mutex mutex;
+                run(count, [&set, &mutex](int key) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    set.insert(key);
+                });
+                g_sink += set.size();
+            });
+            if (threads == hardware) break;
+        }
+    }
+}
+
+std::uint64_t ParseSize(const std::string& text) {
+    return static_cast<std::uint64_t>(std::stod(text));
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* prefix) -> std::optional<std::string> {
+            std::string p(prefix);
+            if (arg.compare(0, p.size(), p) != 0) return std::nullopt;
+            return arg.substr(p.size());
+        };
+        if (auto v = value("--format=")) {
+            options.format = *v;
+        } else if (auto v = value("--min-size=")) {
+            options.min_size = ParseSize(*v);
+        } else if (auto v = value("--max-size=")) {
+            options.max_size = ParseSize(*v);
+        } else if (auto v = value("--repeat=")) {
+            options.repeat = std::max(1, std::stoi(*v));
+        } else if (auto v = value("--filter=")) {
+            options.filter = *v;
+        } else {
+            std::cerr << "unknown option " << arg << "\n";
+            std::exit(2);
+        }
+    }
+    if (options.format != "csv" && options.format != "json") {
+        std::cerr << "--format must be csv or json\n";
+        std::exit(2);
+    }
+    options.min_size = std::max<std::uint64_t>(options.min_size, 1);
+    return options;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options = ParseOptions(argc, argv);
+    {
+        Reporter reporter(options);
+        RunKey<int>(options, reporter);
+        RunKey<std::string>(options, reporter);
+        RunKey<std::pair<int, int>>(options, reporter);
+        RunKey<StrangeInt>(options, reporter);
+        RunIntervals(options, reporter);
+        RunParallel(options, reporter);
+        RunConcurrent(options, reporter);
+    }
+    std::cerr << "checksum " << g_sink << "\n";
+    return 0;
+}
@@ -0,0 +1,433 @@
+// Replays a workload file written by my_stl::RecordingSet against one or
+// more set implementations.
+//
+//   set_replay WORKLOAD [--backend=NAME[,NAME...]] [--format=csv|json]
+//              [--repeat=N]
+//
+// Backends:
+//   set      my_stl::Set
+//   buffered my_stl::BufferedSet; inserts and erases are logged and
+//            merged at the next read.
+//   sharded  my_stl::ShardedSet, replayed from one thread: the cost of
+//            its locks and shard lookup over set.
+//   std_set  std::set
+//   mapped   my_stl::MappedSet holding every key the workload inserts;
+//            read-only, so only find and lower_bound are replayed.
+//            Trivially copyable keys only.
+//   roaring  my_stl::RoaringSet; uint32 keys only.
+//   packed   my_stl::PackedSet; unsigned integer keys only.
+// All backends run by default. The workload is loaded into memory first.
+// Each backend replays it --repeat times untimed per operation, and the
+// fastest run gives the throughput row ("all"). One more run times every
+// operation into a histogram, which gives one latency row per op.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "buffered_set.h"
+#include "mapped_set.h"
+#include "my_set.h"
+#include "packed_set.h"
+#include "roaring_set.h"
+#include "set_codec.h"
+#include "set_trace.h"
+#include "set_workload.h"
+#include "sharded_set.h"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+namespace {
+
+using my_stl::trace::Op;
+
+struct Options {
+    std::string path;
+    std::string backends;
+    std::string format = "csv";
+    int repeat = 3;
+
+    bool Selected(const std::string& name) const {
+        if (backends.empty()) return true;
+        std::stringstream list(backends);
+        for (std::string item; std::getline(list, item, ',');) {
+            if (item == name) return true;
+        }
+        return false;
+    }
+};
+
+struct Result {
+    std::string backend;
+    std::string op;
+    std::uint64_t count;
+    double ns_per_op;
+    std::uint64_t p50;
+    std::uint64_t p99;
+    std::uint64_t p999;
+    std::uint64_t max;
+};
+
+class Reporter {
+   public:
+    Reporter(const Options& options, const std::string& key)
+        : options_(options), key_(key), rows_(0) {
+        if (options_.format == "json") {
+            std::cout << "{\"version\": \"" << BENCH_VERSION
+                      << "\", \"key\": \"" << key_ << "\", \"results\": [\n";
+        } else {
+            std::cout << "version,key,backend,op,count,ns_per_op,ops_per_sec,"
+                         "p50_ns,p99_ns,p999_ns,max_ns\n";
+        }
+    }
+
+    ~Reporter() {
+        if (options_.format == "json") std::cout << "\n]}\n";
+        std::cout.flush();
+    }
+
+    void Add(const Result& r) {
+        double per_sec = r.ns_per_op > 0 ? 1e9 / r.ns_per_op : 0.0;
+        if (options_.format == "json") {
+            std::cout << (rows_ ? ",\n" : "") << "  {\"backend\": \""
+                      << r.backend << "\", \"op\": \"" << r.op
+                      << "\", \"count\": " << r.count
+                      << ", \"ns_per_op\": " << r.ns_per_op
+                      << ", \"ops_per_sec\": " << per_sec
+                      << ", \"p50_ns\": " << r.p50 << ", \"p99_ns\": " << r.p99
+                      << ", \"p999_ns\": " << r.p999
+                      << ", \"max_ns\": " << r.max << "}";
+        } else {
+            std::cout << BENCH_VERSION << ',' << key_ << ',' << r.backend
+                      << ',' << r.op << ',' << r.count << ',' << r.ns_per_op
+                      << ',' << per_sec << ',' << r.p50 << ',' << r.p99 << ','
+                      << r.p999 << ',' << r.max << '\n';
+        }
+        ++rows_;
+    }
+
+   private:
+    const Options& options_;
+    std::string key_;
+    std::uint64_t rows_;
+};
+
+// Keeps results observable so the optimiser cannot drop the work.
+std::uint64_t g_sink = 0;
+
+template <class Key>
+using Workload = std::vector<my_stl::io::WorkloadRecord<Key>>;
+
+// Read-write containers with the std::set interface.
+template <class Container>
+struct Engine {
+    template <class Key>
+    static void Prepare(std::optional<Container>& c, const Workload<Key>&) {
+        c.emplace();
+    }
+
+    // False if the backend cannot replay this kind of operation.
+    template <class Key>
+    static bool Apply(Container& c, const my_stl::io::WorkloadRecord<Key>& r) {
+        switch (r.op_) {
+            case Op::kInsert:
+                g_sink += c.insert(r.key_).second;
+                break;
+            case Op::kErase:
+                g_sink += c.erase(r.key_);
+                break;
+            case Op::kFind:
+                g_sink += c.find(r.key_) != c.end();
+                break;
+            case Op::kLowerBound:
+                g_sink += c.lower_bound(r.key_) != c.end();
+                break;
+            case Op::kClear:
+                c.clear();
+                break;
+            case Op::kCopy: {
+                Container copy(c);
+                g_sink += copy.size();
+                break;
+            }
+        }
+        return true;
+    }
+};
+
+template <class Key>
+struct Engine<my_stl::MappedSet<Key>> {
+    static void Prepare(std::optional<my_stl::MappedSet<Key>>& c,
+                        const Workload<Key>& workload) {
+        std::set<Key> keys;
+        for (const auto& r : workload) {
+            if (r.op_ == Op::kInsert) keys.insert(r.key_);
+        }
+        std::string path =
+            (std::filesystem::temp_directory_path() /
+             ("set_replay_" + std::to_string(::getpid()) + ".bin"))
+                .string();
+        {
+            std::ofstream out(path, std::ios::binary);
+            my_stl::MappedSet<Key>::write(out, keys.begin(), keys.end());
+        }
+        c.emplace(path);
+        // The mapping keeps the data alive.
+        std::filesystem::remove(path);
+    }
+
+    static bool Apply(const my_stl::MappedSet<Key>& c,
+                      const my_stl::io::WorkloadRecord<Key>& r) {
+        switch (r.op_) {
+            case Op::kFind:
+                g_sink += c.find(r.key_) != c.end();
+                return true;
+            case Op::kLowerBound:
+                g_sink += c.lower_bound(r.key_) != c.end();
+                return true;
+            default:
+                return false;
+        }
+    }
+};
+
+// Inserts and erases are logged without an answer, so nothing is summed.
+template <class Key>
+struct Engine<my_stl::BufferedSet<Key>> {
+    static void Prepare(std::optional<my_stl::BufferedSet<Key>>& c,
+                        const Workload<Key>&) {
+        c.emplace();
+    }
+
+    static bool Apply(my_stl::BufferedSet<Key>& c,
+                      const my_stl::io::WorkloadRecord<Key>& r) {
+        switch (r.op_) {
+            case Op::kInsert:
+                c.insert(r.key_);
+                break;
+            case Op::kErase:
+                c.erase(r.key_);
+                break;
+            case Op::kFind:
+                g_sink += c.find(r.key_) != c.end();
+                break;
+            case Op::kLowerBound:
+                g_sink += c.lower_bound(r.key_) != c.end();
+                break;
+            case Op::kClear:
+                c.clear();
+                break;
+            case Op::kCopy: {
+                my_stl::BufferedSet<Key> copy(c);
+                g_sink += copy.size();
+                break;
+            }
+        }
+        return true;
+    }
+};
+
+template <class Key>
+struct Engine<my_stl::ShardedSet<Key>> {
+    static void Prepare(std::optional<my_stl::ShardedSet<Key>>& c,
+                        const Workload<Key>&) {
+        c.emplace();
+    }
+
+    static bool Apply(my_stl::ShardedSet<Key>& c,
+                      const my_stl::io::WorkloadRecord<Key>& r) {
+        switch (r.op_) {
+            case Op::kInsert:
+                g_sink += c.insert(r.key_);
+                break;
+            case Op::kErase:
+                g_sink += c.erase(r.key_);
+                break;
+            case Op::kFind:
+                g_sink += c.contains(r.key_);
+                break;
+            case Op::kLowerBound:
+                g_sink += c.lower_bound(r.key_) != c.end();
+                break;
+            case Op::kClear:
+                c.clear();
+                break;
+            case Op::kCopy: {
+                my_stl::ShardedSet<Key> copy(c);
+                g_sink += copy.size();
+                break;
+            }
+        }
+        return true;
+    }
+};
+
+template <class Container, class Key>
+void Run(const char* name, const Workload<Key>& workload,
+         const Options& options, Reporter& reporter) {
+    typedef Engine<Container> E;
+    if (!options.Selected(name)) return;
+
+    std::int64_t best = -1;
+    std::uint64_t applied = 0;
+    for (int i = 0; i < options.repeat; ++i) {
+        std::optional<Container> c;
+        E::Prepare(c, workload);
+        applied = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (const auto& r : workload) applied += E::Apply(*c, r);
+        auto t1 = std::chrono::steady_clock::now();
+        std::int64_t ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+                .count();
+        if (best < 0 || ns < best) best = ns;
+    }
+
+    std::array<my_stl::trace::Histogram, my_stl::trace::kOpCount> latency;
+    my_stl::trace::Histogram all;
+    std::optional<Container> c;
+    E::Prepare(c, workload);
+    for (const auto& r : workload) {
+        auto t0 = std::chrono::steady_clock::now();
+        bool done = E::Apply(*c, r);
+        auto t1 = std::chrono::steady_clock::now();
+        if (!done) continue;
+        std::uint64_t ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+                .count());
+        latency[static_cast<std::size_t>(r.op_)].Record(ns);
+        all.Record(ns);
+    }
+
+    auto report = [&](const char* op, const my_stl::trace::Histogram& h,
+                      double ns_per_op) {
+        reporter.Add(Result{name, op, h.Count(), ns_per_op,
+                            h.Percentile(0.5), h.Percentile(0.99),
+                            h.Percentile(0.999), h.Max()});
+    };
+    report("all", all,
+           applied ? static_cast<double>(best) / static_cast<double>(applied)
+                   : 0.0);
+    for (std::size_t i = 0; i < my_stl::trace::kOpCount; ++i) {
+        const my_stl::trace::Histogram& h = latency[i];
+        if (h.Count() == 0) continue;
+        report(my_stl::trace::OpName(static_cast<Op>(i)), h,
+               static_cast<double>(h.Sum()) / static_cast<double>(h.Count()));
+    }
+}
+
+template <class Key>
+void ReplayKey(std::istream& is, const char* key_name,
+               const Options& options) {
+    Workload<Key> workload;
+    my_stl::io::WorkloadReader<Key> reader(is);
+    for (my_stl::io::WorkloadRecord<Key> r{}; reader.Next(r);) {
+        workload.push_back(r);
+    }
+    if (reader.Truncated()) {
+        std::cerr << options.path << ": file ends inside a block; replaying "
+                  << "the " << workload.size() << " records before it\n";
+    }
+
+    Reporter reporter(options, key_name);
+    Run<my_stl::Set<Key>>("set", workload, options, reporter);
+    Run<my_stl::BufferedSet<Key>>("buffered", workload, options, reporter);
+    Run<my_stl::ShardedSet<Key>>("sharded", workload, options, reporter);
+    Run<std::set<Key>>("std_set", workload, options, reporter);
+    if constexpr (std::is_trivially_copyable_v<Key>) {
+        Run<my_stl::MappedSet<Key>>("mapped", workload, options, reporter);
+    }
+    if constexpr (std::is_unsigned_v<Key> && sizeof(Key) <= 4) {
+        Run<my_stl::RoaringSet<Key>>("roaring", workload, options, reporter);
+    }
+    if constexpr (std::is_unsigned_v<Key>) {
+        Run<my_stl::PackedSet<Key>>("packed", workload, options, reporter);
+    }
+}
+
+template <class Key>
+bool TryKey(std::uint32_t tag, std::istream& is, const char* key_name,
+            const Options& options) {
+    if (tag != my_stl::io::Codec<Key>::kTag) return false;
+    ReplayKey<Key>(is, key_name, options);
+    return true;
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* prefix) -> std::optional<std::string> {
+            std::string p(prefix);
+            if (arg.compare(0, p.size(), p) != 0) return std::nullopt;
+            return arg.substr(p.size());
+        };
+        if (auto v = value("--backend=")) {
+            options.backends = *v;
+        } else if (auto v = value("--format=")) {
+            options.format = *v;
+        } else if (auto v = value("--repeat=")) {
+            options.repeat = std::max(1, std::stoi(*v));
+        } else if (arg.compare(0, 2, "--") != 0 && options.path.empty()) {
+            options.path = arg;
+        } else {
+            std::cerr << "unknown option " << arg << "\n";
+            std::exit(2);
+        }
+    }
+    if (options.path.empty()) {
+        std::cerr << "usage: set_replay WORKLOAD [--backend=NAME[,NAME...]] "
+                     "[--format=csv|json] [--repeat=N]\n";
+        std::exit(2);
+    }
+    if (options.format != "csv" && options.format != "json") {
+        std::cerr << "--format must be csv or json\n";
+        std::exit(2);
+    }
+    return options;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options = ParseOptions(argc, argv);
+    std::ifstream in(options.path, std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open " << options.path << "\n";
+        return 1;
+    }
+
+    try {
+        my_stl::io::WorkloadHeader header =
+            my_stl::io::ReadWorkloadHeader(in);
+        in.seekg(0);
+        std::uint32_t tag = header.key_tag_;
+        if (!TryKey<std::int32_t>(tag, in, "int32", options) &&
+            !TryKey<std::int64_t>(tag, in, "int64", options) &&
+            !TryKey<std::uint32_t>(tag, in, "uint32", options) &&
+            !TryKey<std::uint64_t>(tag, in, "uint64", options) &&
+            !TryKey<double>(tag, in, "double", options) &&
+            !TryKey<std::string>(tag, in, "string", options)) {
+            std::cerr << "unsupported key type in " << options.path << "\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << options.path << ": " << e.what() << "\n";
+        return 1;
+    }
+    std::cerr << "checksum " << g_sink << "\n";
+    return 0;
+}
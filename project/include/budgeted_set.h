@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "my_set.h"
+#include "set_memory.h"
+
+namespace my_stl {
+
+// Set whose nodes and key heap memory are charged to a memory::Budget,
+// which may be its own or shared with other containers. A key costs
+// Set::key_footprint<Allocator>, charged before it is inserted and
+// released when it is erased; the set object itself is not charged.
+//
+// When an insert or a copy would exceed the budget, the evict callback,
+// if any, is called with the bytes needed. It may free memory, e.g. by
+// erasing keys from this set or from others sharing the budget, and
+// returns true to have the charge retried or false to give up. Giving up,
+// or having no callback, fails fast: memory::BudgetExceeded is thrown and
+// the set is unchanged. A null budget charges nothing.
+template <class Key, class Stats = my_rbt::stats::NullStats,
+          class Allocator = memory::Malloc>
+class BudgetedSet {
+   public:
+    typedef Set<Key, Stats> set_type;
+    typedef typename set_type::key_type key_type;
+    typedef typename set_type::iterator iterator;
+    typedef typename set_type::const_iterator const_iterator;
+    typedef std::function<bool(std::size_t)> evict_type;
+
+    explicit BudgetedSet(memory::Budget* budget, evict_type evict = nullptr);
+    // The copy charges the same budget and shares the callback.
+    BudgetedSet(const BudgetedSet& other);
+    BudgetedSet& operator=(const BudgetedSet& other);
+    ~BudgetedSet();
+
+    memory::Budget* budget() const;
+    void set_evict(evict_type evict);
+    // Bytes this set has charged to the budget.
+    std::size_t charged() const;
+    // The underlying set, for operations that do not allocate.
+    const set_type& get() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+    std::pair<const_iterator, bool> insert(const key_type&);
+    void erase(iterator);
+    size_t erase(const key_type&);
+    void clear();
+
+    const_iterator find(const key_type&) const;
+    bool contains(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+    memory::Usage memory_usage() const;
+
+   private:
+    // Charges bytes, evicting as long as the callback makes progress;
+    // throws memory::BudgetExceeded otherwise.
+    void Charge(std::size_t bytes);
+    void Release(std::size_t bytes);
+    // The set's cost, as charged for a copy of it.
+    static std::size_t Cost(const set_type& set);
+
+    set_type set_;
+    memory::Budget* budget_;
+    evict_type evict_;
+    std::size_t charged_;
+};
+
+template <class Key, class Stats, class Allocator>
+BudgetedSet<Key, Stats, Allocator>::BudgetedSet(memory::Budget* budget,
+                                                evict_type evict)
+    : set_(), budget_{budget}, evict_(std::move(evict)), charged_{0} {}
+
+template <class Key, class Stats, class Allocator>
+BudgetedSet<Key, Stats, Allocator>::BudgetedSet(const BudgetedSet& other)
+    : set_(), budget_{other.budget_}, evict_(other.evict_), charged_{0} {
+    std::size_t cost = Cost(other.set_);
+    Charge(cost);
+    try {
+        set_ = other.set_;
+    } catch (...) {
+        Release(cost);
+        throw;
+    }
+    charged_ = cost;
+}
+
+template <class Key, class Stats, class Allocator>
+BudgetedSet<Key, Stats, Allocator>& BudgetedSet<Key, Stats, Allocator>::
+operator=(const BudgetedSet& other) {
+    if (this == &other) return *this;
+    // Both copies exist for a moment, so the new one is charged first.
+    std::size_t cost = Cost(other.set_);
+    Charge(cost);
+    try {
+        set_ = other.set_;
+    } catch (...) {
+        Release(cost);
+        throw;
+    }
+    Release(charged_);
+    charged_ = cost;
+    return *this;
+}
+
+template <class Key, class Stats, class Allocator>
+BudgetedSet<Key, Stats, Allocator>::~BudgetedSet() {
+    Release(charged_);
+}
+
+template <class Key, class Stats, class Allocator>
+memory::Budget* BudgetedSet<Key, Stats, Allocator>::budget() const {
+    return budget_;
+}
+
+template <class Key, class Stats, class Allocator>
+void BudgetedSet<Key, Stats, Allocator>::set_evict(evict_type evict) {
+    evict_ = std::move(evict);
+}
+
+template <class Key, class Stats, class Allocator>
+std::size_t BudgetedSet<Key, Stats, Allocator>::charged() const {
+    return charged_;
+}
+
+template <class Key, class Stats, class Allocator>
+const typename BudgetedSet<Key, Stats, Allocator>::set_type&
+BudgetedSet<Key, Stats, Allocator>::get() const {
+    return set_;
+}
+
+template <class Key, class Stats, class Allocator>
+typename BudgetedSet<Key, Stats, Allocator>::const_iterator
+BudgetedSet<Key, Stats, Allocator>::begin() const {
+    return set_.begin();
+}
+
+template <class Key, class Stats, class Allocator>
+typename BudgetedSet<Key, Stats, Allocator>::const_iterator
+BudgetedSet<Key, Stats, Allocator>::end() const {
+    return set_.end();
+}
+
+template <class Key, class Stats, class Allocator>
+size_t BudgetedSet<Key, Stats, Allocator>::size() const {
+    return set_.size();
+}
+
+template <class Key, class Stats, class Allocator>
+bool BudgetedSet<Key, Stats, Allocator>::empty() const {
+    return set_.empty();
+}
+
+template <class Key, class Stats, class Allocator>
+std::pair<typename BudgetedSet<Key, Stats, Allocator>::const_iterator, bool>
+BudgetedSet<Key, Stats, Allocator>::insert(const key_type& key) {
+    const_iterator it = set_.find(key);
+    if (it != set_.end()) return std::pair<const_iterator, bool>(it, false);
+
+    std::size_t cost = set_type::template key_footprint<Allocator>(key);
+    Charge(cost);
+    std::pair<const_iterator, bool> p;
+    try {
+        p = set_.insert(key);
+    } catch (...) {
+        Release(cost);
+        throw;
+    }
+    // The stored copy may own a different capacity than the argument.
+    std::size_t actual = set_type::template key_footprint<Allocator>(*p.first);
+    if (budget_ != nullptr && actual > cost) budget_->Charge(actual - cost);
+    if (actual < cost) Release(cost - actual);
+    charged_ += actual;
+    return p;
+}
+
+template <class Key, class Stats, class Allocator>
+void BudgetedSet<Key, Stats, Allocator>::erase(iterator position) {
+    std::size_t cost = set_type::template key_footprint<Allocator>(*position);
+    set_.erase(position);
+    Release(cost);
+    charged_ -= cost;
+}
+
+template <class Key, class Stats, class Allocator>
+size_t BudgetedSet<Key, Stats, Allocator>::erase(const key_type& key) {
+    const_iterator it = set_.find(key);
+    if (it == set_.end()) return 0;
+    erase(it);
+    return 1;
+}
+
+template <class Key, class Stats, class Allocator>
+void BudgetedSet<Key, Stats, Allocator>::clear() {
+    set_.clear();
+    Release(charged_);
+    charged_ = 0;
+}
+
+template <class Key, class Stats, class Allocator>
+typename BudgetedSet<Key, Stats, Allocator>::const_iterator
+BudgetedSet<Key, Stats, Allocator>::find(const key_type& key) const {
+    return set_.find(key);
+}
+
+template <class Key, class Stats, class Allocator>
+bool BudgetedSet<Key, Stats, Allocator>::contains(const key_type& key) const {
+    return set_.contains(key);
+}
+
+template <class Key, class Stats, class Allocator>
+typename BudgetedSet<Key, Stats, Allocator>::const_iterator
+BudgetedSet<Key, Stats, Allocator>::lower_bound(const key_type& key) const {
+    return set_.lower_bound(key);
+}
+
+template <class Key, class Stats, class Allocator>
+typename BudgetedSet<Key, Stats, Allocator>::const_iterator
+BudgetedSet<Key, Stats, Allocator>::upper_bound(const key_type& key) const {
+    return set_.upper_bound(key);
+}
+
+template <class Key, class Stats, class Allocator>
+memory::Usage BudgetedSet<Key, Stats, Allocator>::memory_usage() const {
+    return set_.template memory_usage<Allocator>();
+}
+
+template <class Key, class Stats, class Allocator>
+void BudgetedSet<Key, Stats, Allocator>::Charge(std::size_t bytes) {
+    if (budget_ == nullptr) return;
+    while (!budget_->TryCharge(bytes)) {
+        if (!evict_ || !evict_(bytes)) {
+            throw memory::BudgetExceeded("BudgetedSet: memory budget of " +
+                                         std::to_string(budget_->limit()) +
+                                         " bytes exceeded");
+        }
+    }
+}
+
+template <class Key, class Stats, class Allocator>
+void BudgetedSet<Key, Stats, Allocator>::Release(std::size_t bytes) {
+    if (budget_ != nullptr) budget_->Release(bytes);
+}
+
+template <class Key, class Stats, class Allocator>
+std::size_t BudgetedSet<Key, Stats, Allocator>::Cost(const set_type& set) {
+    std::size_t cost = 0;
+    for (const Key& key : set) {
+        cost += set_type::template key_footprint<Allocator>(key);
+    }
+    return cost;
+}
+}  // namespace my_stl
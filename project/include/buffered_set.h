@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "rb_tree.h"
+
+namespace my_stl {
+
+// Set for write-heavy phases: insert and erase only append to an unsorted
+// log, which is sorted and merged into the tree when it fills up or when a
+// read needs the contents. A large log is merged with the tree in one
+// linear pass and the tree rebuilt bottom-up; a log much smaller than the
+// tree is applied key by key instead. The log holds up to max(capacity,
+// size()) operations, so ingest costs O(log capacity) amortised per key
+// and memory grows by at most one entry per key in the set.
+//
+// Reads give the same answers as a Set with every logged operation applied
+// in order, but any insert or erase may invalidate all iterators. Reads
+// write to the set when they merge, so share it between threads as if
+// every call were an update. If a merge throws, e.g. std::bad_alloc, the
+// set is left empty.
+template <class Key, class Stats = my_rbt::stats::NullStats>
+class BufferedSet {
+   private:
+    typedef my_rbt::RBTree<Key, Stats> Tree;
+
+   public:
+    typedef Key key_type;
+    typedef typename Tree::iterator iterator;
+    typedef typename Tree::iterator const_iterator;
+
+    static constexpr std::size_t kDefaultCapacity = 4096;
+
+    BufferedSet();
+    explicit BufferedSet(std::size_t capacity);
+    BufferedSet(const BufferedSet& other);
+    BufferedSet& operator=(const BufferedSet& other);
+
+    // Neither reports whether the key was present: that is only known once
+    // the log is merged.
+    void insert(const key_type&);
+    void erase(const key_type&);
+    void clear();
+    // Merges the log now, e.g. at the end of an ingest batch.
+    void flush() const;
+    // Operations logged since the last merge.
+    size_t pending() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+    const_iterator find(const key_type&) const;
+    bool contains(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+
+    my_rbt::stats::Counters stats() const;
+    my_rbt::stats::Shape shape() const;
+
+   private:
+    // A logged key and whether it was inserted (true) or erased.
+    typedef std::pair<Key, bool> Entry;
+
+    void Append(const key_type& key, bool insert);
+    // Merges an already sorted log with one entry per key.
+    void MergeSorted() const;
+
+    mutable Tree rbtree_;
+    mutable std::vector<Entry> log_;
+    std::size_t capacity_;
+};
+
+template <class Key, class Stats>
+BufferedSet<Key, Stats>::BufferedSet()
+    : rbtree_(), log_(), capacity_(kDefaultCapacity) {}
+
+template <class Key, class Stats>
+BufferedSet<Key, Stats>::BufferedSet(std::size_t capacity)
+    : rbtree_(), log_(), capacity_(std::max<std::size_t>(capacity, 1)) {}
+
+template <class Key, class Stats>
+BufferedSet<Key, Stats>::BufferedSet(const BufferedSet& other)
+    : rbtree_(other.rbtree_), log_(other.log_), capacity_(other.capacity_) {}
+
+template <class Key, class Stats>
+BufferedSet<Key, Stats>& BufferedSet<Key, Stats>::operator=(
+    const BufferedSet& other) {
+    rbtree_ = other.rbtree_;
+    log_ = other.log_;
+    capacity_ = other.capacity_;
+    return *this;
+}
+
+template <class Key, class Stats>
+void BufferedSet<Key, Stats>::insert(const key_type& key) {
+    Append(key, true);
+}
+
+template <class Key, class Stats>
+void BufferedSet<Key, Stats>::erase(const key_type& key) {
+    Append(key, false);
+}
+
+template <class Key, class Stats>
+void BufferedSet<Key, Stats>::Append(const key_type& key, bool insert) {
+    log_.emplace_back(key, insert);
+    if (log_.size() >= std::max(capacity_, rbtree_.GetSize())) flush();
+}
+
+template <class Key, class Stats>
+void BufferedSet<Key, Stats>::clear() {
+    log_.clear();
+    rbtree_.Clear();
+}
+
+template <class Key, class Stats>
+void BufferedSet<Key, Stats>::flush() const {
+    if (log_.empty()) return;
+
+    // Stable, so the last operation on a key is the last of its run.
+    std::stable_sort(log_.begin(), log_.end(),
+                     [](const Entry& a, const Entry& b) {
+                         return a.first < b.first;
+                     });
+    auto last = log_.begin();
+    for (auto it = log_.begin(); it != log_.end(); ++last) {
+        auto run = it;
+        while (++it != log_.end() && !(run->first < it->first)) run = it;
+        if (last != run) *last = std::move(*run);
+    }
+    log_.erase(last, log_.end());
+
+    try {
+        MergeSorted();
+    } catch (...) {
+        log_.clear();
+        rbtree_.Clear();
+        throw;
+    }
+    log_.clear();
+}
+
+template <class Key, class Stats>
+void BufferedSet<Key, Stats>::MergeSorted() const {
+    // A few keys into a big tree: O(m log n) beats rebuilding n nodes.
+    if (log_.size() * 16 < rbtree_.GetSize()) {
+        for (const Entry& entry : log_) {
+            if (entry.second) {
+                rbtree_.TryEmplace(entry.first, entry.first);
+            } else {
+                rbtree_.Erase(entry.first);
+            }
+        }
+        return;
+    }
+
+    std::vector<Key> merged;
+    merged.reserve(rbtree_.GetSize() + log_.size());
+    const_iterator it = rbtree_.begin();
+    const const_iterator end = rbtree_.end();
+    for (Entry& entry : log_) {
+        for (; it != end && *it < entry.first; ++it) merged.push_back(*it);
+        if (it != end && !(entry.first < *it)) ++it;
+        if (entry.second) merged.push_back(std::move(entry.first));
+    }
+    for (; it != end; ++it) merged.push_back(*it);
+
+    auto next = merged.begin();
+    rbtree_.AssignSorted(merged.size(),
+                         [&next]() { return std::move(*next++); });
+}
+
+template <class Key, class Stats>
+size_t BufferedSet<Key, Stats>::pending() const {
+    return log_.size();
+}
+
+template <class Key, class Stats>
+typename BufferedSet<Key, Stats>::const_iterator
+BufferedSet<Key, Stats>::begin() const {
+    flush();
+    return rbtree_.begin();
+}
+
+template <class Key, class Stats>
+typename BufferedSet<Key, Stats>::const_iterator
+BufferedSet<Key, Stats>::end() const {
+    // Merged too, so --end() reaches the last key even mid-ingest.
+    flush();
+    return rbtree_.end();
+}
+
+template <class Key, class Stats>
+size_t BufferedSet<Key, Stats>::size() const {
+    flush();
+    return rbtree_.GetSize();
+}
+
+template <class Key, class Stats>
+bool BufferedSet<Key, Stats>::empty() const {
+    flush();
+    return rbtree_.IsEmpty();
+}
+
+template <class Key, class Stats>
+typename BufferedSet<Key, Stats>::const_iterator
+BufferedSet<Key, Stats>::find(const key_type& key) const {
+    flush();
+    return rbtree_.IterateTo(key);
+}
+
+template <class Key, class Stats>
+bool BufferedSet<Key, Stats>::contains(const key_type& key) const {
+    flush();
+    return rbtree_.FindNode(key) != nullptr;
+}
+
+template <class Key, class Stats>
+typename BufferedSet<Key, Stats>::const_iterator
+BufferedSet<Key, Stats>::lower_bound(const key_type& key) const {
+    flush();
+    return rbtree_.LowerBound(key);
+}
+
+template <class Key, class Stats>
+typename BufferedSet<Key, Stats>::const_iterator
+BufferedSet<Key, Stats>::upper_bound(const key_type& key) const {
+    flush();
+    return rbtree_.UpperBound(key);
+}
+
+template <class Key, class Stats>
+my_rbt::stats::Counters BufferedSet<Key, Stats>::stats() const {
+    return rbtree_.GetStats().Snapshot();
+}
+
+template <class Key, class Stats>
+my_rbt::stats::Shape BufferedSet<Key, Stats>::shape() const {
+    flush();
+    return rbtree_.GetShape();
+}
+}  // namespace my_stl
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <iterator>
+
+namespace my_stl {
+namespace eytzinger {
+
+// Implicit search-tree ("Eytzinger") layout of n sorted keys: slot 0 is the
+// root and slot k has children 2k + 1 and 2k + 2. The first levels of every
+// search share the first few cache lines, and a lookup is a fixed sequence
+// of branch-free steps. Slot n stands for end().
+
+// Slot of the smallest key, or n if the layout is empty.
+constexpr std::size_t First(std::size_t n) {
+    if (n == 0) return n;
+    std::size_t k = 0;
+    while (2 * k + 1 < n) k = 2 * k + 1;
+    return k;
+}
+
+// Slot of the largest key, or n if the layout is empty.
+constexpr std::size_t Last(std::size_t n) {
+    if (n == 0) return n;
+    std::size_t k = 0;
+    while (2 * k + 2 < n) k = 2 * k + 2;
+    return k;
+}
+
+// In-order successor of slot k, or n after the largest key.
+constexpr std::size_t Next(std::size_t k, std::size_t n) {
+    if (2 * k + 2 < n) {
+        k = 2 * k + 2;
+        while (2 * k + 1 < n) k = 2 * k + 1;
+        return k;
+    }
+    while (k != 0 && k % 2 == 0) k = (k - 1) / 2;
+    return (k == 0) ? n : (k - 1) / 2;
+}
+
+// In-order predecessor of slot k; Prev(n, n) is the largest key.
+constexpr std::size_t Prev(std::size_t k, std::size_t n) {
+    if (k == n) return Last(n);
+    if (2 * k + 1 < n) {
+        k = 2 * k + 1;
+        while (2 * k + 2 < n) k = 2 * k + 2;
+        return k;
+    }
+    while (k % 2 == 1) k = (k - 1) / 2;
+    return (k == 0) ? n : (k - 1) / 2;
+}
+
+// Slot of the first key not less than x, or n.
+template <class Key>
+constexpr std::size_t LowerBound(const Key* keys, std::size_t n,
+                                 const Key& x) {
+    std::size_t i = 1;
+    while (i <= n) {
+        i = 2 * i + static_cast<std::size_t>(keys[i - 1] < x);
+    }
+    i >>= std::countr_one(i) + 1;
+    return (i == 0) ? n : i - 1;
+}
+
+// Slot of the first key greater than x, or n.
+template <class Key>
+constexpr std::size_t UpperBound(const Key* keys, std::size_t n,
+                                 const Key& x) {
+    std::size_t i = 1;
+    while (i <= n) {
+        i = 2 * i + static_cast<std::size_t>(!(x < keys[i - 1]));
+    }
+    i >>= std::countr_one(i) + 1;
+    return (i == 0) ? n : i - 1;
+}
+
+// Writes the ascending sequence starting at first into out[0, n) in
+// Eytzinger order and returns the iterator past the last key consumed.
+template <class Iterator, class Key>
+constexpr Iterator Fill(Iterator first, Key* out, std::size_t n) {
+    for (std::size_t k = First(n); k != n; k = Next(k, n)) {
+        out[k] = *first;
+        ++first;
+    }
+    return first;
+}
+
+// Bidirectional iterator over keys stored in Eytzinger order; visits them
+// in ascending order.
+template <class Key>
+class ConstIterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef Key value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Key* pointer;
+    typedef const Key& reference;
+
+    constexpr ConstIterator();
+    constexpr ConstIterator(const Key* keys, std::size_t size,
+                            std::size_t slot);
+
+    constexpr std::size_t slot() const;
+
+    constexpr ConstIterator& operator++();
+    constexpr ConstIterator operator++(int);
+    constexpr ConstIterator& operator--();
+    constexpr ConstIterator operator--(int);
+
+    constexpr bool operator==(const ConstIterator& other) const;
+    constexpr bool operator!=(const ConstIterator& other) const;
+
+    constexpr const Key& operator*() const;
+    constexpr const Key* operator->() const;
+
+   private:
+    const Key* keys_;
+    std::size_t size_;
+    std::size_t slot_;
+};
+
+template <class Key>
+constexpr ConstIterator<Key>::ConstIterator()
+    : keys_{nullptr}, size_{0}, slot_{0} {}
+
+template <class Key>
+constexpr ConstIterator<Key>::ConstIterator(const Key* keys, std::size_t size,
+                                            std::size_t slot)
+    : keys_{keys}, size_{size}, slot_{slot} {}
+
+template <class Key>
+constexpr std::size_t ConstIterator<Key>::slot() const {
+    return slot_;
+}
+
+template <class Key>
+constexpr ConstIterator<Key>& ConstIterator<Key>::operator++() {
+    slot_ = Next(slot_, size_);
+    return *this;
+}
+
+template <class Key>
+constexpr ConstIterator<Key> ConstIterator<Key>::operator++(int) {
+    ConstIterator tmp(*this);
+    ++(*this);
+    return tmp;
+}
+
+template <class Key>
+constexpr ConstIterator<Key>& ConstIterator<Key>::operator--() {
+    slot_ = Prev(slot_, size_);
+    return *this;
+}
+
+template <class Key>
+constexpr ConstIterator<Key> ConstIterator<Key>::operator--(int) {
+    ConstIterator tmp(*this);
+    --(*this);
+    return tmp;
+}
+
+template <class Key>
+constexpr bool ConstIterator<Key>::operator==(
+    const ConstIterator& other) const {
+    return keys_ == other.keys_ && slot_ == other.slot_;
+}
+
+template <class Key>
+constexpr bool ConstIterator<Key>::operator!=(
+    const ConstIterator& other) const {
+    return !(*this == other);
+}
+
+template <class Key>
+constexpr const Key& ConstIterator<Key>::operator*() const {
+    return keys_[slot_];
+}
+
+template <class Key>
+constexpr const Key* ConstIterator<Key>::operator->() const {
+    return keys_ + slot_;
+}
+}  // namespace eytzinger
+}  // namespace my_stl
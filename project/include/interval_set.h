@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "rb_tree.h"
+#include "rbt_augment.h"
+#include "rbt_key_of_value.h"
+
+namespace my_stl {
+
+// Largest end point of the intervals in a subtree, as a monoid for
+// my_rbt::augment. The aggregate points into a node's own interval, which
+// stays put while the node lives, so Point only needs operator<.
+template <class Point>
+struct MaxEnd {
+    typedef const Point* value_type;
+
+    static value_type Identity() { return nullptr; }
+    static value_type Of(const std::pair<Point, Point>& interval) {
+        return &interval.second;
+    }
+    static value_type Combine(value_type a, value_type b) {
+        if (a == nullptr) return b;
+        return (b != nullptr && *a < *b) ? b : a;
+    }
+};
+
+// Set of closed intervals [first, second] sorted by start, then end. Every
+// node also knows the largest end in its subtree, so subtrees that end
+// before a query are skipped: any_overlap is O(log n) and an overlap report
+// of k intervals visits O(log n + k) nodes in typical data (O((k + 1) log n)
+// at worst).
+template <class Point, class Stats = my_rbt::stats::NullStats>
+class IntervalSet {
+   public:
+    typedef Point point_type;
+    typedef std::pair<Point, Point> interval_type;
+
+   private:
+    typedef my_rbt::RBTree<interval_type, Stats, std::less<interval_type>,
+                           my_rbt::key_of_value::Identity, MaxEnd<Point>>
+        Tree;
+    typedef typename Tree::node_ptr node_ptr;
+
+    // Whether any interval under t ends at or after lo.
+    static bool Reaches(node_ptr t, const point_type& lo);
+
+   public:
+    typedef typename Tree::iterator iterator;
+    typedef typename Tree::iterator const_iterator;
+
+    IntervalSet();
+    IntervalSet(std::initializer_list<interval_type> list);
+    IntervalSet(const IntervalSet& other);
+    IntervalSet& operator=(const IntervalSet& other);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    // Throws std::invalid_argument if second < first.
+    std::pair<const_iterator, bool> insert(const interval_type&);
+    size_t erase(const interval_type&);
+    bool contains(const interval_type&) const;
+
+    // Intervals containing point, in ascending order.
+    std::vector<interval_type> overlapping(const point_type& point) const;
+    // Intervals sharing at least one point with [lo, hi].
+    std::vector<interval_type> overlapping(const point_type& lo,
+                                           const point_type& hi) const;
+    // fn(interval) for each of them, without building a vector.
+    template <class Fn>
+    Fn for_each_overlap(const point_type& lo, const point_type& hi,
+                        Fn fn) const;
+    bool any_overlap(const point_type& lo, const point_type& hi) const;
+
+    my_rbt::stats::Counters stats() const;
+    my_rbt::stats::Shape shape() const;
+
+   private:
+    Tree rbtree_;
+};
+
+template <class Point, class Stats>
+bool IntervalSet<Point, Stats>::Reaches(node_ptr t, const point_type& lo) {
+    return t != nullptr && !(*Tree::Aggregate(t) < lo);
+}
+
+template <class Point, class Stats>
+IntervalSet<Point, Stats>::IntervalSet() : rbtree_() {}
+
+template <class Point, class Stats>
+IntervalSet<Point, Stats>::IntervalSet(
+    std::initializer_list<interval_type> list)
+    : rbtree_() {
+    for (const interval_type& interval : list) insert(interval);
+}
+
+template <class Point, class Stats>
+IntervalSet<Point, Stats>::IntervalSet(const IntervalSet& other)
+    : rbtree_(other.rbtree_) {}
+
+template <class Point, class Stats>
+IntervalSet<Point, Stats>& IntervalSet<Point, Stats>::operator=(
+    const IntervalSet& other) {
+    rbtree_ = other.rbtree_;
+    return *this;
+}
+
+template <class Point, class Stats>
+typename IntervalSet<Point, Stats>::const_iterator
+IntervalSet<Point, Stats>::begin() const {
+    return rbtree_.begin();
+}
+
+template <class Point, class Stats>
+typename IntervalSet<Point, Stats>::const_iterator
+IntervalSet<Point, Stats>::end() const {
+    return rbtree_.end();
+}
+
+template <class Point, class Stats>
+size_t IntervalSet<Point, Stats>::size() const {
+    return rbtree_.GetSize();
+}
+
+template <class Point, class Stats>
+bool IntervalSet<Point, Stats>::empty() const {
+    return rbtree_.IsEmpty();
+}
+
+template <class Point, class Stats>
+void IntervalSet<Point, Stats>::clear() {
+    rbtree_.Clear();
+}
+
+template <class Point, class Stats>
+std::pair<typename IntervalSet<Point, Stats>::const_iterator, bool>
+IntervalSet<Point, Stats>::insert(const interval_type& interval) {
+    if (interval.second < interval.first) {
+        throw std::invalid_argument("my_stl::IntervalSet: end before start");
+    }
+    return rbtree_.TryEmplace(interval, interval);
+}
+
+template <class Point, class Stats>
+size_t IntervalSet<Point, Stats>::erase(const interval_type& interval) {
+    return rbtree_.Erase(interval);
+}
+
+template <class Point, class Stats>
+bool IntervalSet<Point, Stats>::contains(const interval_type& interval) const {
+    return rbtree_.FindNode(interval) != nullptr;
+}
+
+template <class Point, class Stats>
+std::vector<typename IntervalSet<Point, Stats>::interval_type>
+IntervalSet<Point, Stats>::overlapping(const point_type& point) const {
+    return overlapping(point, point);
+}
+
+template <class Point, class Stats>
+std::vector<typename IntervalSet<Point, Stats>::interval_type>
+IntervalSet<Point, Stats>::overlapping(const point_type& lo,
+                                       const point_type& hi) const {
+    std::vector<interval_type> out;
+    for_each_overlap(lo, hi, [&out](const interval_type& interval) {
+        out.push_back(interval);
+    });
+    return out;
+}
+
+template <class Point, class Stats>
+template <class Fn>
+Fn IntervalSet<Point, Stats>::for_each_overlap(const point_type& lo,
+                                               const point_type& hi,
+                                               Fn fn) const {
+    // In-order walk that never enters a subtree ending before lo and stops
+    // at the first start past hi. Depth is bounded as in ForEachInRange.
+    node_ptr stack[2 * 64];
+    std::size_t top = 0;
+    node_ptr t = rbtree_.GetRoot();
+    while (true) {
+        for (; Reaches(t, lo); t = t->left_) {
+            stack[top++] = t;
+        }
+        if (top == 0) break;
+        node_ptr n = stack[--top];
+        if (hi < n->key_.first) break;
+        if (!(n->key_.second < lo)) fn(n->key_);
+        t = n->right_;
+    }
+    return fn;
+}
+
+template <class Point, class Stats>
+bool IntervalSet<Point, Stats>::any_overlap(const point_type& lo,
+                                            const point_type& hi) const {
+    // If the left subtree reaches lo, either it holds an overlap or its
+    // interval reaching lo starts after hi, and so does all of the right.
+    node_ptr t = rbtree_.GetRoot();
+    while (t != nullptr) {
+        if (!(hi < t->key_.first) && !(t->key_.second < lo)) return true;
+        if (Reaches(t->left_, lo)) {
+            t = t->left_;
+        } else {
+            t = t->right_;
+        }
+    }
+    return false;
+}
+
+template <class Point, class Stats>
+my_rbt::stats::Counters IntervalSet<Point, Stats>::stats() const {
+    return rbtree_.GetStats().Snapshot();
+}
+
+template <class Point, class Stats>
+my_rbt::stats::Shape IntervalSet<Point, Stats>::shape() const {
+    return rbtree_.GetShape();
+}
+}  // namespace my_stl
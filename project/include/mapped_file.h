@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace my_stl {
+namespace io {
+
+// Read-only, shared mapping of a whole file. Pages come from the page cache,
+// so every process mapping the same file shares one physical copy, and
+// nothing is read until it is touched.
+class MappedFile {
+   public:
+    MappedFile();
+    // Throws std::system_error if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string& path);
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* data() const;
+    std::size_t size() const;
+
+    // Hints that the range [offset, offset + length) will be needed soon.
+    void WillNeed(std::size_t offset, std::size_t length) const;
+
+   private:
+    void Unmap();
+
+    const char* data_;
+    std::size_t size_;
+};
+}  // namespace io
+}  // namespace my_stl
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "eytzinger.h"
+#include "mapped_file.h"
+#include "my_set.h"
+#include "set_codec.h"
+
+namespace my_stl {
+
+// Read-only set served straight from a file written by MappedSet::write.
+// The keys sit in the file in Eytzinger order, so opening only maps the
+// file and checks the header: no parsing and no allocation, whatever the
+// size. Processes that open the same file share its pages.
+template <class Key>
+class MappedSet {
+    static_assert(std::is_trivially_copyable_v<Key>,
+                  "MappedSet stores keys as raw bytes");
+    static_assert(alignof(Key) <= io::kMappedPayloadOffset,
+                  "MappedSet payload alignment is too small for Key");
+
+   public:
+    typedef Key key_type;
+    typedef my_stl::eytzinger::ConstIterator<Key> iterator;
+    typedef my_stl::eytzinger::ConstIterator<Key> const_iterator;
+
+    MappedSet();
+    // Throws std::system_error if the file cannot be mapped and
+    // std::runtime_error if it is not a MappedSet<Key> file.
+    explicit MappedSet(const std::string& path);
+    MappedSet(MappedSet&& other) noexcept;
+    MappedSet& operator=(MappedSet&& other) noexcept;
+
+    // Writes the ascending, duplicate-free keys [first, last) in the mapped
+    // layout. Throws std::invalid_argument if the input is not sorted.
+    template <class Iterator>
+    static void write(std::ostream& os, Iterator first, Iterator last);
+    template <class Stats, class Monoid, std::size_t N, class Filter,
+              bool CacheFinger, class Balance>
+    static void write(
+        std::ostream& os,
+        const Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>& set);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    const_iterator find(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+    bool contains(const key_type&) const;
+
+    // Recomputes the payload checksum. This reads the whole file, so it is
+    // left to the caller instead of being done on open.
+    bool verify() const;
+
+   private:
+    io::MappedFile file_;
+    const io::FileHeader* header_;
+    const Key* keys_;
+    size_t size_;
+};
+
+template <class Key>
+MappedSet<Key>::MappedSet()
+    : file_(), header_{nullptr}, keys_{nullptr}, size_{0} {}
+
+template <class Key>
+MappedSet<Key>::MappedSet(const std::string& path)
+    : file_(path), header_{nullptr}, keys_{nullptr}, size_{0} {
+    typedef io::Codec<Key> Codec;
+
+    if (file_.size() < io::kMappedPayloadOffset) {
+        throw std::runtime_error("MappedSet: truncated header");
+    }
+    header_ = reinterpret_cast<const io::FileHeader*>(file_.data());
+    if (std::memcmp(header_->magic_, io::kMagic, sizeof(header_->magic_)) !=
+            0 ||
+        header_->version_ != io::kFormatVersion ||
+        header_->flags_ != io::kLayoutEytzinger) {
+        throw std::runtime_error("MappedSet: not a mapped set file");
+    }
+    if (header_->byte_order_ != io::kByteOrderMark ||
+        header_->key_tag_ != Codec::kTag || header_->key_size_ != sizeof(Key) ||
+        header_->payload_size_ % sizeof(Key) != 0 ||
+        header_->count_ != header_->payload_size_ / sizeof(Key)) {
+        throw std::runtime_error("MappedSet: key type mismatch");
+    }
+    if (file_.size() - io::kMappedPayloadOffset < header_->payload_size_) {
+        throw std::runtime_error("MappedSet: truncated payload");
+    }
+
+    keys_ = reinterpret_cast<const Key*>(file_.data() +
+                                         io::kMappedPayloadOffset);
+    size_ = header_->count_;
+    // The first levels of the implicit tree are on every lookup path.
+    file_.WillNeed(io::kMappedPayloadOffset, 64 * 1024);
+}
+
+template <class Key>
+MappedSet<Key>::MappedSet(MappedSet&& other) noexcept
+    : file_(std::move(other.file_)),
+      header_{std::exchange(other.header_, nullptr)},
+      keys_{std::exchange(other.keys_, nullptr)},
+      size_{std::exchange(other.size_, 0)} {}
+
+template <class Key>
+MappedSet<Key>& MappedSet<Key>::operator=(MappedSet&& other) noexcept {
+    if (this != &other) {
+        file_ = std::move(other.file_);
+        header_ = std::exchange(other.header_, nullptr);
+        keys_ = std::exchange(other.keys_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+template <class Key>
+template <class Iterator>
+void MappedSet<Key>::write(std::ostream& os, Iterator first, Iterator last) {
+    std::vector<Key> sorted(first, last);
+    for (size_t i = 1; i < sorted.size(); ++i) {
+        if (!(sorted[i - 1] < sorted[i])) {
+            throw std::invalid_argument("MappedSet::write: keys not sorted");
+        }
+    }
+    std::vector<Key> layout(sorted.size());
+    my_stl::eytzinger::Fill(sorted.begin(), layout.data(), layout.size());
+
+    io::Writer measure;
+    measure.Write(layout.data(), layout.size() * sizeof(Key));
+    measure.Flush();
+
+    io::FileHeader header{};
+    std::memcpy(header.magic_, io::kMagic, sizeof(header.magic_));
+    header.version_ = io::kFormatVersion;
+    header.flags_ = io::kLayoutEytzinger;
+    header.byte_order_ = io::kByteOrderMark;
+    header.key_tag_ = io::Codec<Key>::kTag;
+    header.key_size_ = sizeof(Key);
+    header.count_ = layout.size();
+    header.payload_size_ = measure.Size();
+    header.checksum_ = measure.Digest();
+
+    char padded[io::kMappedPayloadOffset] = {};
+    std::memcpy(padded, &header, sizeof(header));
+    os.write(padded, sizeof(padded));
+    os.write(reinterpret_cast<const char*>(layout.data()),
+             static_cast<std::streamsize>(header.payload_size_));
+    if (!os) throw std::runtime_error("MappedSet::write: write failed");
+}
+
+template <class Key>
+template <class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void MappedSet<Key>::write(
+    std::ostream& os,
+    const Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>& set) {
+    write(os, set.begin(), set.end());
+}
+
+template <class Key>
+typename MappedSet<Key>::const_iterator MappedSet<Key>::begin() const {
+    return const_iterator(keys_, size_, my_stl::eytzinger::First(size_));
+}
+
+template <class Key>
+typename MappedSet<Key>::const_iterator MappedSet<Key>::end() const {
+    return const_iterator(keys_, size_, size_);
+}
+
+template <class Key>
+size_t MappedSet<Key>::size() const {
+    return size_;
+}
+
+template <class Key>
+bool MappedSet<Key>::empty() const {
+    return size_ == 0;
+}
+
+template <class Key>
+typename MappedSet<Key>::const_iterator MappedSet<Key>::find(
+    const key_type& value) const {
+    const_iterator i(lower_bound(value));
+    if (i != end() && (value < *i)) {
+        i = end();
+    }
+    return i;
+}
+
+template <class Key>
+typename MappedSet<Key>::const_iterator MappedSet<Key>::lower_bound(
+    const key_type& value) const {
+    return const_iterator(
+        keys_, size_, my_stl::eytzinger::LowerBound(keys_, size_, value));
+}
+
+template <class Key>
+typename MappedSet<Key>::const_iterator MappedSet<Key>::upper_bound(
+    const key_type& value) const {
+    return const_iterator(
+        keys_, size_, my_stl::eytzinger::UpperBound(keys_, size_, value));
+}
+
+template <class Key>
+bool MappedSet<Key>::contains(const key_type& value) const {
+    return find(value) != end();
+}
+
+template <class Key>
+bool MappedSet<Key>::verify() const {
+    if (header_ == nullptr) return true;
+    io::Checksum checksum;
+    checksum.Update(reinterpret_cast<const char*>(keys_),
+                    header_->payload_size_);
+    return checksum.Digest() == header_->checksum_;
+}
+}  // namespace my_stl
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "rb_tree.h"
+#include "rbt_iterator.h"
+#include "rbt_key_of_value.h"
+
+namespace my_stl {
+
+// Sorted associative array on the same red-black tree as Set. Nodes hold
+// pair<const Key, Value> and the tree orders them by the key alone, so a
+// lookup never reads a mapped value. operator[], try_emplace and
+// insert_or_assign descend once and build the node in place only when the
+// key is new: no default-constructed temporary, no second search.
+template <class Key, class Value, class Compare = std::less<Key>,
+          class Stats = my_rbt::stats::NullStats>
+class Map {
+   public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef std::pair<const Key, Value> value_type;
+    typedef Compare key_compare;
+
+   private:
+    typedef my_rbt::RBTree<value_type, Stats, Compare,
+                           my_rbt::key_of_value::SelectFirst>
+        Tree;
+
+   public:
+    typedef my_rbt::iterator::Iterator<value_type> iterator;
+    typedef typename Tree::iterator const_iterator;
+
+    Map();
+    explicit Map(const Compare& compare);
+    template <class Iterator>
+    Map(Iterator, Iterator);
+    Map(std::initializer_list<value_type> list);
+    Map(const Map& other);
+    Map& operator=(const Map& other);
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    // Leaves an existing value alone; second is false then.
+    std::pair<iterator, bool> insert(const value_type&);
+    template <class Iterator>
+    void insert(Iterator, Iterator);
+    // Value(args...) is constructed only if key is absent.
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key,
+                                          Args&&... args);
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args);
+    // Assigns to the existing value, or inserts; second is true on insert.
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj);
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj);
+
+    // Value-initialises the mapped value of a new key.
+    mapped_type& operator[](const key_type&);
+    mapped_type& operator[](key_type&&);
+    // Throws std::out_of_range if the key is absent.
+    mapped_type& at(const key_type&);
+    const mapped_type& at(const key_type&) const;
+
+    // Returns the iterator after the erased element.
+    iterator erase(const_iterator);
+    size_t erase(const key_type&);
+
+    iterator find(const key_type&);
+    const_iterator find(const key_type&) const;
+    size_t count(const key_type&) const;
+    bool contains(const key_type&) const;
+    iterator lower_bound(const key_type&);
+    const_iterator lower_bound(const key_type&) const;
+    iterator upper_bound(const key_type&);
+    const_iterator upper_bound(const key_type&) const;
+
+    key_compare key_comp() const;
+    my_rbt::stats::Counters stats() const;
+    void reset_stats();
+    my_rbt::stats::Shape shape() const;
+
+   private:
+    Tree rbtree_;
+};
+
+template <class Key, class Value, class Compare, class Stats>
+Map<Key, Value, Compare, Stats>::Map() : rbtree_() {}
+
+template <class Key, class Value, class Compare, class Stats>
+Map<Key, Value, Compare, Stats>::Map(const Compare& compare)
+    : rbtree_(compare) {}
+
+template <class Key, class Value, class Compare, class Stats>
+template <class Iterator>
+Map<Key, Value, Compare, Stats>::Map(Iterator first, Iterator last)
+    : rbtree_() {
+    insert(first, last);
+}
+
+template <class Key, class Value, class Compare, class Stats>
+Map<Key, Value, Compare, Stats>::Map(std::initializer_list<value_type> list)
+    : rbtree_() {
+    insert(list.begin(), list.end());
+}
+
+template <class Key, class Value, class Compare, class Stats>
+Map<Key, Value, Compare, Stats>::Map(const Map& other)
+    : rbtree_(other.rbtree_) {}
+
+template <class Key, class Value, class Compare, class Stats>
+Map<Key, Value, Compare, Stats>& Map<Key, Value, Compare, Stats>::operator=(
+    const Map& other) {
+    rbtree_ = other.rbtree_;
+    return *this;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::iterator
+Map<Key, Value, Compare, Stats>::begin() {
+    return iterator(rbtree_.begin());
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::iterator
+Map<Key, Value, Compare, Stats>::end() {
+    return iterator(rbtree_.end());
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::const_iterator
+Map<Key, Value, Compare, Stats>::begin() const {
+    return rbtree_.begin();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::const_iterator
+Map<Key, Value, Compare, Stats>::end() const {
+    return rbtree_.end();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+size_t Map<Key, Value, Compare, Stats>::size() const {
+    return rbtree_.GetSize();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+bool Map<Key, Value, Compare, Stats>::empty() const {
+    return rbtree_.IsEmpty();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+void Map<Key, Value, Compare, Stats>::clear() {
+    rbtree_.Clear();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+std::pair<typename Map<Key, Value, Compare, Stats>::iterator, bool>
+Map<Key, Value, Compare, Stats>::insert(const value_type& value) {
+    auto inserted = rbtree_.TryEmplace(value.first, value);
+    return {iterator(inserted.first), inserted.second};
+}
+
+template <class Key, class Value, class Compare, class Stats>
+template <class Iterator>
+void Map<Key, Value, Compare, Stats>::insert(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+        insert(*first);
+    }
+}
+
+template <class Key, class Value, class Compare, class Stats>
+template <class... Args>
+std::pair<typename Map<Key, Value, Compare, Stats>::iterator, bool>
+Map<Key, Value, Compare, Stats>::try_emplace(const key_type& key,
+                                             Args&&... args) {
+    auto inserted = rbtree_.TryEmplace(
+        key, std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    return {iterator(inserted.first), inserted.second};
+}
+
+template <class Key, class Value, class Compare, class Stats>
+template <class... Args>
+std::pair<typename Map<Key, Value, Compare, Stats>::iterator, bool>
+Map<Key, Value, Compare, Stats>::try_emplace(key_type&& key,
+                                             Args&&... args) {
+    // key is only moved from once the descent is over and the node is built.
+    auto inserted = rbtree_.TryEmplace(
+        key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    return {iterator(inserted.first), inserted.second};
+}
+
+template <class Key, class Value, class Compare, class Stats>
+template <class M>
+std::pair<typename Map<Key, Value, Compare, Stats>::iterator, bool>
+Map<Key, Value, Compare, Stats>::insert_or_assign(const key_type& key,
+                                                  M&& obj) {
+    auto result = try_emplace(key, std::forward<M>(obj));
+    if (!result.second) result.first->second = std::forward<M>(obj);
+    return result;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+template <class M>
+std::pair<typename Map<Key, Value, Compare, Stats>::iterator, bool>
+Map<Key, Value, Compare, Stats>::insert_or_assign(key_type&& key, M&& obj) {
+    auto result = try_emplace(std::move(key), std::forward<M>(obj));
+    if (!result.second) result.first->second = std::forward<M>(obj);
+    return result;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::mapped_type&
+Map<Key, Value, Compare, Stats>::operator[](const key_type& key) {
+    return try_emplace(key).first->second;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::mapped_type&
+Map<Key, Value, Compare, Stats>::operator[](key_type&& key) {
+    return try_emplace(std::move(key)).first->second;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::mapped_type&
+Map<Key, Value, Compare, Stats>::at(const key_type& key) {
+    auto node = rbtree_.FindNode(key);
+    if (node == nullptr) throw std::out_of_range("my_stl::Map::at");
+    return node->key_.second;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+const typename Map<Key, Value, Compare, Stats>::mapped_type&
+Map<Key, Value, Compare, Stats>::at(const key_type& key) const {
+    auto node = rbtree_.FindNode(key);
+    if (node == nullptr) throw std::out_of_range("my_stl::Map::at");
+    return node->key_.second;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::iterator
+Map<Key, Value, Compare, Stats>::erase(const_iterator position) {
+    return iterator(rbtree_.Erase(position));
+}
+
+template <class Key, class Value, class Compare, class Stats>
+size_t Map<Key, Value, Compare, Stats>::erase(const key_type& key) {
+    return rbtree_.Erase(key);
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::iterator
+Map<Key, Value, Compare, Stats>::find(const key_type& key) {
+    return iterator(rbtree_.IterateTo(key));
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::const_iterator
+Map<Key, Value, Compare, Stats>::find(const key_type& key) const {
+    return rbtree_.IterateTo(key);
+}
+
+template <class Key, class Value, class Compare, class Stats>
+size_t Map<Key, Value, Compare, Stats>::count(const key_type& key) const {
+    return contains(key) ? 1 : 0;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+bool Map<Key, Value, Compare, Stats>::contains(const key_type& key) const {
+    return rbtree_.FindNode(key) != nullptr;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::iterator
+Map<Key, Value, Compare, Stats>::lower_bound(const key_type& key) {
+    return iterator(rbtree_.LowerBound(key));
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::const_iterator
+Map<Key, Value, Compare, Stats>::lower_bound(const key_type& key) const {
+    return rbtree_.LowerBound(key);
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::iterator
+Map<Key, Value, Compare, Stats>::upper_bound(const key_type& key) {
+    return iterator(rbtree_.UpperBound(key));
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::const_iterator
+Map<Key, Value, Compare, Stats>::upper_bound(const key_type& key) const {
+    return rbtree_.UpperBound(key);
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename Map<Key, Value, Compare, Stats>::key_compare
+Map<Key, Value, Compare, Stats>::key_comp() const {
+    return rbtree_.KeyComp();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+my_rbt::stats::Counters Map<Key, Value, Compare, Stats>::stats() const {
+    return rbtree_.GetStats().Snapshot();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+void Map<Key, Value, Compare, Stats>::reset_stats() {
+    rbtree_.ResetStats();
+}
+
+template <class Key, class Value, class Compare, class Stats>
+my_rbt::stats::Shape Map<Key, Value, Compare, Stats>::shape() const {
+    return rbtree_.GetShape();
+}
+}  // namespace my_stl
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+#include "rb_tree.h"
+#include "rbt_range.h"
+
+namespace my_stl {
+
+// Sorted multiset on the same red-black tree as Set. Equal keys are kept in
+// insertion order, each in its own node, so duplicates cost neither a
+// counter field in the key nor extra comparisons.
+template <class Key, class Compare = std::less<Key>,
+          class Stats = my_rbt::stats::NullStats>
+class MultiSet {
+   private:
+    typedef my_rbt::RBTree<Key, Stats, Compare> Tree;
+
+   public:
+    typedef Key key_type;
+    typedef Compare key_compare;
+    typedef typename Tree::iterator iterator;
+    typedef typename Tree::iterator const_iterator;
+    typedef my_rbt::range::Range<Key> range_type;
+
+    MultiSet();
+    explicit MultiSet(const Compare& compare);
+    template <class Iterator>
+    MultiSet(Iterator, Iterator);
+    MultiSet(std::initializer_list<key_type> list);
+    MultiSet(const MultiSet& other);
+    MultiSet& operator=(const MultiSet& other);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    // After every key equal to the argument.
+    iterator insert(const key_type&);
+    // Right before hint if that keeps the order (amortised O(1)), as the
+    // plain insert otherwise.
+    iterator insert(const_iterator hint, const key_type&);
+    template <class Iterator>
+    void insert(Iterator, Iterator);
+
+    // Returns the iterator after the erased key.
+    iterator erase(const_iterator);
+    iterator erase(const_iterator first, const_iterator last);
+    // Removes every equal key and returns how many there were, O(log n + k).
+    size_t erase(const key_type&);
+
+    // The first of the equal keys, or end().
+    const_iterator find(const key_type&) const;
+    size_t count(const key_type&) const;
+    bool contains(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+    // The equal keys as a view, bounded in O(log n).
+    range_type equal_range(const key_type&) const;
+
+    key_compare key_comp() const;
+    my_rbt::stats::Counters stats() const;
+    my_rbt::stats::Shape shape() const;
+
+   private:
+    Tree rbtree_;
+};
+
+template <class Key, class Compare, class Stats>
+MultiSet<Key, Compare, Stats>::MultiSet() : rbtree_() {}
+
+template <class Key, class Compare, class Stats>
+MultiSet<Key, Compare, Stats>::MultiSet(const Compare& compare)
+    : rbtree_(compare) {}
+
+template <class Key, class Compare, class Stats>
+template <class Iterator>
+MultiSet<Key, Compare, Stats>::MultiSet(Iterator first, Iterator last)
+    : rbtree_() {
+    insert(first, last);
+}
+
+template <class Key, class Compare, class Stats>
+MultiSet<Key, Compare, Stats>::MultiSet(std::initializer_list<key_type> list)
+    : rbtree_() {
+    insert(list.begin(), list.end());
+}
+
+template <class Key, class Compare, class Stats>
+MultiSet<Key, Compare, Stats>::MultiSet(const MultiSet& other)
+    : rbtree_(other.rbtree_) {}
+
+template <class Key, class Compare, class Stats>
+MultiSet<Key, Compare, Stats>& MultiSet<Key, Compare, Stats>::operator=(
+    const MultiSet& other) {
+    rbtree_ = other.rbtree_;
+    return *this;
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::const_iterator
+MultiSet<Key, Compare, Stats>::begin() const {
+    return rbtree_.begin();
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::const_iterator
+MultiSet<Key, Compare, Stats>::end() const {
+    return rbtree_.end();
+}
+
+template <class Key, class Compare, class Stats>
+size_t MultiSet<Key, Compare, Stats>::size() const {
+    return rbtree_.GetSize();
+}
+
+template <class Key, class Compare, class Stats>
+bool MultiSet<Key, Compare, Stats>::empty() const {
+    return rbtree_.IsEmpty();
+}
+
+template <class Key, class Compare, class Stats>
+void MultiSet<Key, Compare, Stats>::clear() {
+    rbtree_.Clear();
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::iterator
+MultiSet<Key, Compare, Stats>::insert(const key_type& value) {
+    return rbtree_.InsertEqual(value);
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::iterator
+MultiSet<Key, Compare, Stats>::insert(const_iterator hint,
+                                      const key_type& value) {
+    return rbtree_.InsertEqual(hint, value);
+}
+
+template <class Key, class Compare, class Stats>
+template <class Iterator>
+void MultiSet<Key, Compare, Stats>::insert(Iterator first, Iterator last) {
+    // Appending at end() makes sorted input linear.
+    for (; first != last; ++first) {
+        rbtree_.InsertEqual(rbtree_.end(), *first);
+    }
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::iterator
+MultiSet<Key, Compare, Stats>::erase(const_iterator position) {
+    return rbtree_.Erase(position);
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::iterator
+MultiSet<Key, Compare, Stats>::erase(const_iterator first,
+                                     const_iterator last) {
+    return rbtree_.Erase(first, last);
+}
+
+template <class Key, class Compare, class Stats>
+size_t MultiSet<Key, Compare, Stats>::erase(const key_type& value) {
+    return rbtree_.Erase(value);
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::const_iterator
+MultiSet<Key, Compare, Stats>::find(const key_type& value) const {
+    return rbtree_.IterateTo(value);
+}
+
+template <class Key, class Compare, class Stats>
+size_t MultiSet<Key, Compare, Stats>::count(const key_type& value) const {
+    return rbtree_.Count(value);
+}
+
+template <class Key, class Compare, class Stats>
+bool MultiSet<Key, Compare, Stats>::contains(const key_type& value) const {
+    return rbtree_.FindNode(value) != nullptr;
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::const_iterator
+MultiSet<Key, Compare, Stats>::lower_bound(const key_type& value) const {
+    return rbtree_.LowerBound(value);
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::const_iterator
+MultiSet<Key, Compare, Stats>::upper_bound(const key_type& value) const {
+    return rbtree_.UpperBound(value);
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::range_type
+MultiSet<Key, Compare, Stats>::equal_range(const key_type& value) const {
+    std::pair<iterator, iterator> range = rbtree_.EqualRange(value);
+    return range_type(range.first, range.second);
+}
+
+template <class Key, class Compare, class Stats>
+typename MultiSet<Key, Compare, Stats>::key_compare
+MultiSet<Key, Compare, Stats>::key_comp() const {
+    return rbtree_.KeyComp();
+}
+
+template <class Key, class Compare, class Stats>
+my_rbt::stats::Counters MultiSet<Key, Compare, Stats>::stats() const {
+    return rbtree_.GetStats().Snapshot();
+}
+
+template <class Key, class Compare, class Stats>
+my_rbt::stats::Shape MultiSet<Key, Compare, Stats>::shape() const {
+    return rbtree_.GetShape();
+}
+}  // namespace my_stl
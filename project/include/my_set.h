@@ -1,18 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <iterator>
 #include <memory>
+#include <numeric>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 #include "rb_tree.h"
+#include "rbt_finger.h"
+#include "rbt_range.h"
+#include "rbt_small_tree.h"
+#include "set_codec.h"
+#include "set_filter.h"
+#include "set_memory.h"
+#include "set_text.h"
 
 namespace my_stl {
+// One update for Set::apply_batch: inserts key_ if insert_, else erases it.
 template <class Key>
+struct BatchOp {
+    Key key_;
+    bool insert_;
+};
+
+// Monoid, if given, is cached per subtree (see my_rbt::augment) and makes
+// reduce() O(log n); the default keeps plain nodes. N > 0 keeps up to N keys
+// inline in the Set, without allocating, until it outgrows them (see
+// my_rbt::SmallTree); erase may then invalidate every iterator. A Filter
+// such as filter::BlockedBloom<Key> answers most misses of find and
+// contains before the tree is searched. With CacheFinger, find and
+// lower_bound start from where the previous one ended (see the finger
+// overloads), so runs of nearby keys skip most of the descent; lookups then
+// write to the set and need the same care as updates across threads.
+// Balance picks how the tree is kept shallow (see my_rbt::balance):
+// red-black by default, Avl for read-mostly sets.
+template <class Key, class Stats = my_rbt::stats::NullStats,
+          class Monoid = my_rbt::augment::None, std::size_t N = 0,
+          class Filter = filter::None, bool CacheFinger = false,
+          class Balance = my_rbt::balance::RedBlack>
 class Set {
    private:
     typedef std::vector<Key> Vector;
-    typedef my_rbt::RBTree<Key> Tree;
+    typedef std::conditional_t<
+        N == 0,
+        my_rbt::RBTree<Key, Stats, std::less<Key>,
+                       my_rbt::key_of_value::Identity, Monoid, Balance>,
+        my_rbt::SmallTree<Key, N, Stats, Monoid, Balance>>
+        Tree;
 
    public:
     typedef Key key_type;
     typedef typename Tree::iterator iterator;
     typedef typename Tree::iterator const_iterator;
+    typedef my_rbt::range::Range<Key, const_iterator> range_type;
+    typedef Stats stats_type;
+    typedef typename Monoid::value_type aggregate_type;
 
     Set();
     template <class Iterator>
@@ -38,79 +88,189 @@ class Set {
 
     void erase(iterator);
     size_t erase(const key_type&);
+    // Applies ops as if one by one in their order, and returns for each
+    // whether it changed the set. The ops are sorted by key, those on one
+    // key collapsed to its final state, and the set updated in one ordered
+    // pass: each distinct key costs a finger search from the previous one,
+    // or, for a batch over four times the size of the set, the two are
+    // merged and the tree rebuilt in O(n + m log m). If an insert throws,
+    // the ops before it in key order are applied; if the rebuild throws,
+    // the set is left empty.
+    std::vector<bool> apply_batch(std::span<const BatchOp<Key>> ops);
 
     // 4
     size_t size() const;
     bool empty() const;
 
     const_iterator find(const key_type&) const;
+    bool contains(const key_type&) const;
     const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+    // Finger search: start from finger, an iterator into this set, and cost
+    // O(log d) for a key d positions away, e.g. when merging sorted input.
+    const_iterator find(const_iterator finger, const key_type&) const;
+    const_iterator lower_bound(const_iterator finger, const key_type&) const;
+
+    // Keys in [lo, hi). Both bounds are located in O(log n); the returned
+    // view is a pair of iterators and does not allocate.
+    range_type range(const key_type& lo, const key_type& hi) const;
+    // Bulk export of [lo, hi) without per-element parent climbs.
+    template <class OutputIt>
+    OutputIt copy_range(const key_type& lo, const key_type& hi,
+                        OutputIt out) const;
+    template <class Fn>
+    Fn for_each_range(const key_type& lo, const key_type& hi, Fn fn) const;
+    // Number of keys in [lo, hi), e.g. to reserve before copy_range.
+    size_t count_range(const key_type& lo, const key_type& hi) const;
+    // Monoid::Combine over Monoid::Of of the keys in [lo, hi), in order, in
+    // O(log n). Only for sets with a Monoid.
+    aggregate_type reduce(const key_type& lo, const key_type& hi) const;
+    // Iterators from begin() to end(), ascending, that cut the set into
+    // about `pieces` runs of similar size to be scanned on separate threads
+    // (see set_parallel.h). O(pieces); a single run while keys are inline.
+    std::vector<const_iterator> split_points(std::size_t pieces) const;
+
+    // Binary snapshot: a my_stl::io::FileHeader followed by the keys in
+    // ascending order, encoded with my_stl::io::Codec<Key>.
+    void save(std::ostream&) const;
+    // Replaces the contents with a snapshot written by save(). The tree is
+    // rebuilt bottom-up in O(n); on any format or checksum error the set is
+    // left empty and std::runtime_error is thrown.
+    void load(std::istream&);
+
+    // Delimited text, formatted into large blocks (std::to_chars for
+    // arithmetic keys) instead of one stream insertion per key.
+    void write_text(std::ostream&,
+                    const io::TextFormat& format = io::TextFormat()) const;
+    // Replaces the contents with the keys of a delimited text. Input that is
+    // already ascending is bulk-built in O(n); anything else is sorted first.
+    // Throws std::runtime_error on a malformed key, leaving the set empty.
+    void read_text(std::istream&,
+                   const io::TextFormat& format = io::TextFormat());
+
+    // Counters collected by the Stats policy since construction or the last
+    // reset_stats(); all zero with the default NullStats.
+    my_rbt::stats::Counters stats() const;
+    void reset_stats();
+    // Height, black height, average depth and node count, from a walk over
+    // the whole tree.
+    my_rbt::stats::Shape shape() const;
+    // Bytes held by the set, by kind. Allocator models how allocations are
+    // rounded up (see my_stl::memory). O(1), or O(n) for keys that own heap
+    // memory per memory::KeyHeap, such as std::string.
+    template <class Allocator = memory::Malloc>
+    memory::Usage memory_usage() const;
+    // Bytes one more key like this one takes, slack included, if it gets a
+    // node of its own; what a memory::Budget is charged for it.
+    template <class Allocator = memory::Malloc>
+    static std::size_t key_footprint(const key_type&);
+    // Refills the Filter from the keys. Inserts and erases already do this
+    // once it is full or mostly stale; this is for resizing it at will.
+    void rebuild_filter();
 
-    friend std::ostream& operator<<(std::ostream& os, const Set<Key>& s) {
-        os << s.rbtree_;
+    friend std::ostream& operator<<(std::ostream& os, const Set& s) {
+        s.write_text(os);
         return os;
     }
 
    private:
+    // lower_bound from finger_, which then moves to the result.
+    const_iterator Seek(const key_type&) const;
+
     //        std::vector<Key> rbtree_;
-    my_rbt::RBTree<Key> rbtree_;
+    Tree rbtree_;
+    [[no_unique_address]] Filter filter_;
+    // Reset on every change that may free or move the key it points to.
+    [[no_unique_address]] my_rbt::finger::Cache<const_iterator, CacheFinger>
+        finger_;
 };
 
-template <class Key>
-Set<Key>::Set() : rbtree_() {}
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::Set() : rbtree_() {}
 
-template <class Key>
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
 template <class Iterator>
-Set<Key>::Set(Iterator beginInput, Iterator endInput) : rbtree_() {
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::Set(
+    Iterator beginInput, Iterator endInput)
+    : rbtree_() {
     while (beginInput != endInput) {
         insert(*beginInput);
         ++beginInput;
     }
 }
 
-template <class Key>
-typename Set<Key>::const_iterator Set<Key>::begin() const {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::begin() const {
     return rbtree_.begin();
 }
 
-template <class Key>
-typename Set<Key>::const_iterator Set<Key>::end() const {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::end() const {
     return rbtree_.end();
 }
 
-template <class Key>
-bool Set<Key>::empty() const {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+bool Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::empty() const {
     return rbtree_.IsEmpty();
 }
 
-template <class Key>
-size_t Set<Key>::size() const {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+size_t Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::size() const {
     return rbtree_.GetSize();
 }
 
-template <class Key>
-std::pair<typename Set<Key>::const_iterator, bool> Set<Key>::insert(
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+std::pair<
+    typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+                 Balance>::const_iterator,
+    bool>
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::insert(
     const Key& value) {
     std::pair<typename Tree::iterator, bool> p = rbtree_.InsertUnique(value);
+    if (p.second) {
+        if constexpr (N != 0) finger_.Reset();
+        filter_.Add(value);
+        if (filter_.NeedsRebuild(size())) rebuild_filter();
+    }
     return std::pair<iterator, bool>(p.first, p.second);
 }
 
-template <class Key>
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
 template <class Iterator>
-void Set<Key>::insert(Iterator first, Iterator last) {
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::insert(
+    Iterator first, Iterator last) {
     for (; first != last; ++first) {
         insert(*first);
     }
 }
 
-template <class Key>
-void Set<Key>::erase(typename Set<Key>::iterator position) {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::erase(
+    iterator position) {
+    filter_.Remove(*position);
+    finger_.Reset();
     rbtree_.Erase(position);
+    if (filter_.NeedsRebuild(size())) rebuild_filter();
 }
 
-template <class Key>
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
 
-size_t Set<Key>::erase(const key_type& x) {
+size_t Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::erase(
+    const key_type& x) {
     iterator i = find(x);
     if (i != rbtree_.end()) {
         erase(i);
@@ -119,43 +279,446 @@ size_t Set<Key>::erase(const key_type& x) {
     return 0;
 }
 
-template <class Key>
-void Set<Key>::clear() {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+std::vector<bool>
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::apply_batch(
+    std::span<const BatchOp<Key>> ops) {
+    std::vector<bool> changed(ops.size());
+    // Stable, so the ops on one key stay in their order.
+    std::vector<std::size_t> order(ops.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(),
+                     [&ops](std::size_t a, std::size_t b) {
+                         return ops[a].key_ < ops[b].key_;
+                     });
+    // Runs the ops of [first, last), all on one key, against whether the
+    // key was present, and returns whether it is present after them.
+    auto resolve = [&ops, &changed](auto first, auto last, bool present) {
+        for (; first != last; ++first) {
+            changed[*first] = ops[*first].insert_ != present;
+            present = ops[*first].insert_;
+        }
+        return present;
+    };
+    // End of the run of ops on the same key as *first.
+    auto run_end = [&ops, &order](auto first) {
+        const Key& key = ops[*first].key_;
+        return std::find_if(first + 1, order.end(), [&](std::size_t i) {
+            return key < ops[i].key_;
+        });
+    };
+
+    // Sorted ops make short finger searches and hinted inserts, which beat
+    // copying and rebuilding every node until the batch is several times
+    // the size of the set.
+    if (ops.size() <= 4 * size()) {
+        const_iterator finger = end();
+        for (auto run = order.begin(); run != order.end();) {
+            auto last = run_end(run);
+            const Key& key = ops[*run].key_;
+            const_iterator it = rbtree_.LowerBound(finger, key);
+            bool present = it != end() && !(key < *it);
+            bool after = resolve(run, last, present);
+            if (after && !present) {
+                if constexpr (N == 0) {
+                    // it is the key's successor, so the hint always holds.
+                    finger = rbtree_.InsertEqual(it, key);
+                    filter_.Add(key);
+                    if (filter_.NeedsRebuild(size())) rebuild_filter();
+                } else {
+                    finger = insert(key).first;
+                }
+            } else if (!after && present) {
+                finger = std::next(it);
+                erase(it);
+                // Shrinking may move the keys back inline.
+                if constexpr (N != 0) finger = end();
+            } else {
+                finger = it;
+            }
+            run = last;
+        }
+        return changed;
+    }
+
+    std::vector<Key> merged;
+    merged.reserve(size() + ops.size());
+    const_iterator it = begin();
+    const const_iterator stop = end();
+    for (auto run = order.begin(); run != order.end();) {
+        auto last = run_end(run);
+        const Key& key = ops[*run].key_;
+        for (; it != stop && *it < key; ++it) merged.push_back(*it);
+        bool present = it != stop && !(key < *it);
+        if (present) ++it;
+        if (resolve(run, last, present)) merged.push_back(key);
+        run = last;
+    }
+    for (; it != stop; ++it) merged.push_back(*it);
+
+    finger_.Reset();
+    auto next = merged.begin();
+    try {
+        rbtree_.AssignSorted(merged.size(),
+                             [&next]() { return std::move(*next++); });
+    } catch (...) {
+        clear();
+        throw;
+    }
+    rebuild_filter();
+    return changed;
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::clear() {
+    finger_.Reset();
     rbtree_.Clear();
+    filter_.Clear();
 }
 
-template <class Key>
-typename Set<Key>::const_iterator Set<Key>::find(const key_type& value) const {
-        const_iterator i(lower_bound(value));
-        if (i != end() && (value < *i)) {
-            i = end();
-        }
-        return i;
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::find(
+    const key_type& value) const {
+    if (!filter_.MayContain(value)) return end();
+    if constexpr (CacheFinger) {
+        const_iterator it = Seek(value);
+        return (it != end() && !(value < *it)) ? it : end();
+    }
+    return rbtree_.IterateTo(value);
 }
 
-template <class Key>
-typename Set<Key>::const_iterator Set<Key>::lower_bound(
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+bool Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::contains(
     const key_type& value) const {
+    return find(value) != end();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::lower_bound(
+    const key_type& value) const {
+    if constexpr (CacheFinger) return Seek(value);
     return rbtree_.LowerBound(value);
 }
 
-template <class Key>
-Set<Key>& Set<Key>::operator=(const Set& other) {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::find(
+    const_iterator finger, const key_type& value) const {
+    if (!filter_.MayContain(value)) return end();
+    return rbtree_.IterateTo(finger, value);
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::lower_bound(
+    const_iterator finger, const key_type& value) const {
+    return rbtree_.LowerBound(finger, value);
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::Seek(
+    const key_type& value) const {
+    finger_.Set(rbtree_.LowerBound(finger_.Get(), value));
+    return finger_.Get();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::const_iterator
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::upper_bound(
+    const key_type& value) const {
+    return rbtree_.UpperBound(value);
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::range_type
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::range(
+    const key_type& lo, const key_type& hi) const {
+    const_iterator first = lower_bound(lo);
+    if (!(lo < hi)) {
+        return range_type(first, first);
+    }
+    return range_type(first, lower_bound(hi));
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+template <class OutputIt>
+OutputIt Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::copy_range(
+    const key_type& lo, const key_type& hi, OutputIt out) const {
+    rbtree_.ForEachInRange(lo, hi, [&out](const key_type& key) {
+        *out = key;
+        ++out;
+    });
+    return out;
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+template <class Fn>
+Fn Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::for_each_range(
+    const key_type& lo, const key_type& hi, Fn fn) const {
+    rbtree_.ForEachInRange(lo, hi, [&fn](const key_type& key) { fn(key); });
+    return fn;
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+size_t Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::count_range(
+    const key_type& lo, const key_type& hi) const {
+    size_t count = 0;
+    rbtree_.ForEachInRange(lo, hi, [&count](const key_type&) { ++count; });
+    return count;
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+             Balance>::aggregate_type
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::reduce(
+    const key_type& lo, const key_type& hi) const {
+    return rbtree_.Reduce(lo, hi);
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+std::vector<typename Set<Key, Stats, Monoid, N, Filter, CacheFinger,
+                         Balance>::const_iterator>
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::split_points(
+    std::size_t pieces) const {
+    std::vector<const_iterator> points{begin()};
+    // A tree cut d levels down falls into about 2^d runs.
+    std::size_t depth = std::bit_width(pieces) - std::has_single_bit(pieces);
+    for (const const_iterator& it : rbtree_.SplitPoints(depth)) {
+        if (it != points.back()) points.push_back(it);
+    }
+    if (!empty()) points.push_back(end());
+    return points;
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::save(
+    std::ostream& os) const {
+    typedef my_stl::io::Codec<Key> Codec;
+
+    my_stl::io::Writer measure;
+    for (const auto& key : *this) {
+        Codec::Encode(key, measure);
+    }
+    measure.Flush();
+
+    my_stl::io::FileHeader header{};
+    std::memcpy(header.magic_, my_stl::io::kMagic, sizeof(header.magic_));
+    header.version_ = my_stl::io::kFormatVersion;
+    header.byte_order_ = my_stl::io::kByteOrderMark;
+    header.key_tag_ = Codec::kTag;
+    header.key_size_ = Codec::kSize;
+    header.count_ = size();
+    header.payload_size_ = measure.Size();
+    header.checksum_ = measure.Digest();
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    my_stl::io::Writer writer(os);
+    for (const auto& key : *this) {
+        Codec::Encode(key, writer);
+    }
+    writer.Flush();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::load(
+    std::istream& is) {
+    typedef my_stl::io::Codec<Key> Codec;
+
+    clear();
+    my_stl::io::FileHeader header{};
+    is.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (static_cast<size_t>(is.gcount()) != sizeof(header)) {
+        throw std::runtime_error("Set::load: truncated header");
+    }
+    if (std::memcmp(header.magic_, my_stl::io::kMagic,
+                    sizeof(header.magic_)) != 0 ||
+        header.version_ != my_stl::io::kFormatVersion ||
+        header.flags_ != my_stl::io::kLayoutSorted) {
+        throw std::runtime_error("Set::load: not a set snapshot");
+    }
+    if (header.byte_order_ != my_stl::io::kByteOrderMark ||
+        header.key_tag_ != Codec::kTag || header.key_size_ != Codec::kSize ||
+        (Codec::kSize != 0 && header.payload_size_ % Codec::kSize != 0)) {
+        throw std::runtime_error("Set::load: key type mismatch");
+    }
+    // Divided rather than multiplied, so a damaged count cannot wrap
+    // around to a plausible payload size.
+    if (header.count_ > header.payload_size_ / Codec::kMinSize ||
+        (Codec::kSize != 0 &&
+         header.count_ != header.payload_size_ / Codec::kSize)) {
+        throw std::runtime_error("Set::load: bad key count");
+    }
+
+    my_stl::io::Reader reader(is, header.payload_size_);
+    try {
+        rbtree_.AssignSorted(header.count_,
+                             [&reader]() { return Codec::Decode(reader); });
+        if (!reader.Exhausted() || reader.Digest() != header.checksum_) {
+            throw std::runtime_error("Set::load: checksum mismatch");
+        }
+        const_iterator prev = begin();
+        for (const_iterator it = prev; it != end(); prev = it) {
+            if (++it != end() && !(*prev < *it)) {
+                throw std::runtime_error("Set::load: keys out of order");
+            }
+        }
+        rebuild_filter();
+    } catch (...) {
+        clear();
+        throw;
+    }
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::write_text(
+    std::ostream& os, const io::TextFormat& format) const {
+    io::TextWriter writer(os);
+    for (const_iterator it = begin(); it != end();) {
+        writer.Append(*it);
+        if (++it != end() || format.trailing_delimiter_) {
+            writer.Append(format.delimiter_);
+        }
+    }
+    if (format.newline_) writer.Append(std::string_view("\n"));
+    writer.Flush();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::read_text(
+    std::istream& is, const io::TextFormat& format) {
+    clear();
+    std::vector<Key> keys;
+    io::ForEachToken(is, format, [&keys](std::string_view token) {
+        keys.push_back(io::ParseKey<Key>(token));
+    });
+
+    auto less = [](const Key& a, const Key& b) { return a < b; };
+    if (!std::is_sorted(keys.begin(), keys.end(), less)) {
+        std::sort(keys.begin(), keys.end(), less);
+    }
+    auto same = [](const Key& a, const Key& b) { return !(a < b); };
+    keys.erase(std::unique(keys.begin(), keys.end(), same), keys.end());
+
+    auto next = keys.begin();
+    rbtree_.AssignSorted(keys.size(), [&next]() { return std::move(*next++); });
+    rebuild_filter();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+my_rbt::stats::Counters
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::stats() const {
+    return rbtree_.GetStats().Snapshot();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::reset_stats() {
+    rbtree_.ResetStats();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+my_rbt::stats::Shape
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::shape() const {
+    return rbtree_.GetShape();
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+template <class Allocator>
+memory::Usage
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::memory_usage() const {
+    memory::Usage usage;
+    usage.object_ = sizeof(*this);
+    std::size_t nodes = size();
+    if constexpr (N != 0) {
+        if (rbtree_.IsInline()) nodes = 0;
+    }
+    usage.nodes_ = nodes * Tree::kNodeBytes;
+    usage.slack_ =
+        nodes * (Allocator::Footprint(Tree::kNodeBytes) - Tree::kNodeBytes);
+    usage.index_ = filter_.HeapBytes();
+    if (usage.index_ != 0) {
+        usage.slack_ += Allocator::Footprint(usage.index_) - usage.index_;
+    }
+    if constexpr (memory::KeyHeap<Key>::kOwnsHeap) {
+        for (const Key& key : *this) {
+            std::size_t bytes = memory::KeyHeap<Key>::Bytes(key);
+            usage.keys_ += bytes;
+            usage.slack_ += memory::KeyFootprint<Key, Allocator>(key) - bytes;
+        }
+    }
+    return usage;
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+template <class Allocator>
+std::size_t
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::key_footprint(
+    const key_type& key) {
+    return Allocator::Footprint(Tree::kNodeBytes) +
+           memory::KeyFootprint<Key, Allocator>(key);
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+void
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::rebuild_filter() {
+    filter_.Rebuild(begin(), end(), size());
+}
+
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>&
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::operator=(
+    const Set& other) {
+    finger_.Reset();
     rbtree_ = other.rbtree_;
+    filter_ = other.filter_;
     return *this;
 }
 
-template <class Key>
-Set<Key>::Set(std::initializer_list<key_type> list) {
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::Set(
+    std::initializer_list<key_type> list) {
     for (auto& e : list) {
-        rbtree_.Insert(e);
+        insert(e);
     }
 }
 
-template <class Key>
-Set<Key>::Set(const Set& other) {
-    for (auto it = other.begin(); it != other.end(); it++) {
-        rbtree_.Insert(*it);
-    }
-}
+template <class Key, class Stats, class Monoid, std::size_t N, class Filter,
+          bool CacheFinger, class Balance>
+Set<Key, Stats, Monoid, N, Filter, CacheFinger, Balance>::Set(const Set& other)
+    : rbtree_(other.rbtree_), filter_(other.filter_) {}
 }  // namespace my_stl
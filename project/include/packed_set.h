@@ -0,0 +1,500 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "set_memory.h"
+
+namespace my_stl {
+namespace packed {
+
+// Keys a block holds at most; a block that would exceed it is split in
+// two, and one that drops below kBlockMin is merged with a neighbour.
+constexpr std::size_t kBlockMax = 256;
+constexpr std::size_t kBlockMin = kBlockMax / 4;
+
+// A run of sorted keys after the first, the block's base, which is kept in
+// the set's index. Each key is stored as its gap to the one before, less
+// one, in `width` bits; the width is the smallest that fits the block's
+// largest gap, so keys close together take a few bits each and keys spread
+// over the whole 64-bit space take about 64 - log2(keys) bits.
+//
+// Gaps are packed back to back into 64-bit words with one spare word at
+// the end, so gap i is read with the same two loads and shifts wherever it
+// falls: unpacking has no branches and any gap can be read on its own,
+// which iterators use to step either way.
+template <class Key>
+class Block {
+   public:
+    Block() : bits_(), count_{0}, width_{0} {}
+
+    std::size_t Count() const { return count_; }
+    unsigned Width() const { return width_; }
+
+    // Replaces the contents with keys[0, n), sorted and distinct,
+    // 0 < n <= kBlockMax; keys[0] becomes the base.
+    void Encode(const Key* keys, std::size_t n);
+    // Writes the Count() keys from base on into out.
+    void Decode(Key base, Key* out) const;
+    // Gap between keys i and i + 1, for i + 1 < Count().
+    Key Gap(std::size_t i) const;
+    // Position of the first key not less than key, and that key, or
+    // Count() if there is none.
+    std::size_t LowerBound(Key base, Key key, Key& found) const;
+    Key Last(Key base) const;
+
+    std::size_t HeapBytes() const;
+    template <class Allocator>
+    std::size_t HeapFootprint() const;
+
+   private:
+    std::vector<std::uint64_t> bits_;
+    std::uint16_t count_;
+    std::uint8_t width_;
+};
+
+template <class Key>
+void Block<Key>::Encode(const Key* keys, std::size_t n) {
+    std::uint64_t widest = 0;
+    for (std::size_t i = 1; i < n; ++i) {
+        widest |= std::uint64_t{keys[i]} - keys[i - 1] - 1;
+    }
+    unsigned width = static_cast<unsigned>(std::bit_width(widest));
+    // Re-encoding reuses the words already held, growing them by half at a
+    // time, so most inserts and erases allocate nothing. They are given back
+    // once they are more than twice what the keys need, e.g. after a split.
+    std::size_t words = width == 0 ? 0 : ((n - 1) * width + 63) / 64 + 1;
+    std::size_t capacity = bits_.capacity();
+    if (capacity > 2 * words) {
+        std::vector<std::uint64_t>().swap(bits_);
+    } else if (capacity < words) {
+        bits_.reserve(std::max(words, capacity + capacity / 2));
+    }
+    bits_.assign(words, 0);
+    for (std::size_t i = 1; i < n && width != 0; ++i) {
+        std::uint64_t gap = std::uint64_t{keys[i]} - keys[i - 1] - 1;
+        std::size_t at = (i - 1) * width;
+        unsigned shift = at & 63;
+        bits_[at >> 6] |= gap << shift;
+        bits_[(at >> 6) + 1] |= gap >> 1 >> (63 - shift);
+    }
+    count_ = static_cast<std::uint16_t>(n);
+    width_ = static_cast<std::uint8_t>(width);
+}
+
+template <class Key>
+Key Block<Key>::Gap(std::size_t i) const {
+    if (width_ == 0) return 1;
+    std::size_t at = i * width_;
+    unsigned shift = at & 63;
+    std::uint64_t mask = ~std::uint64_t{0} >> (64 - width_);
+    std::uint64_t low = bits_[at >> 6] >> shift;
+    std::uint64_t high = bits_[(at >> 6) + 1] << 1 << (63 - shift);
+    return static_cast<Key>(((low | high) & mask) + 1);
+}
+
+template <class Key>
+void Block<Key>::Decode(Key base, Key* out) const {
+    out[0] = base;
+    for (std::size_t i = 1; i < count_; ++i) {
+        out[i] = static_cast<Key>(out[i - 1] + Gap(i - 1));
+    }
+}
+
+template <class Key>
+std::size_t Block<Key>::LowerBound(Key base, Key key, Key& found) const {
+    Key value = base;
+    for (std::size_t i = 0;; ++i) {
+        if (!(value < key)) {
+            found = value;
+            return i;
+        }
+        if (i + 1 == count_) return count_;
+        value = static_cast<Key>(value + Gap(i));
+    }
+}
+
+template <class Key>
+Key Block<Key>::Last(Key base) const {
+    Key value = base;
+    for (std::size_t i = 0; i + 1 < count_; ++i) {
+        value = static_cast<Key>(value + Gap(i));
+    }
+    return value;
+}
+
+template <class Key>
+std::size_t Block<Key>::HeapBytes() const {
+    return bits_.capacity() * sizeof(std::uint64_t);
+}
+
+template <class Key>
+template <class Allocator>
+std::size_t Block<Key>::HeapFootprint() const {
+    std::size_t bytes = HeapBytes();
+    return bytes == 0 ? 0 : Allocator::Footprint(bytes);
+}
+}  // namespace packed
+
+// Ordered set of unsigned integers, kept as delta-compressed blocks of up
+// to packed::kBlockMax sorted keys (see packed::Block) behind an index of
+// the blocks' first keys. Meant for large sets spread thinly over a wide
+// key space, e.g. 64-bit ids, where a tree spends most of its memory on
+// links and RoaringSet's chunks each hold a key or two.
+//
+// Reads binary-search the index and scan one block, decoding as they go.
+// insert and erase decode the block a key falls in and re-encode it, so
+// they cost a block's worth of work, and reuse the block's words rather
+// than allocating, unless the block splits or merges.
+// Keys built from a range fill whole blocks; inserted keys leave them
+// between half and fully used. Iteration is ordered and bidirectional;
+// iterators hand out keys by value and any insert or erase invalidates
+// them.
+template <class Key = std::uint64_t>
+class PackedSet {
+    static_assert(std::is_unsigned_v<Key> && sizeof(Key) <= 8,
+                  "PackedSet holds unsigned integers of up to 64 bits");
+
+   public:
+    typedef Key key_type;
+    class const_iterator;
+    typedef const_iterator iterator;
+
+    PackedSet();
+    template <class Iterator>
+    PackedSet(Iterator, Iterator);
+    PackedSet(std::initializer_list<key_type> list);
+
+    void clear();
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    std::pair<const_iterator, bool> insert(const key_type&);
+    template <class Iterator>
+    void insert(Iterator, Iterator);
+    void erase(iterator);
+    size_t erase(const key_type&);
+
+    size_t size() const;
+    bool empty() const;
+
+    const_iterator find(const key_type&) const;
+    bool contains(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+
+    // As Set::memory_usage. The index and block headers are reported as
+    // index_, the packed gaps as keys_.
+    template <class Allocator = memory::Malloc>
+    memory::Usage memory_usage() const;
+
+   private:
+    typedef packed::Block<Key> block_type;
+    typedef std::array<Key, 2 * packed::kBlockMax> buffer_type;
+
+    // The block key would be in: the last whose base is not greater.
+    std::size_t BlockIndex(const key_type& key) const;
+    // Replaces blocks [first, last) with keys[0, n), in as many blocks as
+    // it takes, and returns how many that is.
+    std::size_t Rebuild(std::size_t first, std::size_t last, const Key* keys,
+                        std::size_t n);
+
+    std::vector<Key> bases_;
+    std::vector<block_type> blocks_;
+    std::size_t size_;
+};
+
+// Bidirectional iterator: a block, a position in it and the key there.
+template <class Key>
+class PackedSet<Key>::const_iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef Key value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Key* pointer;
+    typedef Key reference;
+
+    const_iterator() : owner_{nullptr}, block_{0}, index_{0}, value_{} {}
+
+    Key operator*() const { return value_; }
+    const_iterator& operator++() {
+        const block_type& block = owner_->blocks_[block_];
+        if (index_ + 1 < block.Count()) {
+            value_ = static_cast<Key>(value_ + block.Gap(index_++));
+        } else {
+            index_ = 0;
+            if (++block_ < owner_->blocks_.size()) {
+                value_ = owner_->bases_[block_];
+            }
+        }
+        return *this;
+    }
+    const_iterator operator++(int) {
+        const_iterator tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+    const_iterator& operator--() {
+        if (index_ > 0) {
+            const block_type& block = owner_->blocks_[block_];
+            value_ = static_cast<Key>(value_ - block.Gap(--index_));
+        } else {
+            const block_type& block = owner_->blocks_[--block_];
+            index_ = block.Count() - 1;
+            value_ = block.Last(owner_->bases_[block_]);
+        }
+        return *this;
+    }
+    const_iterator operator--(int) {
+        const_iterator tmp(*this);
+        --(*this);
+        return tmp;
+    }
+    bool operator==(const const_iterator& other) const {
+        return block_ == other.block_ && index_ == other.index_;
+    }
+    bool operator!=(const const_iterator& other) const {
+        return !(*this == other);
+    }
+
+   private:
+    friend class PackedSet;
+    const_iterator(const PackedSet* owner, std::size_t block,
+                   std::size_t index, Key value)
+        : owner_{owner}, block_{block}, index_{index}, value_{value} {}
+
+    const PackedSet* owner_;
+    std::size_t block_;
+    std::size_t index_;
+    Key value_;
+};
+
+template <class Key>
+PackedSet<Key>::PackedSet() : bases_(), blocks_(), size_{0} {}
+
+template <class Key>
+template <class Iterator>
+PackedSet<Key>::PackedSet(Iterator first, Iterator last)
+    : bases_(), blocks_(), size_{0} {
+    std::vector<Key> keys(first, last);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    // Full blocks, the last one short.
+    for (std::size_t i = 0; i < keys.size(); i += packed::kBlockMax) {
+        std::size_t n = std::min(packed::kBlockMax, keys.size() - i);
+        bases_.push_back(keys[i]);
+        blocks_.emplace_back();
+        blocks_.back().Encode(keys.data() + i, n);
+    }
+    size_ = keys.size();
+}
+
+template <class Key>
+PackedSet<Key>::PackedSet(std::initializer_list<key_type> list)
+    : PackedSet(list.begin(), list.end()) {}
+
+template <class Key>
+void PackedSet<Key>::clear() {
+    bases_.clear();
+    blocks_.clear();
+    size_ = 0;
+}
+
+template <class Key>
+typename PackedSet<Key>::const_iterator PackedSet<Key>::begin() const {
+    return const_iterator(this, 0, 0, bases_.empty() ? Key() : bases_[0]);
+}
+
+template <class Key>
+typename PackedSet<Key>::const_iterator PackedSet<Key>::end() const {
+    return const_iterator(this, blocks_.size(), 0, Key());
+}
+
+template <class Key>
+std::size_t PackedSet<Key>::BlockIndex(const key_type& key) const {
+    std::size_t after = static_cast<std::size_t>(
+        std::upper_bound(bases_.begin(), bases_.end(), key) - bases_.begin());
+    return after == 0 ? 0 : after - 1;
+}
+
+template <class Key>
+std::size_t PackedSet<Key>::Rebuild(std::size_t first, std::size_t last,
+                                    const Key* keys, std::size_t n) {
+    // Even parts of at most kBlockMax keys.
+    std::size_t parts = (n + packed::kBlockMax - 1) / packed::kBlockMax;
+    if (parts < last - first) {
+        bases_.erase(bases_.begin() + first + parts, bases_.begin() + last);
+        blocks_.erase(blocks_.begin() + first + parts, blocks_.begin() + last);
+    } else if (parts > last - first) {
+        std::size_t more = parts - (last - first);
+        bases_.insert(bases_.begin() + last, more, Key());
+        blocks_.insert(blocks_.begin() + last, more, block_type());
+    }
+    for (std::size_t i = 0, begin = 0; i < parts; ++i) {
+        std::size_t end = n * (i + 1) / parts;
+        bases_[first + i] = keys[begin];
+        blocks_[first + i].Encode(keys + begin, end - begin);
+        begin = end;
+    }
+    return parts;
+}
+
+template <class Key>
+std::pair<typename PackedSet<Key>::const_iterator, bool>
+PackedSet<Key>::insert(const key_type& key) {
+    if (blocks_.empty()) {
+        bases_.push_back(key);
+        blocks_.emplace_back();
+        blocks_.back().Encode(&key, 1);
+        size_ = 1;
+        return std::pair<const_iterator, bool>(begin(), true);
+    }
+    std::size_t b = BlockIndex(key);
+    const block_type& block = blocks_[b];
+    Key found{};
+    std::size_t at = block.LowerBound(bases_[b], key, found);
+    if (at != block.Count() && found == key) {
+        return std::pair<const_iterator, bool>(
+            const_iterator(this, b, at, key), false);
+    }
+
+    buffer_type keys;
+    std::size_t n = block.Count();
+    block.Decode(bases_[b], keys.data());
+    std::copy_backward(keys.data() + at, keys.data() + n,
+                       keys.data() + n + 1);
+    keys[at] = key;
+    ++n;
+    if (n <= packed::kBlockMax) {
+        bases_[b] = keys[0];
+        blocks_[b].Encode(keys.data(), n);
+    } else if (Rebuild(b, b + 1, keys.data(), n) > 1 && at >= n / 2) {
+        at -= n / 2;
+        ++b;
+    }
+    ++size_;
+    return std::pair<const_iterator, bool>(const_iterator(this, b, at, key),
+                                           true);
+}
+
+template <class Key>
+template <class Iterator>
+void PackedSet<Key>::insert(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+        insert(*first);
+    }
+}
+
+template <class Key>
+void PackedSet<Key>::erase(iterator position) {
+    erase(*position);
+}
+
+template <class Key>
+size_t PackedSet<Key>::erase(const key_type& key) {
+    if (blocks_.empty()) return 0;
+    std::size_t b = BlockIndex(key);
+    Key found{};
+    std::size_t at = blocks_[b].LowerBound(bases_[b], key, found);
+    if (at == blocks_[b].Count() || found != key) return 0;
+    --size_;
+    if (blocks_[b].Count() == 1) {
+        bases_.erase(bases_.begin() + b);
+        blocks_.erase(blocks_.begin() + b);
+        return 1;
+    }
+
+    // Joined with a neighbour when small, rebalanced if that overfills.
+    buffer_type keys;
+    std::size_t first = b;
+    std::size_t n = 0;
+    if (blocks_[b].Count() - 1 < packed::kBlockMin && blocks_.size() > 1) {
+        if (b > 0) --first;
+        n = blocks_[first].Count();
+        blocks_[first].Decode(bases_[first], keys.data());
+    }
+    std::size_t last = n == 0 ? b + 1 : first + 2;
+    for (std::size_t i = n == 0 ? b : first + 1; i < last; ++i) {
+        blocks_[i].Decode(bases_[i], keys.data() + n);
+        n += blocks_[i].Count();
+    }
+    Key* gone = std::lower_bound(keys.data(), keys.data() + n, key);
+    std::copy(gone + 1, keys.data() + n, gone);
+    Rebuild(first, last, keys.data(), n - 1);
+    return 1;
+}
+
+template <class Key>
+size_t PackedSet<Key>::size() const {
+    return size_;
+}
+
+template <class Key>
+bool PackedSet<Key>::empty() const {
+    return size_ == 0;
+}
+
+template <class Key>
+typename PackedSet<Key>::const_iterator PackedSet<Key>::find(
+    const key_type& key) const {
+    const_iterator it = lower_bound(key);
+    return (it != end() && *it == key) ? it : end();
+}
+
+template <class Key>
+bool PackedSet<Key>::contains(const key_type& key) const {
+    if (blocks_.empty()) return false;
+    std::size_t b = BlockIndex(key);
+    Key found{};
+    std::size_t at = blocks_[b].LowerBound(bases_[b], key, found);
+    return at != blocks_[b].Count() && found == key;
+}
+
+template <class Key>
+typename PackedSet<Key>::const_iterator PackedSet<Key>::lower_bound(
+    const key_type& key) const {
+    if (blocks_.empty()) return end();
+    std::size_t b = BlockIndex(key);
+    Key found{};
+    std::size_t at = blocks_[b].LowerBound(bases_[b], key, found);
+    if (at != blocks_[b].Count()) return const_iterator(this, b, at, found);
+    if (++b == blocks_.size()) return end();
+    return const_iterator(this, b, 0, bases_[b]);
+}
+
+template <class Key>
+typename PackedSet<Key>::const_iterator PackedSet<Key>::upper_bound(
+    const key_type& key) const {
+    const_iterator it = lower_bound(key);
+    if (it != end() && *it == key) ++it;
+    return it;
+}
+
+template <class Key>
+template <class Allocator>
+memory::Usage PackedSet<Key>::memory_usage() const {
+    memory::Usage usage;
+    usage.object_ = sizeof(*this);
+    for (std::size_t bytes : {bases_.capacity() * sizeof(Key),
+                              blocks_.capacity() * sizeof(block_type)}) {
+        if (bytes == 0) continue;
+        usage.index_ += bytes;
+        usage.slack_ += Allocator::Footprint(bytes) - bytes;
+    }
+    for (const block_type& block : blocks_) {
+        std::size_t bytes = block.HeapBytes();
+        usage.keys_ += bytes;
+        usage.slack_ += block.template HeapFootprint<Allocator>() - bytes;
+    }
+    return usage;
+}
+}  // namespace my_stl
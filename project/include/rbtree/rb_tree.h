@@ -1,39 +1,126 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "rbt_augment.h"
+#include "rbt_balance.h"
 #include "rbt_const_iterator.h"
+#include "rbt_key_of_value.h"
+#include "rbt_prefix.h"
+#include "rbt_stats.h"
 
 namespace my_rbt {
 
-template <typename T>
+// Binary search tree core: search, linking, iteration, bulk builds and
+// subtree aggregates. Balance (see rbt_balance.h) restores the shape after
+// each update; the default, and the class name, is red-black. Keys such as
+// std::string ordered by std::less also have a prefix cached in every node
+// (see rbt_prefix.h), so most search steps do not read the key.
+template <typename T, typename Stats = my_rbt::stats::NullStats,
+          typename Compare = std::less<T>,
+          typename KeyOfValue = my_rbt::key_of_value::Identity,
+          typename Augment = my_rbt::augment::None,
+          typename Balance = my_rbt::balance::RedBlack>
 class RBTree {
    public:
-    typedef T key_type;
-    typedef T& key_ref;
-    typedef const T& const_key_ref;
+    // Nodes hold a T; lookups and ordering only see KeyOfValue()(T).
+    typedef T value_type;
+    typedef const T& const_value_ref;
+    typedef std::remove_cvref_t<
+        std::invoke_result_t<const KeyOfValue&, const T&>>
+        key_type;
+    typedef key_type& key_ref;
+    typedef const key_type& const_key_ref;
     typedef my_rbt::rb_node::RBNode<T> node_type;
     typedef my_rbt::rb_node::RBNode<T>* node_ptr;
     typedef my_rbt::iterator::ConstIterator<T> iterator;
+    typedef Stats stats_type;
+    typedef Compare key_compare;
+    // Monoid value cached per subtree; void for augment::None.
+    typedef typename Augment::value_type aggregate_type;
+    static constexpr bool kAugmented =
+        !std::is_same_v<Augment, my_rbt::augment::None>;
+    // Whether nodes cache a prefix of their key, see rbt_prefix.h.
+    static constexpr bool kPrefixed =
+        my_rbt::prefix::Traits<key_type>::kEnabled &&
+        (std::is_same_v<Compare, std::less<key_type>> ||
+         std::is_same_v<Compare, std::less<>>);
 
    private:
+    typedef my_rbt::prefix::Traits<key_type> prefix_traits;
+    typedef std::conditional_t<kAugmented,
+                               my_rbt::augment::Node<T, Augment>,
+                               my_rbt::rb_node::RBNode<T>>
+        unprefixed_type;
+    // Allocated type of every node; node_ptr still points at the RBNode base.
+    typedef std::conditional_t<
+        kPrefixed, my_rbt::prefix::Node<unprefixed_type, prefix_traits>,
+        unprefixed_type>
+        alloc_type;
+    // A searched key with its prefix, computed once per search; the prefix
+    // is unused unless kPrefixed.
+    struct Probe {
+        const_key_ref key_;
+        typename prefix_traits::value_type prefix_;
+    };
+
+    bool Less(const_key_ref, const_key_ref) const;
+    // Less between a node's key and a probe. In a prefixed tree, nodes
+    // whose prefix differs from the probe's are ordered without reading
+    // their key.
+    bool Less(node_ptr, const Probe&) const;
+    bool Less(const Probe&, node_ptr) const;
+    Probe MakeProbe(const_key_ref) const;
+    // Caches the prefix of a node's key; no-ops unless kPrefixed.
+    void Stamp(node_ptr) const;
+    // Stamps a node just linked in, or every node if its key shortens the
+    // prefix all keys share.
+    void StampAttached(node_ptr);
+    void StampAll();
+    static const_key_ref KeyOf(node_ptr);
+    // Allocates a node holding a value built from args.
+    template <typename... Args>
+    node_ptr NewNode(Args&&... args);
     size_t Size(node_ptr);
+    // Recompute the cached aggregate of one node, or of every node from n up
+    // to the root; no-ops for augment::None.
+    static void Refresh(node_ptr n);
+    static void RefreshPath(node_ptr n);
     void RotateLeft(node_ptr);
     void RotateRight(node_ptr);
-    void FixInsert(node_ptr);
-    void FixRemove(node_ptr);
+    void RemoveNode(node_ptr);
+    void ReplaceChild(node_ptr, node_ptr);
     void DeleteNodes(node_ptr);
-    void Copy(node_ptr);
+    node_ptr CloneNodes(node_ptr, node_ptr);
     void DropNode(node_ptr);
+    // Builds a node in place from args and links it under parent.
+    template <typename... Args>
+    iterator Attach(node_ptr parent, bool left, Args&&... args);
+    template <typename Generator>
+    node_ptr BuildSorted(std::size_t n, std::size_t depth,
+                         std::size_t red_depth, Generator& next);
 
    public:
+    // Bytes of one node as allocated, key included.
+    static constexpr std::size_t kNodeBytes = sizeof(alloc_type);
+
     RBTree();
+    explicit RBTree(const Compare&);
     RBTree(std::initializer_list<T>);
     template <typename Iterator>
     RBTree(Iterator, Iterator);
+    // Copies the structure and colours node for node, O(n).
+    RBTree(const RBTree&);
     ~RBTree();
-    RBTree& operator=(const RBTree<T>&);
+    RBTree& operator=(const RBTree&);
     RBTree& operator=(const std::initializer_list<T>&);
 
     node_ptr GetRoot() const;
@@ -42,13 +129,28 @@ class RBTree {
     [[nodiscard]] bool IsEmpty() const;
 
     void Clear();
+    // Replaces the contents with n keys pulled in ascending order from
+    // next(). Builds a balanced tree in O(n) without comparing keys, so the
+    // caller guarantees the sequence is strictly increasing.
+    template <typename Generator>
+    void AssignSorted(std::size_t n, Generator&& next);
     node_ptr MaxNode() const;
     iterator MaxIter();
     node_ptr MinNode() const;
     iterator MinIter();
-    iterator Insert(const_key_ref);
+    iterator Insert(const_value_ref);
     void Insert(iterator first, iterator last);
-    std::pair<iterator, bool> InsertUnique(const_key_ref&);
+    std::pair<iterator, bool> InsertUnique(const_value_ref);
+    // Looks key up once; only if it is absent is a node built from args,
+    // which must produce a value whose key equals key.
+    template <typename... Args>
+    std::pair<iterator, bool> TryEmplace(const_key_ref key, Args&&... args);
+    // Inserts even if equal keys are present, after the last of them, so
+    // equal keys keep their insertion order.
+    iterator InsertEqual(const_value_ref);
+    // As InsertEqual, placed right before hint when that keeps the order;
+    // amortised O(1) then, O(log n) otherwise.
+    iterator InsertEqual(iterator hint, const_value_ref);
     bool Find(const_key_ref);
 
     explicit operator bool() const;
@@ -60,72 +162,311 @@ class RBTree {
     bool Remove(const_key_ref);
     iterator Erase(iterator pos);
     iterator Erase(iterator first, iterator last);
+    // Removes every key equal to the argument, O(log n + k).
     std::size_t Erase(const_key_ref);
+    node_ptr LowerBoundNode(const_key_ref) const;
+    node_ptr UpperBoundNode(const_key_ref) const;
     iterator LowerBound(const_key_ref) const;
-
-    friend std::ostream& operator<<(std::ostream& os, const RBTree<T>& tree) {
+    iterator UpperBound(const_key_ref) const;
+    // Finger search: as above, but starting from finger, a position in this
+    // tree, and climbing only as far as the key needs. A key d ranks away
+    // costs O(log d) steps instead of O(log n); end() searches from the root.
+    node_ptr LowerBoundNode(node_ptr finger, const_key_ref) const;
+    iterator LowerBound(iterator finger, const_key_ref) const;
+    iterator IterateTo(iterator finger, const_key_ref) const;
+    // [LowerBound, UpperBound) of the key, O(log n).
+    std::pair<iterator, iterator> EqualRange(const_key_ref) const;
+    // Number of keys equal to the argument, O(log n + k).
+    std::size_t Count(const_key_ref) const;
+    const Compare& KeyComp() const;
+
+    // In-order walk over [lo, hi) driven by an explicit stack of pending
+    // ancestors, so no step climbs parent pointers.
+    template <typename Fn>
+    void ForEachInRange(const_key_ref lo, const_key_ref hi, Fn&& fn) const;
+    // The nodes less than depth levels below the root, in key order. They
+    // cut the tree into runs that each hold about one subtree at that
+    // depth, for walking from separate threads. O(2^depth).
+    std::vector<iterator> SplitPoints(std::size_t depth) const;
+
+    const Stats& GetStats() const;
+    void ResetStats();
+    // Walks the whole tree, O(n).
+    my_rbt::stats::Shape GetShape() const;
+
+    // Aggregate of the subtree under n, Augment::Identity() for null. Only
+    // for augmented trees, as are the members below.
+    static aggregate_type Aggregate(node_ptr n);
+    // Combine of Augment::Of over the values with keys in [lo, hi), in key
+    // order. Touches O(log n) nodes: whole subtrees contribute their cache.
+    aggregate_type Reduce(const_key_ref lo, const_key_ref hi) const;
+
+    friend std::ostream& operator<<(std::ostream& os, const RBTree& tree) {
         for (auto it = tree.begin(); it != tree.end(); ++it) {
             os << *it << ", ";
         }
-        os << std::endl;
+        os << '\n';
         return os;
     }
 
    private:
+    // Rebalancing after an insert or erase, and the meaning of color_.
+    friend Balance;
+
     size_t size_;
     node_ptr root_;
+    // Lookups are const but still counted.
+    [[no_unique_address]] mutable Stats stats_;
+    [[no_unique_address]] Compare compare_;
+    [[no_unique_address]] my_rbt::prefix::Offset<kPrefixed> prefix_offset_;
 };
 
-template <typename T>
-RBTree<T>::RBTree() : size_{0}, root_{nullptr} {}
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RBTree()
+    : size_{0}, root_{nullptr}, stats_(), compare_() {}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RBTree(
+    const Compare& compare)
+    : size_{0}, root_{nullptr}, stats_(), compare_(compare) {}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RBTree(
+    const RBTree& tree)
+    : size_{0},
+      root_{nullptr},
+      stats_(),
+      compare_(tree.compare_),
+      prefix_offset_(tree.prefix_offset_) {
+    root_ = CloneNodes(tree.root_, nullptr);
+}
 
-template <typename T>
-RBTree<T>::RBTree(std::initializer_list<T> init) : size_{0} {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RBTree(
+    std::initializer_list<T> init)
+    : size_{0}, root_{nullptr}, stats_(), compare_() {
     for (auto& e : init) {
         Insert(e);
     }
 }
 
-template <typename T>
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
 template <typename Iterator>
-RBTree<T>::RBTree(Iterator first, Iterator last) : size_{0} {
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RBTree(Iterator first,
+                                                       Iterator last)
+    : size_{0}, root_{nullptr}, stats_(), compare_() {
     for (auto it = first; it != last; it++) {
         Insert(*it);
     }
 }
 
-template <typename T>
-void RBTree<T>::Copy(RBTree::node_ptr in) {
-    if (in) {
-        Insert(in->key_);
-        Copy(in->left_);
-        Copy(in->right_);
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::CloneNodes(node_ptr in,
+                                                           node_ptr parent) {
+    if (in == nullptr) return nullptr;
+
+    node_ptr clone = NewNode(in->key_);
+    if constexpr (kPrefixed) {
+        static_cast<alloc_type*>(clone)->prefix_ =
+            static_cast<alloc_type*>(in)->prefix_;
+    }
+    size_++;
+    clone->color_ = in->color_;
+    clone->parent_ = parent;
+    try {
+        clone->left_ = CloneNodes(in->left_, clone);
+        clone->right_ = CloneNodes(in->right_, clone);
+    } catch (...) {
+        DeleteNodes(clone);
+        throw;
+    }
+    Refresh(clone);
+    return clone;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::DropNode(node_ptr n) {
+    stats_.OnFree();
+    delete static_cast<alloc_type*>(n);
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+bool RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Less(
+    const_key_ref a, const_key_ref b) const {
+    stats_.OnCompare();
+    return compare_(a, b);
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+bool RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Less(
+    node_ptr n, const Probe& x) const {
+    if constexpr (kPrefixed) {
+        auto prefix = static_cast<alloc_type*>(n)->prefix_;
+        if (prefix != x.prefix_) {
+            stats_.OnCompare();
+            return prefix < x.prefix_;
+        }
+    }
+    return Less(KeyOf(n), x.key_);
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+bool RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Less(
+    const Probe& x, node_ptr n) const {
+    if constexpr (kPrefixed) {
+        auto prefix = static_cast<alloc_type*>(n)->prefix_;
+        if (prefix != x.prefix_) {
+            stats_.OnCompare();
+            return x.prefix_ < prefix;
+        }
+    }
+    return Less(x.key_, KeyOf(n));
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Probe
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::MakeProbe(
+    const_key_ref key) const {
+    if constexpr (kPrefixed) {
+        typedef typename prefix_traits::value_type value_type;
+        if (root_ == nullptr) return Probe{key, 0};
+        // A key outside the shared prefix orders like it against every
+        // key; the extreme values leave only ties to compare in full.
+        std::size_t offset = prefix_offset_.value_;
+        int order = prefix_traits::Compare(key, KeyOf(root_), offset);
+        if (order < 0) return Probe{key, 0};
+        if (order > 0) {
+            return Probe{key, std::numeric_limits<value_type>::max()};
+        }
+        return Probe{key, prefix_traits::Of(key, offset)};
+    } else {
+        return Probe{key, {}};
     }
 }
 
-template <typename T>
-void RBTree<T>::DropNode(node_ptr n) {
-    n->~RBNode();
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Stamp(
+    node_ptr n) const {
+    if constexpr (kPrefixed) {
+        static_cast<alloc_type*>(n)->prefix_ =
+            prefix_traits::Of(KeyOf(n), prefix_offset_.value_);
+    }
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::StampAttached(
+    node_ptr n) {
+    if constexpr (kPrefixed) {
+        if (n == root_) {
+            prefix_offset_.value_ = my_rbt::prefix::kMaxOffset;
+        } else {
+            std::size_t common = prefix_traits::Common(
+                KeyOf(n), KeyOf(root_), prefix_offset_.value_);
+            if (common < prefix_offset_.value_) {
+                prefix_offset_.value_ = common;
+                StampAll();
+                return;
+            }
+        }
+        Stamp(n);
+    }
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::StampAll() {
+    if constexpr (kPrefixed) {
+        node_ptr min = MinNode();
+        if (min == nullptr) return;
+        prefix_offset_.value_ = std::min(
+            prefix_offset_.value_,
+            prefix_traits::Common(KeyOf(min), KeyOf(MaxNode()),
+                                  my_rbt::prefix::kMaxOffset));
+        for (node_ptr n = min; n != nullptr; n = n->getNext()) Stamp(n);
+    }
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+template <typename... Args>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::NewNode(
+    Args&&... args) {
+    alloc_type* node =
+        new alloc_type(std::in_place, std::forward<Args>(args)...);
+    stats_.OnAlloc();
+    return node;
 }
 
-template <typename T>
-RBTree<T>::~RBTree() {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::const_key_ref
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::KeyOf(node_ptr n) {
+    return KeyOfValue()(n->key_);
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Refresh(node_ptr n) {
+    if constexpr (kAugmented) {
+        static_cast<alloc_type*>(n)->sum_ = Augment::Combine(
+            Augment::Combine(Aggregate(n->left_), Augment::Of(n->key_)),
+            Aggregate(n->right_));
+    }
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RefreshPath(
+    node_ptr n) {
+    if constexpr (kAugmented) {
+        for (; n != nullptr; n = n->parent_) Refresh(n);
+    }
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::~RBTree() {
     Clear();
 }
 
-template <typename T>
-RBTree<T>& RBTree<T>::operator=(const RBTree<T>& tree) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>&
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::operator=(
+    const RBTree& tree) {
     if (this != &tree) {
-        DeleteNodes(root_);
-        root_ = nullptr;
-        Copy(tree.root_);
+        Clear();
+        compare_ = tree.compare_;
+        prefix_offset_ = tree.prefix_offset_;
+        root_ = CloneNodes(tree.root_, nullptr);
     }
 
     return *this;
 }
 
-template <typename T>
-RBTree<T>& RBTree<T>::operator=(const std::initializer_list<T>& init) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>&
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::operator=(
+    const std::initializer_list<T>& init) {
     DeleteNodes(root_);
     root_ = nullptr;
     for (auto& e : init) {
@@ -134,54 +475,127 @@ RBTree<T>& RBTree<T>::operator=(const std::initializer_list<T>& init) {
     return *this;
 }
 
-template <typename T>
-typename RBTree<T>::node_ptr RBTree<T>::GetRoot() const {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::GetRoot() const {
     return root_;
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::Root() {
-    return iterator(root_);
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Root() {
+    return iterator(root_, &root_);
 }
 
-template <typename T>
-size_t RBTree<T>::GetSize() const {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+size_t
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::GetSize() const {
     return size_;
 }
 
-template <typename T>
-[[nodiscard]] bool RBTree<T>::IsEmpty() const {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+[[nodiscard]] bool
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::IsEmpty() const {
     return (root_ == nullptr && size_ == 0);
 }
 
-template <typename T>
-void RBTree<T>::Clear() {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Clear() {
     DeleteNodes(root_);
     root_ = nullptr;
 }
 
-template <typename T>
-typename RBTree<T>::node_ptr RBTree<T>::MaxNode() const {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+template <typename Generator>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::AssignSorted(
+    std::size_t n, Generator&& next) {
+    Clear();
+
+    // Splitting at the midpoint fills every level above floor(log2(n + 1));
+    // colouring only that partial bottom level red keeps black heights equal.
+    std::size_t red_depth =
+        static_cast<std::size_t>(std::bit_width(n + 1)) - 1;
+
+    root_ = BuildSorted(n, 0, red_depth, next);
+    if constexpr (kPrefixed) {
+        prefix_offset_.value_ = my_rbt::prefix::kMaxOffset;
+        StampAll();
+    }
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+template <typename Generator>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::BuildSorted(
+    std::size_t n, std::size_t depth, std::size_t red_depth, Generator& next) {
+    if (n == 0) return nullptr;
+
+    std::size_t left_size = (n - 1) / 2;
+    node_ptr left = BuildSorted(left_size, depth + 1, red_depth, next);
+    node_ptr node = nullptr;
+    node_ptr right = nullptr;
+    try {
+        node = NewNode(next());
+        size_++;
+        right = BuildSorted(n - 1 - left_size, depth + 1, red_depth, next);
+    } catch (...) {
+        DeleteNodes(left);
+        if (node != nullptr) {
+            DropNode(node);
+            size_--;
+        }
+        throw;
+    }
+
+    node->left_ = left;
+    node->right_ = right;
+    if (left != nullptr) left->parent_ = node;
+    if (right != nullptr) right->parent_ = node;
+    Balance::Build(node, depth == red_depth);
+    Refresh(node);
+    return node;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::MaxNode() const {
     return (IsEmpty() ? nullptr : root_->getMax());
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::MaxIter() {
-    return iterator(MaxNode());
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::MaxIter() {
+    return iterator(MaxNode(), &root_);
 }
 
-template <typename T>
-typename RBTree<T>::node_ptr RBTree<T>::MinNode() const {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::MinNode() const {
     return (IsEmpty() ? nullptr : root_->getMin());
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::MinIter() {
-    return iterator(MinNode());
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::MinIter() {
+    return iterator(MinNode(), &root_);
 }
 
-template <typename T>
-void RBTree<T>::DeleteNodes(node_ptr in) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::DeleteNodes(
+    node_ptr in) {
     if (in) {
         while (in != 0) {
             DeleteNodes(in->right_);
@@ -193,94 +607,128 @@ void RBTree<T>::DeleteNodes(node_ptr in) {
     }
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::Insert(const_key_ref input) {
-    node_ptr q;
-    auto* create = new my_rbt::rb_node::RBNode<T>(input);
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Insert(
+    const_value_ref input) {
+    std::pair<iterator, bool> inserted = TryEmplace(KeyOfValue()(input), input);
+    return inserted.second ? inserted.first : end();
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+template <typename... Args>
+std::pair<
+    typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator,
+    bool>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::TryEmplace(
+    const_key_ref key, Args&&... args) {
+    node_ptr q = nullptr;
     auto p = root_;
-    q = nullptr;
+    bool left = false;
+    std::size_t path = 0;
+    const Probe probe = MakeProbe(key);
+
+    while (p != nullptr) {
+        q = p;
+        ++path;
+        if (Less(probe, p)) {
+            left = true;
+            p = p->left_;
+        } else if (Less(p, probe)) {
+            left = false;
+            p = p->right_;
+        } else {
+            stats_.OnSearch(path);
+            return {iterator(p, &root_), false};
+        }
+    }
+    stats_.OnSearch(path);
+
+    // Allocate only once the key is known to be new.
+    return {Attach(q, left, std::forward<Args>(args)...), true};
+}
 
-    if (root_ == nullptr) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+template <typename... Args>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Attach(node_ptr parent,
+                                                       bool left,
+                                                       Args&&... args) {
+    node_ptr create = NewNode(std::forward<Args>(args)...);
+    create->parent_ = parent;
+
+    if (parent == nullptr)
         root_ = create;
-        create->parent_ = nullptr;
-    } else {
-        while (p != nullptr) {
-            q = p;
-            if (!(p->key_ < create->key_) && (create->key_ < p->key_))
-                p = p->left_;
-            else if (p->key_ < create->key_)
-                p = p->right_;
-            else
-                return end();
-        }
+    else if (left)
+        parent->left_ = create;
+    else
+        parent->right_ = create;
 
-        create->parent_ = q;
+    size_++;
+    StampAttached(create);
+    RefreshPath(create);
+    Balance::FixInsert(*this, create);
+    return iterator(create, &root_);
+}
 
-        if (q->key_ < create->key_)
-            q->right_ = create;
-        else if (!(q->key_ < create->key_) && (create->key_ < q->key_))
-            q->left_ = create;
-        else
-            return end();
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::InsertEqual(
+    const_value_ref input) {
+    const Probe probe = MakeProbe(KeyOfValue()(input));
+    node_ptr q = nullptr;
+    bool left = false;
+    std::size_t path = 0;
+
+    for (node_ptr p = root_; p != nullptr; ++path) {
+        q = p;
+        left = Less(probe, q);
+        p = left ? q->left_ : q->right_;
     }
+    stats_.OnSearch(path);
 
-    size_++;
-    FixInsert(create);
-    return IterateTo(input);
-}
-
-template <typename T>
-void RBTree<T>::FixInsert(node_ptr create) {
-    auto* x = create;
-
-    while (x != root_ && x->parent_->color_ == my_rbt::rb_node::RED) {
-        if (x->parent_ == x->parent_->parent_->left_) {
-            auto* y = x->parent_->parent_->right_;
-
-            if ((y != nullptr) && (y->color_ == my_rbt::rb_node::RED)) {
-                x->parent_->color_ = my_rbt::rb_node::BLACK;
-                y->color_ = my_rbt::rb_node::BLACK;
-                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
-                x = x->parent_->parent_;
-            } else {
-                if (x->parent_->right_ == x) {
-                    x = x->parent_;
-                    RotateLeft(x);
-                }
-
-                x->parent_->color_ = my_rbt::rb_node::BLACK;
-                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
-                RotateRight(x->parent_->parent_);
-            }
-        } else {
-            auto* y = x->parent_->parent_->left_;
-
-            if ((y != nullptr) && (y->color_ == my_rbt::rb_node::RED)) {
-                x->parent_->color_ = my_rbt::rb_node::BLACK;
-                y->color_ = my_rbt::rb_node::BLACK;
-                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
-                x = x->parent_->parent_;
-            } else {
-                if (x->parent_->left_ == x) {
-                    x = x->parent_;
-                    RotateRight(x);
-                }
-
-                x->parent_->color_ = my_rbt::rb_node::BLACK;
-                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
-                RotateLeft(x->parent_->parent_);
-            }
+    return Attach(q, left, input);
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::InsertEqual(
+    iterator hint, const_value_ref input) {
+    const_key_ref key = KeyOfValue()(input);
+    node_ptr h = hint.getPtr();
+    if (h == nullptr) {
+        // Appending: fine if nothing in the tree is greater.
+        node_ptr max = MaxNode();
+        if (max == nullptr || !Less(key, KeyOf(max))) {
+            return Attach(max, false, input);
         }
+        return InsertEqual(input);
     }
+    if (Less(KeyOf(h), key)) return InsertEqual(input);
 
-    root_->color_ = my_rbt::rb_node::BLACK;
+    // input <= *hint; it also has to be >= the key before the hint.
+    node_ptr before = h->getPrev();
+    if (before != nullptr && Less(key, KeyOf(before))) {
+        return InsertEqual(input);
+    }
+    if (h->left_ == nullptr) return Attach(h, true, input);
+    return Attach(before, false, input);
 }
 
-template <typename T>
-void RBTree<T>::RotateRight(node_ptr in) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RotateRight(
+    node_ptr in) {
     if (in->left_ == nullptr)
         return;
     else {
+        stats_.OnRotateRight();
         auto* x = in->left_;
         auto* b = x->right_;
         auto* f = in->parent_;
@@ -300,14 +748,20 @@ void RBTree<T>::RotateRight(node_ptr in) {
         in->left_ = b;
 
         if (b != nullptr) b->parent_ = in;
+        Refresh(in);
+        Refresh(x);
     }
 }
 
-template <typename T>
-void RBTree<T>::RotateLeft(node_ptr x) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RotateLeft(
+    node_ptr x) {
     if (x->right_ == nullptr)
         return;
     else {
+        stats_.OnRotateLeft();
         auto* y = x->right_;
         auto* b = y->left_;
         auto* f = x->parent_;
@@ -327,64 +781,63 @@ void RBTree<T>::RotateLeft(node_ptr x) {
         x->right_ = b;
 
         if (b != nullptr) b->parent_ = x;
+        Refresh(x);
+        Refresh(y);
     }
 }
 
-template <typename T>
-bool RBTree<T>::Find(const_key_ref in) {
-    auto* t = root_;
-
-    while (t != nullptr) {
-        if (t->key_ == in) return true;
-        if (in > t->key_)
-            t = t->right_;
-        else if (in < t->key_)
-            t = t->left_;
-    }
-
-    return false;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+bool
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Find(
+    const_key_ref in) {
+    return FindNode(in) != nullptr;
 }
-template <typename T>
-RBTree<T>::operator bool() const {
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::operator bool() const {
     return !IsEmpty();
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::begin() const noexcept {
-    return iterator(MinNode());
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::begin()
+    const noexcept {
+    return iterator(MinNode(), &root_);
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::end() const noexcept {
-    if (!root_) return iterator();
-    auto tmp = root_;
-    while (tmp->right_ != nullptr) tmp = tmp->right_;
-
-    return iterator(tmp + 1);
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::end() const noexcept {
+    return iterator(nullptr, &root_);
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::IterateTo(const_key_ref x) const {
-    return iterator(FindNode(x));
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::IterateTo(
+    const_key_ref x) const {
+    return iterator(FindNode(x), &root_);
 }
 
-template <typename T>
-typename RBTree<T>::node_ptr RBTree<T>::FindNode(const_key_ref in) const {
-    auto* t = root_;
-
-    while (t != nullptr) {
-        if ((!(t->key_ < in)) && !(in < t->key_)) return t;
-        if (!(in < t->key_) && (t->key_ < in))
-            t = t->right_;
-        else if (in < t->key_)
-            t = t->left_;
-    }
-
-    return nullptr;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::FindNode(
+    const_key_ref in) const {
+    // One comparison per level plus one at the end, instead of up to two
+    // per level; this matters for keys that are expensive to compare.
+    node_ptr t = LowerBoundNode(in);
+    return (t != nullptr && !Less(MakeProbe(in), t)) ? t : nullptr;
 }
 
-template <typename T>
-size_t RBTree<T>::Size(node_ptr in) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+size_t
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Size(node_ptr in) {
     if (in == nullptr)
         return 0;
     else {
@@ -395,210 +848,466 @@ size_t RBTree<T>::Size(node_ptr in) {
     }
 }
 
-template <typename T>
-bool RBTree<T>::Remove(const_key_ref x) {
-    if (root_ == nullptr) {
-        std::cout << "Tree is Empty\n";
-        return false;
-    }
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+bool
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Remove(
+    const_key_ref x) {
+    auto* p = FindNode(x);
 
-    auto* p = root_;
-    auto found = 0;
+    if (p == nullptr) return false;
 
-    while (p != nullptr && found == 0) {
-        if (p->key_ == x) found = 1;
-        if (found == 0) {
-            if (p->key_ < x)
-                p = p->right_;
-            else
-                p = p->left_;
-        }
-    }
+    RemoveNode(p);
+    return true;
+}
 
-    if (found == 0)
-        return false;
+// Unlinks z by relinking its in-order successor into its place rather than
+// copying keys between nodes, so iterators to every other element stay
+// valid and keys never need to be assignable.
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::RemoveNode(
+    node_ptr z) {
+    node_ptr y = z;
+    node_ptr x = nullptr;
+    node_ptr x_parent = nullptr;
+
+    if (z->left_ == nullptr)
+        x = z->right_;
+    else if (z->right_ == nullptr)
+        x = z->left_;
     else {
-        node_ptr q, y;
-
-        if (p->left_ == nullptr || p->right_ == nullptr)
-            y = p;
-        else
-            y = p->getNext();
-
-        if (y->left_ != nullptr)
-            q = y->left_;
-        else {
-            if (y->right_ != nullptr)
-                q = y->right_;
-            else
-                q = nullptr;
+        y = z->right_->getMin();
+        x = y->right_;
+    }
+
+    if (y != z) {
+        z->left_->parent_ = y;
+        y->left_ = z->left_;
+        if (y != z->right_) {
+            x_parent = y->parent_;
+            if (x != nullptr) x->parent_ = y->parent_;
+            y->parent_->left_ = x;
+            y->right_ = z->right_;
+            z->right_->parent_ = y;
+        } else {
+            x_parent = y;
         }
+        ReplaceChild(z, y);
+        y->parent_ = z->parent_;
+        std::swap(y->color_, z->color_);
+    } else {
+        x_parent = z->parent_;
+        if (x != nullptr) x->parent_ = z->parent_;
+        ReplaceChild(z, x);
+    }
 
-        if (q != nullptr) q->parent_ = y->parent_;
+    // Every subtree that lost z lies on the path up from x_parent.
+    RefreshPath(x_parent);
 
-        if (y->parent_ == nullptr)
-            root_ = q;
-        else {
-            if (y == y->parent_->left_)
-                y->parent_->left_ = q;
-            else
-                y->parent_->right_ = q;
-        }
+    // z now carries the balance data of the position that was vacated.
+    Balance::FixRemove(*this, x, x_parent, z->color_);
+
+    DropNode(z);
+    size_--;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::ReplaceChild(
+    node_ptr old_child, node_ptr new_child) {
+    node_ptr parent = old_child->parent_;
+    if (parent == nullptr)
+        root_ = new_child;
+    else if (parent->left_ == old_child)
+        parent->left_ = new_child;
+    else
+        parent->right_ = new_child;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::LowerBoundNode(
+    const_key_ref key) const {
+    const Probe x = MakeProbe(key);
+    node_ptr t = root_;
+    node_ptr bound = nullptr;
+    std::size_t path = 0;
 
-        if (y != p) {
-            p->color_ = y->color_;
-            p->key_ = y->key_;
+    while (t != nullptr) {
+        ++path;
+        if (Less(t, x)) {
+            t = t->right_;
+        } else {
+            bound = t;
+            t = t->left_;
         }
+    }
+
+    stats_.OnSearch(path);
+    return bound;
+}
 
-        if (y->color_ == my_rbt::rb_node::BLACK) FixRemove(q);
-
-        size_--;
-        return true;
-    }
-}
-
-template <typename T>
-void RBTree<T>::FixRemove(node_ptr p) {
-    if (p != nullptr) {
-        node_ptr s;
-
-        while (p != root_ && p->color_ == my_rbt::rb_node::BLACK) {
-            if (p->parent_->left_ == p) {
-                s = p->parent_->right_;
-
-                if (s->color_ == my_rbt::rb_node::RED) {
-                    s->color_ = my_rbt::rb_node::BLACK;
-                    p->parent_->color_ = my_rbt::rb_node::RED;
-                    RotateLeft(p->parent_);
-                    s = p->parent_->right_;
-                }
-                if (s->right_->color_ == my_rbt::rb_node::BLACK &&
-                    s->left_->color_ == my_rbt::rb_node::BLACK) {
-                    s->color_ = my_rbt::rb_node::RED;
-                    p = p->parent_;
-                } else {
-                    if (s->right_->color_ == my_rbt::rb_node::BLACK) {
-                        s->left_->color_ = my_rbt::rb_node::BLACK;
-                        s->color_ = my_rbt::rb_node::RED;
-                        RotateRight(s);
-                        s = p->parent_->right_;
-                    }
-
-                    s->color_ = p->parent_->color_;
-                    p->parent_->color_ = my_rbt::rb_node::BLACK;
-                    s->right_->color_ = my_rbt::rb_node::BLACK;
-                    RotateLeft(p->parent_);
-                    p = root_;
-                }
-            } else {
-                s = p->parent_->left_;
-
-                if (s->color_ == my_rbt::rb_node::RED) {
-                    s->color_ = my_rbt::rb_node::RED;
-                    p->parent_->color_ = my_rbt::rb_node::RED;
-                    RotateRight(p->parent_);
-                    s = p->parent_->left_;
-                }
-                if (s->left_->color_ == my_rbt::rb_node::BLACK &&
-                    s->right_->color_ == my_rbt::rb_node::BLACK) {
-                    s->color_ = my_rbt::rb_node::RED;
-                    p = p->parent_;
-                } else {
-                    if (s->left_->color_ == my_rbt::rb_node::BLACK) {
-                        s->right_->color_ = my_rbt::rb_node::BLACK;
-                        s->color_ = my_rbt::rb_node::RED;
-                        RotateLeft(s);
-                        s = p->parent_->left_;
-                    }
-
-                    s->color_ = p->parent_->color_;
-                    p->parent_->color_ = my_rbt::rb_node::BLACK;
-                    s->left_->color_ = my_rbt::rb_node::BLACK;
-                    RotateRight(p->parent_);
-                    p = root_;
-                }
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::LowerBoundNode(
+    node_ptr finger, const_key_ref key) const {
+    if (finger == nullptr) return LowerBoundNode(key);
+
+    // The answer is in the subtree under start or is bound. Each ancestor
+    // reached from the side facing x narrows that down; the climb stops at
+    // the first one on the far side of x.
+    const Probe x = MakeProbe(key);
+    node_ptr t = finger;
+    node_ptr start;
+    node_ptr bound = nullptr;
+    std::size_t path = 1;
+    if (Less(t, x)) {
+        start = t->right_;
+        for (; t->parent_ != nullptr; t = t->parent_) {
+            node_ptr p = t->parent_;
+            if (t != p->left_) continue;
+            ++path;
+            if (!Less(p, x)) {
+                bound = p;
+                break;
             }
+            start = p->right_;
+        }
+    } else {
+        bound = t;
+        start = t->left_;
+        for (; t->parent_ != nullptr; t = t->parent_) {
+            node_ptr p = t->parent_;
+            if (t != p->right_) continue;
+            ++path;
+            if (Less(p, x)) break;
+            bound = p;
+            start = p->left_;
+        }
+    }
 
-            p->color_ = my_rbt::rb_node::BLACK;
-            root_->color_ = my_rbt::rb_node::BLACK;
+    for (t = start; t != nullptr;) {
+        ++path;
+        if (Less(t, x)) {
+            t = t->right_;
+        } else {
+            bound = t;
+            t = t->left_;
         }
     }
+
+    stats_.OnSearch(path);
+    return bound;
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::LowerBound(const_key_ref x) const {
-    for (auto it = begin(); it != end(); ++it) {
-        if (!(*it < x)) {
-            return it;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::LowerBound(
+    iterator finger, const_key_ref x) const {
+    return iterator(LowerBoundNode(finger.getPtr(), x), &root_);
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::IterateTo(
+    iterator finger, const_key_ref x) const {
+    node_ptr t = LowerBoundNode(finger.getPtr(), x);
+    if (t != nullptr && Less(MakeProbe(x), t)) t = nullptr;
+    return iterator(t, &root_);
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::node_ptr
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::UpperBoundNode(
+    const_key_ref key) const {
+    const Probe x = MakeProbe(key);
+    node_ptr t = root_;
+    node_ptr bound = nullptr;
+    std::size_t path = 0;
+
+    while (t != nullptr) {
+        ++path;
+        if (Less(x, t)) {
+            bound = t;
+            t = t->left_;
+        } else {
+            t = t->right_;
         }
     }
 
-    return end();
+    stats_.OnSearch(path);
+    return bound;
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::Erase(iterator pos) {
-    auto ret = iterator(pos.getPtr());
-    ++ret;
-    Remove(*pos);
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::LowerBound(
+    const_key_ref x) const {
+    return iterator(LowerBoundNode(x), &root_);
+}
 
-    return ret;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::UpperBound(
+    const_key_ref x) const {
+    return iterator(UpperBoundNode(x), &root_);
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::Erase(iterator first, iterator last) {
-    auto ret = last;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+std::pair<
+    typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator,
+    typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::EqualRange(
+    const_key_ref x) const {
+    return {LowerBound(x), UpperBound(x)};
+}
 
-    if (ret != end()) {
-        ++ret;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+std::size_t RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Count(
+    const_key_ref x) const {
+    std::size_t count = 0;
+    node_ptr last = UpperBoundNode(x);
+    for (node_ptr n = LowerBoundNode(x); n != last; n = n->getNext()) {
+        count++;
     }
+    return count;
+}
 
-    std::vector<T> remover;
-    for (auto it = first; it != last; ++it) {
-        remover.push_back(*it);
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+const Compare&
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::KeyComp() const {
+    return compare_;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+template <typename Fn>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::ForEachInRange(
+    const_key_ref lo, const_key_ref hi, Fn&& fn) const {
+    // A red-black tree over a 64-bit address space is at most 128 levels deep.
+    node_ptr stack[2 * 64];
+    std::size_t top = 0;
+
+    std::size_t path = 0;
+    for (node_ptr t = root_; t != nullptr; ++path) {
+        if (Less(KeyOf(t), lo)) {
+            t = t->right_;
+        } else {
+            stack[top++] = t;
+            t = t->left_;
+        }
     }
 
-    for (auto& e : remover) {
-        remove(e);
+    stats_.OnSearch(path);
+
+    while (top != 0) {
+        node_ptr n = stack[--top];
+        if (!Less(KeyOf(n), hi)) return;
+        fn(n->key_);
+        for (node_ptr t = n->right_; t != nullptr; t = t->left_) {
+            stack[top++] = t;
+        }
     }
+}
 
-    return ret;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+std::vector<
+    typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::SplitPoints(
+    std::size_t depth) const {
+    std::vector<iterator> points;
+    // Pending ancestors and their levels, as in ForEachInRange.
+    std::vector<std::pair<node_ptr, std::size_t>> stack;
+    node_ptr t = root_;
+    std::size_t level = 0;
+    while (true) {
+        for (; t != nullptr && level < depth; t = t->left_, ++level) {
+            stack.emplace_back(t, level);
+        }
+        if (stack.empty()) return points;
+        node_ptr n = stack.back().first;
+        level = stack.back().second + 1;
+        stack.pop_back();
+        points.push_back(iterator(n, &root_));
+        t = n->right_;
+    }
 }
 
-template <typename T>
-std::size_t RBTree<T>::Erase(const_key_ref key) {
-    std::size_t count = 0;
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Erase(iterator pos) {
+    auto ret = pos;
+    ++ret;
+    RemoveNode(pos.getPtr());
 
-    while (find(key)) {
-        remove(key);
-        count++;
+    return ret;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Erase(iterator first,
+                                                      iterator last) {
+    while (first != last) {
+        first = Erase(first);
     }
 
-    return count;
+    return last;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+std::size_t RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Erase(
+    const_key_ref key) {
+    std::size_t before = size_;
+    std::pair<iterator, iterator> range = EqualRange(key);
+    Erase(range.first, range.second);
+    return before - size_;
 }
 
-template <typename T>
-void RBTree<T>::Insert(iterator first, iterator last) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Insert(
+    iterator first, iterator last) {
     for (auto it = first; it != last; ++it) {
         Insert(*it);
     }
 }
 
-template <typename T>
-std::pair<typename RBTree<T>::iterator, bool> RBTree<T>::InsertUnique(
-    const_key_ref val) {
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+std::pair<
+    typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::iterator,
+    bool>
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::InsertUnique(
+    const_value_ref val) {
     auto check = GetSize();
-    Insert(val);
+    iterator inserted = Insert(val);
     // если после вставки размер не поменялся
     if (check == GetSize()) {
-        return {IterateTo(val), false};
-    } else {
-        for (auto it = begin(); it != end(); ++it) {
-            if ((!(*it < val)) && !(val < *it)) {
-                return {it, true};
-            }
+        return {IterateTo(KeyOfValue()(val)), false};
+    }
+    return {inserted, true};
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+const Stats&
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::GetStats() const {
+    return stats_;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+void RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::ResetStats() {
+    stats_.Reset();
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+my_rbt::stats::Shape
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::GetShape() const {
+    my_rbt::stats::Shape shape;
+    if (root_ == nullptr) return shape;
+
+    if constexpr (Balance::kColoured) {
+        for (node_ptr t = root_; t != nullptr; t = t->left_) {
+            if (Balance::IsBlack(t)) shape.black_height_++;
+        }
+    }
+
+    std::size_t depth_total = 0;
+    std::vector<std::pair<node_ptr, std::size_t>> pending{{root_, 0}};
+    while (!pending.empty()) {
+        auto [node, depth] = pending.back();
+        pending.pop_back();
+        shape.node_count_++;
+        depth_total += depth;
+        if (depth + 1 > shape.height_) shape.height_ = depth + 1;
+        if (node->left_ != nullptr) pending.push_back({node->left_, depth + 1});
+        if (node->right_ != nullptr) {
+            pending.push_back({node->right_, depth + 1});
+        }
+    }
+
+    shape.average_depth_ =
+        static_cast<double>(depth_total) / shape.node_count_;
+    return shape;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::aggregate_type
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Aggregate(node_ptr n) {
+    if (n == nullptr) return Augment::Identity();
+    return static_cast<alloc_type*>(n)->sum_;
+}
+
+template <typename T, typename Stats, typename Compare,
+          typename KeyOfValue, typename Augment, typename Balance>
+typename RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::aggregate_type
+RBTree<T, Stats, Compare, KeyOfValue, Augment, Balance>::Reduce(
+    const_key_ref lo, const_key_ref hi) const {
+    // Descend to the highest node inside [lo, hi); the range is that node
+    // plus a suffix of its left subtree and a prefix of its right subtree.
+    std::size_t path = 0;
+    node_ptr t = root_;
+    while (t != nullptr) {
+        ++path;
+        if (Less(KeyOf(t), lo)) {
+            t = t->right_;
+        } else if (!Less(KeyOf(t), hi)) {
+            t = t->left_;
+        } else {
+            break;
+        }
+    }
+    if (t == nullptr) {
+        stats_.OnSearch(path);
+        return Augment::Identity();
+    }
+
+    // Keys >= lo on the left: each such node brings its right subtree.
+    aggregate_type left = Augment::Identity();
+    for (node_ptr n = t->left_; n != nullptr; ++path) {
+        if (Less(KeyOf(n), lo)) {
+            n = n->right_;
+        } else {
+            left = Augment::Combine(
+                Augment::Combine(Augment::Of(n->key_), Aggregate(n->right_)),
+                left);
+            n = n->left_;
+        }
+    }
+    // Keys < hi on the right: each such node brings its left subtree.
+    aggregate_type right = Augment::Identity();
+    for (node_ptr n = t->right_; n != nullptr; ++path) {
+        if (Less(KeyOf(n), hi)) {
+            right = Augment::Combine(
+                right,
+                Augment::Combine(Aggregate(n->left_), Augment::Of(n->key_)));
+            n = n->right_;
+        } else {
+            n = n->left_;
         }
     }
-    return {IterateTo(val), false};
+    stats_.OnSearch(path);
+    return Augment::Combine(Augment::Combine(left, Augment::Of(t->key_)),
+                            right);
 }
 }  // namespace my_rbt
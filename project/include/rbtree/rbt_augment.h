@@ -0,0 +1,38 @@
+#pragma once
+
+#include "rbt_node.h"
+
+namespace my_rbt {
+namespace augment {
+
+// RBTree's Augment parameter: a monoid whose aggregate over each subtree
+// is cached in the node, e.g. the total bytes of string keys:
+//   struct Bytes {
+//       typedef std::size_t value_type;
+//       static value_type Identity() { return 0; }
+//       static value_type Of(const std::string& key) { return key.size(); }
+//       static value_type Combine(value_type a, value_type b) {
+//           return a + b;
+//       }
+//   };
+// Combine must be associative; it need not be commutative, as subtrees are
+// always combined left, node, right. The tree refreshes the cache on both
+// nodes of every rotation, along the insert path before FixInsert and along
+// the path above a removed node before FixRemove.
+//
+// None, the default, allocates plain RBNodes and compiles every refresh
+// away, so unaugmented trees keep their node size.
+struct None {
+    typedef void value_type;
+};
+
+// What an augmented tree allocates. The rest of the tree, iterators
+// included, only sees the RBNode base.
+template <typename T, typename Monoid>
+struct Node : my_rbt::rb_node::RBNode<T> {
+    using my_rbt::rb_node::RBNode<T>::RBNode;
+
+    typename Monoid::value_type sum_;
+};
+}  // namespace augment
+}  // namespace my_rbt
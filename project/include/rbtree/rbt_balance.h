@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+
+#include "rbt_node.h"
+
+namespace my_rbt {
+namespace balance {
+
+// Balancing policies for RBTree. The tree does the searching, linking and
+// unlinking; a policy only restores its own invariant afterwards, through
+// the tree's rotations, and keeps its per-node data in RBNode::color_:
+//
+//   FixInsert(tree, x)             x was just linked in as a leaf.
+//   FixRemove(tree, x, p, vacated) a node was unlinked; x (maybe null) took
+//                                  its place under p (null at the root), and
+//                                  vacated is the data of the lost position.
+//   Build(n, bottom)               n's children are final during a bulk
+//                                  build; bottom marks a partial last level.
+//
+// Policies are friends of the tree, so they may rotate and reach the root.
+
+// Colours, height <= 2 log2(n + 1). Fewest rotations per update: at most two
+// per insert and three per erase.
+struct RedBlack {
+    static constexpr bool kColoured = true;
+
+    template <typename Node>
+    static bool IsBlack(const Node* n) {
+        return n == nullptr || n->color_ == my_rbt::rb_node::BLACK;
+    }
+
+    template <typename Tree>
+    static void FixInsert(Tree& tree, typename Tree::node_ptr x);
+    // p carries an extra black; it may be a null leaf, hence the explicit
+    // parent.
+    template <typename Tree>
+    static void FixRemove(Tree& tree, typename Tree::node_ptr p,
+                          typename Tree::node_ptr parent, int vacated);
+    template <typename Node>
+    static void Build(Node* n, bool bottom) {
+        n->color_ = bottom ? my_rbt::rb_node::RED : my_rbt::rb_node::BLACK;
+    }
+};
+
+// Subtree heights, leaves 1; sibling heights differ by at most one, so the
+// height is below 1.44 log2(n + 2): shallower lookups than red-black, paid
+// for with more rotations, up to O(log n) per erase.
+struct Avl {
+    static constexpr bool kColoured = false;
+
+    template <typename Node>
+    static int Height(const Node* n) {
+        return n == nullptr ? 0 : n->color_;
+    }
+    template <typename Node>
+    static void Update(Node* n) {
+        n->color_ = 1 + std::max(Height(n->left_), Height(n->right_));
+    }
+    // Restores the balance at n with one or two rotations if needed, updates
+    // heights, and returns the node now at n's position.
+    template <typename Tree>
+    static typename Tree::node_ptr Rebalance(Tree& tree,
+                                             typename Tree::node_ptr n);
+
+    template <typename Tree>
+    static void FixInsert(Tree& tree, typename Tree::node_ptr x);
+    template <typename Tree>
+    static void FixRemove(Tree& tree, typename Tree::node_ptr x,
+                          typename Tree::node_ptr parent, int vacated);
+    template <typename Node>
+    static void Build(Node* n, bool) {
+        Update(n);
+    }
+};
+
+// Weak AVL (Haeupler, Sen, Tarjan): ranks with parent-child differences of
+// 1 or 2, leaves 0, null -1. Built by inserts alone it is exactly AVL; an
+// erase takes at most two rotations, as in red-black, and the height never
+// exceeds 2 log2(n + 1).
+struct Wavl {
+    static constexpr bool kColoured = false;
+
+    template <typename Node>
+    static int Rank(const Node* n) {
+        return n == nullptr ? -1 : n->color_;
+    }
+
+    template <typename Tree>
+    static void FixInsert(Tree& tree, typename Tree::node_ptr x);
+    template <typename Tree>
+    static void FixRemove(Tree& tree, typename Tree::node_ptr x,
+                          typename Tree::node_ptr parent, int vacated);
+    template <typename Node>
+    static void Build(Node* n, bool) {
+        n->color_ = 1 + std::max(Rank(n->left_), Rank(n->right_));
+    }
+};
+
+template <typename Tree>
+void RedBlack::FixInsert(Tree& tree, typename Tree::node_ptr x) {
+    while (x != tree.root_ && x->parent_->color_ == my_rbt::rb_node::RED) {
+        tree.stats_.OnFixInsertStep();
+        if (x->parent_ == x->parent_->parent_->left_) {
+            auto* y = x->parent_->parent_->right_;
+
+            if ((y != nullptr) && (y->color_ == my_rbt::rb_node::RED)) {
+                x->parent_->color_ = my_rbt::rb_node::BLACK;
+                y->color_ = my_rbt::rb_node::BLACK;
+                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
+                x = x->parent_->parent_;
+            } else {
+                if (x->parent_->right_ == x) {
+                    x = x->parent_;
+                    tree.RotateLeft(x);
+                }
+
+                x->parent_->color_ = my_rbt::rb_node::BLACK;
+                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
+                tree.RotateRight(x->parent_->parent_);
+            }
+        } else {
+            auto* y = x->parent_->parent_->left_;
+
+            if ((y != nullptr) && (y->color_ == my_rbt::rb_node::RED)) {
+                x->parent_->color_ = my_rbt::rb_node::BLACK;
+                y->color_ = my_rbt::rb_node::BLACK;
+                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
+                x = x->parent_->parent_;
+            } else {
+                if (x->parent_->left_ == x) {
+                    x = x->parent_;
+                    tree.RotateRight(x);
+                }
+
+                x->parent_->color_ = my_rbt::rb_node::BLACK;
+                x->parent_->parent_->color_ = my_rbt::rb_node::RED;
+                tree.RotateLeft(x->parent_->parent_);
+            }
+        }
+    }
+
+    tree.root_->color_ = my_rbt::rb_node::BLACK;
+}
+
+template <typename Tree>
+void RedBlack::FixRemove(Tree& tree, typename Tree::node_ptr p,
+                         typename Tree::node_ptr parent, int vacated) {
+    typedef typename Tree::node_ptr node_ptr;
+    if (vacated != my_rbt::rb_node::BLACK) return;
+
+    while (p != tree.root_ && IsBlack(p)) {
+        tree.stats_.OnFixRemoveStep();
+        if (parent->left_ == p) {
+            node_ptr s = parent->right_;
+
+            if (s->color_ == my_rbt::rb_node::RED) {
+                s->color_ = my_rbt::rb_node::BLACK;
+                parent->color_ = my_rbt::rb_node::RED;
+                tree.RotateLeft(parent);
+                s = parent->right_;
+            }
+            if (IsBlack(s->left_) && IsBlack(s->right_)) {
+                s->color_ = my_rbt::rb_node::RED;
+                p = parent;
+                parent = p->parent_;
+            } else {
+                if (IsBlack(s->right_)) {
+                    s->left_->color_ = my_rbt::rb_node::BLACK;
+                    s->color_ = my_rbt::rb_node::RED;
+                    tree.RotateRight(s);
+                    s = parent->right_;
+                }
+
+                s->color_ = parent->color_;
+                parent->color_ = my_rbt::rb_node::BLACK;
+                s->right_->color_ = my_rbt::rb_node::BLACK;
+                tree.RotateLeft(parent);
+                p = tree.root_;
+            }
+        } else {
+            node_ptr s = parent->left_;
+
+            if (s->color_ == my_rbt::rb_node::RED) {
+                s->color_ = my_rbt::rb_node::BLACK;
+                parent->color_ = my_rbt::rb_node::RED;
+                tree.RotateRight(parent);
+                s = parent->left_;
+            }
+            if (IsBlack(s->left_) && IsBlack(s->right_)) {
+                s->color_ = my_rbt::rb_node::RED;
+                p = parent;
+                parent = p->parent_;
+            } else {
+                if (IsBlack(s->left_)) {
+                    s->right_->color_ = my_rbt::rb_node::BLACK;
+                    s->color_ = my_rbt::rb_node::RED;
+                    tree.RotateLeft(s);
+                    s = parent->left_;
+                }
+
+                s->color_ = parent->color_;
+                parent->color_ = my_rbt::rb_node::BLACK;
+                s->left_->color_ = my_rbt::rb_node::BLACK;
+                tree.RotateRight(parent);
+                p = tree.root_;
+            }
+        }
+    }
+
+    if (p != nullptr) p->color_ = my_rbt::rb_node::BLACK;
+}
+
+template <typename Tree>
+typename Tree::node_ptr Avl::Rebalance(Tree& tree,
+                                       typename Tree::node_ptr n) {
+    typedef typename Tree::node_ptr node_ptr;
+    int balance = Height(n->left_) - Height(n->right_);
+    if (balance > 1) {
+        node_ptr l = n->left_;
+        if (Height(l->left_) < Height(l->right_)) {
+            tree.RotateLeft(l);
+            Update(l);
+        }
+        tree.RotateRight(n);
+    } else if (balance < -1) {
+        node_ptr r = n->right_;
+        if (Height(r->right_) < Height(r->left_)) {
+            tree.RotateRight(r);
+            Update(r);
+        }
+        tree.RotateLeft(n);
+    } else {
+        Update(n);
+        return n;
+    }
+    Update(n);
+    Update(n->parent_);
+    return n->parent_;
+}
+
+template <typename Tree>
+void Avl::FixInsert(Tree& tree, typename Tree::node_ptr x) {
+    x->color_ = 1;
+    // Stops where a subtree's height is unchanged; after a rotation it
+    // always is.
+    for (auto* p = x->parent_; p != nullptr; p = p->parent_) {
+        tree.stats_.OnFixInsertStep();
+        int before = p->color_;
+        p = Rebalance(tree, p);
+        if (p->color_ == before) break;
+    }
+}
+
+template <typename Tree>
+void Avl::FixRemove(Tree& tree, typename Tree::node_ptr,
+                    typename Tree::node_ptr parent, int) {
+    for (auto* p = parent; p != nullptr; p = p->parent_) {
+        tree.stats_.OnFixRemoveStep();
+        int before = p->color_;
+        p = Rebalance(tree, p);
+        if (p->color_ == before) break;
+    }
+}
+
+template <typename Tree>
+void Wavl::FixInsert(Tree& tree, typename Tree::node_ptr x) {
+    typedef typename Tree::node_ptr node_ptr;
+    x->color_ = 0;
+    // x is a 0-child: promote the parent while x's sibling is a 1-child,
+    // then rotate once or twice.
+    for (node_ptr p = x->parent_; p != nullptr && p->color_ == x->color_;
+         p = x->parent_) {
+        tree.stats_.OnFixInsertStep();
+        bool left = p->left_ == x;
+        node_ptr s = left ? p->right_ : p->left_;
+        if (p->color_ - Rank(s) == 1) {
+            ++p->color_;
+            x = p;
+            continue;
+        }
+
+        node_ptr y = left ? x->right_ : x->left_;
+        if (x->color_ - Rank(y) == 2) {
+            left ? tree.RotateRight(p) : tree.RotateLeft(p);
+            --p->color_;
+        } else {
+            left ? tree.RotateLeft(x) : tree.RotateRight(x);
+            left ? tree.RotateRight(p) : tree.RotateLeft(p);
+            ++y->color_;
+            --x->color_;
+            --p->color_;
+        }
+        break;
+    }
+}
+
+template <typename Tree>
+void Wavl::FixRemove(Tree& tree, typename Tree::node_ptr x,
+                     typename Tree::node_ptr p, int) {
+    typedef typename Tree::node_ptr node_ptr;
+    if (p == nullptr) return;
+    // Losing a child can leave p a leaf of rank 1, which ranks forbid.
+    if (p->left_ == nullptr && p->right_ == nullptr && p->color_ == 1) {
+        p->color_ = 0;
+        x = p;
+        p = p->parent_;
+    }
+
+    // x is a 3-child: demote while that only moves the problem up, then
+    // rotate once or twice. x's sibling has rank >= 0, so is never null.
+    while (p != nullptr && p->color_ - Rank(x) == 3) {
+        tree.stats_.OnFixRemoveStep();
+        bool left = p->left_ == x;
+        node_ptr y = left ? p->right_ : p->left_;
+        if (p->color_ - y->color_ == 2) {
+            --p->color_;
+        } else if (y->color_ - Rank(y->left_) == 2 &&
+                   y->color_ - Rank(y->right_) == 2) {
+            --p->color_;
+            --y->color_;
+        } else {
+            node_ptr z = left ? y->right_ : y->left_;
+            if (y->color_ - Rank(z) == 1) {
+                left ? tree.RotateLeft(p) : tree.RotateRight(p);
+                ++y->color_;
+                --p->color_;
+                if (p->left_ == nullptr && p->right_ == nullptr) --p->color_;
+            } else {
+                node_ptr v = left ? y->left_ : y->right_;
+                left ? tree.RotateRight(y) : tree.RotateLeft(y);
+                left ? tree.RotateLeft(p) : tree.RotateRight(p);
+                v->color_ += 2;
+                --y->color_;
+                p->color_ -= 2;
+            }
+            break;
+        }
+        x = p;
+        p = p->parent_;
+    }
+}
+}  // namespace balance
+}  // namespace my_rbt
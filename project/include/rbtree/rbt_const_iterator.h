@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
 #include "rbt_node.h"
 
 namespace my_rbt {
@@ -9,26 +13,37 @@ template <typename T>
 class ConstIterator {
    protected:
     my_rbt::rb_node::RBNode<T> *ptr_;
+    // Slot holding the owning tree's root: end() is a null node, and stepping
+    // back from it needs the maximum of the tree.
+    my_rbt::rb_node::RBNode<T> *const *root_;
 
    public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
     typedef T key_type;
     typedef T &key_ref;
     typedef const T &const_key_ref;
-    typedef T *key_ptr;
+    typedef const T *key_ptr;
 
     ConstIterator();
     explicit ConstIterator(my_rbt::rb_node::RBNode<T> *ptr);
+    ConstIterator(my_rbt::rb_node::RBNode<T> *ptr,
+                  my_rbt::rb_node::RBNode<T> *const *root);
     ConstIterator(const ConstIterator &s);
 
     ConstIterator &operator=(const ConstIterator &other);
 
-    my_rbt::rb_node::RBNode<T> *getPtr();
+    my_rbt::rb_node::RBNode<T> *getPtr() const;
 
     // Bidirectional
-    ConstIterator operator++();
-    const ConstIterator operator++(int);
-    ConstIterator operator--();
-    const ConstIterator operator--(int);
+    ConstIterator &operator++();
+    ConstIterator operator++(int);
+    ConstIterator &operator--();
+    ConstIterator operator--(int);
 
     bool operator==(const ConstIterator &other) const;
     bool operator!=(const ConstIterator &other) const;
@@ -39,16 +54,23 @@ class ConstIterator {
 };
 
 template <typename T>
-ConstIterator<T>::ConstIterator() : ptr_{nullptr} {}
+ConstIterator<T>::ConstIterator() : ptr_{nullptr}, root_{nullptr} {}
+
+template <typename T>
+ConstIterator<T>::ConstIterator(my_rbt::rb_node::RBNode<T> *ptr)
+    : ptr_{ptr}, root_{nullptr} {}
 
 template <typename T>
-ConstIterator<T>::ConstIterator(my_rbt::rb_node::RBNode<T> *ptr) : ptr_{ptr} {}
+ConstIterator<T>::ConstIterator(my_rbt::rb_node::RBNode<T> *ptr,
+                                my_rbt::rb_node::RBNode<T> *const *root)
+    : ptr_{ptr}, root_{root} {}
 
 template <typename T>
-ConstIterator<T>::ConstIterator(const ConstIterator &s) : ptr_{s.ptr_} {}
+ConstIterator<T>::ConstIterator(const ConstIterator &s)
+    : ptr_{s.ptr_}, root_{s.root_} {}
 
 template <typename T>
-my_rbt::rb_node::RBNode<T> *ConstIterator<T>::getPtr() {
+my_rbt::rb_node::RBNode<T> *ConstIterator<T>::getPtr() const {
     return ptr_;
 }
 
@@ -56,6 +78,7 @@ template <typename T>
 ConstIterator<T> &ConstIterator<T>::operator=(const ConstIterator &other) {
     if (this != &other) {
         this->ptr_ = other.ptr_;
+        this->root_ = other.root_;
     }
     return (*this);
 }
@@ -77,7 +100,7 @@ T const &ConstIterator<T>::operator*() const {
 
 template <typename T>
 typename ConstIterator<T>::key_ptr ConstIterator<T>::operator->() const {
-    return reinterpret_cast<key_ptr>(std::addressof(ptr_->key_));
+    return std::addressof(ptr_->key_);
 }
 
 template <typename T>
@@ -86,28 +109,32 @@ ConstIterator<T>::operator bool() const {
 }
 
 template <typename T>
-ConstIterator<T> ConstIterator<T>::operator++() {
+ConstIterator<T> &ConstIterator<T>::operator++() {
     this->ptr_ = this->ptr_->getNext();
     return *this;
 }
 
 template <typename T>
-const ConstIterator<T> ConstIterator<T>::operator++(int) {
+ConstIterator<T> ConstIterator<T>::operator++(int) {
     ConstIterator tmp(*this);
-    this->ptr_ = this->ptr_->getNext();
+    ++(*this);
     return tmp;
 }
 
 template <typename T>
-const ConstIterator<T> ConstIterator<T>::operator--(int) {
+ConstIterator<T> ConstIterator<T>::operator--(int) {
     ConstIterator tmp(*this);
-    this->ptr_ = this->ptr_->getPrev();
+    --(*this);
     return tmp;
 }
 
 template <typename T>
-ConstIterator<T> ConstIterator<T>::operator--() {
-    this->ptr_ = this->ptr_->getPrev();
+ConstIterator<T> &ConstIterator<T>::operator--() {
+    if (this->ptr_ == nullptr) {
+        this->ptr_ = (*root_)->getMax();
+    } else {
+        this->ptr_ = this->ptr_->getPrev();
+    }
     return *this;
 }
 }  // namespace iterator
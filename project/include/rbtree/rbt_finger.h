@@ -0,0 +1,37 @@
+#pragma once
+
+namespace my_rbt {
+namespace finger {
+
+// Position the last lookup of a container ended at, kept as the starting
+// point of the next finger search; an empty object when Enabled is false.
+// Copies start out empty, since a finger into another tree is no use.
+template <typename Iterator, bool Enabled>
+class Cache {
+   public:
+    Cache() : finger_() {}
+    Cache(const Cache&) : finger_() {}
+    Cache& operator=(const Cache&) {
+        finger_ = Iterator();
+        return *this;
+    }
+
+    // Lookups are const on the container, so the cache is written from
+    // const members; it is not synchronised.
+    const Iterator& Get() const { return finger_; }
+    void Set(const Iterator& position) const { finger_ = position; }
+    void Reset() { finger_ = Iterator(); }
+
+   private:
+    mutable Iterator finger_;
+};
+
+template <typename Iterator>
+class Cache<Iterator, false> {
+   public:
+    Iterator Get() const { return Iterator(); }
+    void Set(const Iterator&) const {}
+    void Reset() {}
+};
+}  // namespace finger
+}  // namespace my_rbt
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
+#include "rbt_const_iterator.h"
+
+namespace my_rbt {
+namespace iterator {
+
+// Iterator of SmallTree: a pointer into the inline array while the keys
+// live there, a tree iterator once they have moved to nodes. slot_ is null
+// exactly in the second case.
+template <typename T>
+class HybridIterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
+    HybridIterator();
+    explicit HybridIterator(const T *slot);
+    explicit HybridIterator(const ConstIterator<T> &node);
+
+    const T *getSlot() const;
+    const ConstIterator<T> &getNode() const;
+
+    HybridIterator &operator++();
+    HybridIterator operator++(int);
+    HybridIterator &operator--();
+    HybridIterator operator--(int);
+
+    bool operator==(const HybridIterator &other) const;
+    bool operator!=(const HybridIterator &other) const;
+
+    const T &operator*() const;
+    pointer operator->() const;
+
+   private:
+    ConstIterator<T> node_;
+    const T *slot_;
+};
+
+template <typename T>
+HybridIterator<T>::HybridIterator() : node_(), slot_{nullptr} {}
+
+template <typename T>
+HybridIterator<T>::HybridIterator(const T *slot) : node_(), slot_{slot} {}
+
+template <typename T>
+HybridIterator<T>::HybridIterator(const ConstIterator<T> &node)
+    : node_(node), slot_{nullptr} {}
+
+template <typename T>
+const T *HybridIterator<T>::getSlot() const {
+    return slot_;
+}
+
+template <typename T>
+const ConstIterator<T> &HybridIterator<T>::getNode() const {
+    return node_;
+}
+
+template <typename T>
+HybridIterator<T> &HybridIterator<T>::operator++() {
+    if (slot_ != nullptr)
+        ++slot_;
+    else
+        ++node_;
+    return *this;
+}
+
+template <typename T>
+HybridIterator<T> HybridIterator<T>::operator++(int) {
+    HybridIterator tmp(*this);
+    ++(*this);
+    return tmp;
+}
+
+template <typename T>
+HybridIterator<T> &HybridIterator<T>::operator--() {
+    if (slot_ != nullptr)
+        --slot_;
+    else
+        --node_;
+    return *this;
+}
+
+template <typename T>
+HybridIterator<T> HybridIterator<T>::operator--(int) {
+    HybridIterator tmp(*this);
+    --(*this);
+    return tmp;
+}
+
+template <typename T>
+bool HybridIterator<T>::operator==(const HybridIterator &other) const {
+    return slot_ == other.slot_ && node_ == other.node_;
+}
+
+template <typename T>
+bool HybridIterator<T>::operator!=(const HybridIterator &other) const {
+    return !(*this == other);
+}
+
+template <typename T>
+const T &HybridIterator<T>::operator*() const {
+    return slot_ != nullptr ? *slot_ : *node_;
+}
+
+template <typename T>
+typename HybridIterator<T>::pointer HybridIterator<T>::operator->() const {
+    return std::addressof(**this);
+}
+}  // namespace iterator
+}  // namespace my_rbt
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+
+#include "rbt_const_iterator.h"
+
+namespace my_rbt {
+namespace iterator {
+
+// Mutable view over the same nodes as ConstIterator. Only containers whose
+// stored value keeps its key const (a map's pair<const Key, Value>) hand it
+// out, so writes through it cannot break the tree order.
+template <typename T>
+class Iterator : public ConstIterator<T> {
+   public:
+    typedef T *pointer;
+    typedef T &reference;
+
+    Iterator();
+    explicit Iterator(const ConstIterator<T> &other);
+
+    Iterator &operator++();
+    Iterator operator++(int);
+    Iterator &operator--();
+    Iterator operator--(int);
+
+    T &operator*() const;
+    pointer operator->() const;
+};
+
+template <typename T>
+Iterator<T>::Iterator() : ConstIterator<T>() {}
+
+template <typename T>
+Iterator<T>::Iterator(const ConstIterator<T> &other)
+    : ConstIterator<T>(other) {}
+
+template <typename T>
+Iterator<T> &Iterator<T>::operator++() {
+    ConstIterator<T>::operator++();
+    return *this;
+}
+
+template <typename T>
+Iterator<T> Iterator<T>::operator++(int) {
+    Iterator tmp(*this);
+    ++(*this);
+    return tmp;
+}
+
+template <typename T>
+Iterator<T> &Iterator<T>::operator--() {
+    ConstIterator<T>::operator--();
+    return *this;
+}
+
+template <typename T>
+Iterator<T> Iterator<T>::operator--(int) {
+    Iterator tmp(*this);
+    --(*this);
+    return tmp;
+}
+
+template <typename T>
+T &Iterator<T>::operator*() const {
+    return this->ptr_->key_;
+}
+
+template <typename T>
+typename Iterator<T>::pointer Iterator<T>::operator->() const {
+    return std::addressof(this->ptr_->key_);
+}
+}  // namespace iterator
+}  // namespace my_rbt
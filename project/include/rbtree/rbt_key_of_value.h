@@ -0,0 +1,24 @@
+#pragma once
+
+#include <utility>
+
+namespace my_rbt {
+namespace key_of_value {
+
+// Extracts the ordering key from a stored value. RBTree compares only what
+// this returns, so a map's mapped value is never touched by a lookup.
+struct Identity {
+    template <typename T>
+    const T& operator()(const T& value) const {
+        return value;
+    }
+};
+
+struct SelectFirst {
+    template <typename Pair>
+    const typename Pair::first_type& operator()(const Pair& value) const {
+        return value.first;
+    }
+};
+}  // namespace key_of_value
+}  // namespace my_rbt
@@ -28,6 +28,10 @@ class RBNode {
 
     RBNode();
     explicit RBNode(key_type key);
+    // Constructs key_ directly from args, so map values need not be
+    // default constructible or copied.
+    template <typename... Args>
+    explicit RBNode(std::in_place_t, Args &&...args);
     RBNode(const_node_ref other);
 
     ~RBNode() = default;
@@ -49,6 +53,15 @@ RBNode<T>::RBNode(key_type key)
       right_{nullptr},
       color_{RED} {}
 
+template <typename T>
+template <typename... Args>
+RBNode<T>::RBNode(std::in_place_t, Args &&...args)
+    : key_(std::forward<Args>(args)...),
+      parent_{nullptr},
+      left_{nullptr},
+      right_{nullptr},
+      color_{RED} {}
+
 template <typename T>
 RBNode<T>::RBNode(const RBNode<T> &other)
     : key_{other.key},
@@ -95,6 +108,9 @@ typename RBNode<T>::node_ref RBNode<T>::operator=(const_node_ref other) {
     return *this;
 }
 
+// In-order successor, or nullptr past the maximum. Climbing stops at the
+// first ancestor we reach from its left subtree, so a full traversal touches
+// every edge twice instead of re-walking to the root on each step.
 template <typename T>
 typename RBNode<T>::node_ptr RBNode<T>::getNext() {
     RBNode<T> *x = this;
@@ -102,22 +118,13 @@ typename RBNode<T>::node_ptr RBNode<T>::getNext() {
         return x->right_->getMin();
     }
 
-    RBNode<T> *root = x;
-    while (root->parent_ != nullptr) {
-        root = root->parent_;
-    }
-
-    RBNode<T> *right = root->getMax();
-    if (x == right) {
-        return right + 1;
-    }
-
-    while (x != x->parent_->left_) {
+    while (x->parent_ != nullptr && x == x->parent_->right_) {
         x = x->parent_;
     }
     return x->parent_;
 }
 
+// In-order predecessor, or nullptr before the minimum.
 template <typename T>
 typename RBNode<T>::node_ptr RBNode<T>::getPrev() {
     RBNode<T> *x = this;
@@ -125,14 +132,7 @@ typename RBNode<T>::node_ptr RBNode<T>::getPrev() {
         return x->left_->getMax();
     }
 
-    RBNode<T> *root = x;
-    while (root->parent_ != nullptr) root = root->parent_;
-
-    RBNode<T> *lleft = root->getMin();
-
-    if (x == lleft) return lleft - 1;
-
-    while (x != x->parent_->right_) x = x->parent_;
+    while (x->parent_ != nullptr && x == x->parent_->left_) x = x->parent_;
     return x->parent_;
 }
 }  // namespace rb_node
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace my_rbt {
+namespace prefix {
+
+// Key prefixes cached in the node. For key types that have them, RBTree
+// stores a few bytes of each key next to the node's links, and computes
+// the searched key's bytes once per search, so a step down the tree
+// compares two integers and only reads the key itself when they are equal.
+//
+// The bytes are taken after the prefix that all keys in the tree share,
+// e.g. "https://www.", which would otherwise make every cached value
+// equal. The tree tracks that length: it can only shrink as keys are
+// inserted, and each time it does every node is restamped, so at most
+// kMaxOffset times. A searched key that does not share it is less or
+// greater than every key, and gets the lowest or highest value.
+//
+// Specialise Traits for a key type ordered by std::less like a string of
+// bytes:
+//   static constexpr bool kEnabled = true;
+//   typedef <unsigned integer> value_type;
+//   // The bytes of key at [offset, offset + sizeof(value_type)),
+//   // zero-padded, such that Of(a, k) < Of(b, k) implies a < b for keys
+//   // that share their first k bytes.
+//   static value_type Of(const Key& key, std::size_t offset);
+//   // Length of the common prefix of a and b, at most limit.
+//   static std::size_t Common(const Key& a, const Key& b, std::size_t limit);
+//   // <0, 0 or >0 as the first length bytes of key order against those
+//   // of reference, which has at least length.
+//   static int Compare(const Key& key, const Key& reference,
+//                      std::size_t length);
+template <typename Key>
+struct Traits {
+    static constexpr bool kEnabled = false;
+    typedef unsigned char value_type;
+};
+
+// Longest shared prefix skipped; longer ones are rare and cap how often
+// a tree restamps its nodes.
+constexpr std::size_t kMaxOffset = 64;
+
+// Unsigned byte order, which is char_traits<char>::compare's.
+template <>
+struct Traits<std::string> {
+    static constexpr bool kEnabled = true;
+    typedef std::uint64_t value_type;
+
+    static value_type Of(const std::string& key, std::size_t offset) {
+        unsigned char bytes[8] = {};
+        if (offset < key.size()) {
+            std::size_t n = key.size() - offset;
+            std::memcpy(bytes, key.data() + offset, n < 8 ? n : 8);
+        }
+        value_type value = 0;
+        for (unsigned char byte : bytes) value = value << 8 | byte;
+        return value;
+    }
+
+    static std::size_t Common(const std::string& a, const std::string& b,
+                              std::size_t limit) {
+        std::size_t n = std::min({a.size(), b.size(), limit});
+        std::size_t i = 0;
+        while (i < n && a[i] == b[i]) ++i;
+        return i;
+    }
+
+    static int Compare(const std::string& key, const std::string& reference,
+                       std::size_t length) {
+        return key.compare(0, length, reference, 0, length);
+    }
+};
+
+// What a prefixed tree allocates: Base, a plain or augmented node, and the
+// cached bytes of its key.
+template <typename Base, typename Prefix>
+struct Node : Base {
+    using Base::Base;
+
+    typename Prefix::value_type prefix_;
+};
+
+// A tree's shared prefix length; empty for trees without prefixes.
+template <bool Enabled>
+struct Offset {
+    // Keys seen so far share their first value_ bytes; kMaxOffset while
+    // the tree is empty.
+    std::size_t value_ = kMaxOffset;
+};
+
+template <>
+struct Offset<false> {};
+}  // namespace prefix
+}  // namespace my_rbt
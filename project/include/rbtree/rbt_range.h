@@ -0,0 +1,50 @@
+#pragma once
+
+#include <ranges>
+
+#include "rbt_const_iterator.h"
+
+namespace my_rbt {
+namespace range {
+
+// Non-owning [first, last) window over a tree. Holds two iterators and
+// nothing else, so it is cheap to copy and never allocates.
+template <typename T, typename Iterator = my_rbt::iterator::ConstIterator<T>>
+class Range : public std::ranges::view_interface<Range<T, Iterator>> {
+   public:
+    typedef Iterator iterator;
+
+    Range();
+    Range(iterator first, iterator last);
+
+    iterator begin() const;
+    iterator end() const;
+
+   private:
+    iterator first_;
+    iterator last_;
+};
+
+template <typename T, typename Iterator>
+Range<T, Iterator>::Range() : first_(), last_() {}
+
+template <typename T, typename Iterator>
+Range<T, Iterator>::Range(iterator first, iterator last)
+    : first_(first), last_(last) {}
+
+template <typename T, typename Iterator>
+typename Range<T, Iterator>::iterator Range<T, Iterator>::begin() const {
+    return first_;
+}
+
+template <typename T, typename Iterator>
+typename Range<T, Iterator>::iterator Range<T, Iterator>::end() const {
+    return last_;
+}
+}  // namespace range
+}  // namespace my_rbt
+
+template <typename T, typename Iterator>
+inline constexpr bool
+    std::ranges::enable_borrowed_range<my_rbt::range::Range<T, Iterator>> =
+        true;
@@ -0,0 +1,430 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "rb_tree.h"
+#include "rbt_hybrid_iterator.h"
+
+namespace my_rbt {
+
+// RBTree front that keeps up to N keys sorted in an array inside the
+// object, so small sets allocate nothing and search a contiguous block.
+// The key that would make N + 1 moves everything into nodes; shrinking to
+// N / 2 keys moves them back, so a size hovering at N does not flip the
+// representation on every insert and erase. Switching invalidates all
+// iterators. Inline keys are shifted on insert and erase and so must be
+// move-assignable. Stats only see the tree: inline work is not counted.
+template <typename T, std::size_t N,
+          typename Stats = my_rbt::stats::NullStats,
+          typename Augment = my_rbt::augment::None,
+          typename Balance = my_rbt::balance::RedBlack>
+class SmallTree {
+    static_assert(N > 0, "SmallTree needs room for at least one key");
+
+   public:
+    typedef RBTree<T, Stats, std::less<T>, my_rbt::key_of_value::Identity,
+                   Augment, Balance>
+        tree_type;
+    typedef T key_type;
+    typedef const T& const_key_ref;
+    typedef my_rbt::iterator::HybridIterator<T> iterator;
+    typedef typename tree_type::aggregate_type aggregate_type;
+
+    static constexpr std::size_t kInlineCapacity = N;
+    static constexpr std::size_t kShrinkSize = N / 2;
+    static constexpr std::size_t kNodeBytes = tree_type::kNodeBytes;
+
+   private:
+    typedef typename tree_type::node_ptr node_ptr;
+
+    T* Slots();
+    const T* Slots() const;
+    // Index of the first inline key not less than key.
+    std::size_t SlotLowerBound(const_key_ref key) const;
+    void DestroySlots();
+    // Moves the inline keys into a freshly built tree.
+    void Spill();
+    // Moves the tree's keys back inline; index receives the slot of keep,
+    // or the new size if keep is null. False, with the tree untouched, if
+    // copying a key threw.
+    bool Gather(node_ptr keep, std::size_t& index);
+
+   public:
+    SmallTree();
+    SmallTree(const SmallTree&);
+    ~SmallTree();
+    SmallTree& operator=(const SmallTree&);
+
+    size_t GetSize() const;
+    [[nodiscard]] bool IsEmpty() const;
+    bool IsInline() const;
+    void Clear();
+    // As RBTree::AssignSorted; n <= N keys are stored inline.
+    template <typename Generator>
+    void AssignSorted(std::size_t n, Generator&& next);
+
+    iterator begin() const noexcept;
+    iterator end() const noexcept;
+    iterator Insert(const_key_ref);
+    std::pair<iterator, bool> InsertUnique(const_key_ref);
+    iterator Erase(iterator pos);
+    iterator IterateTo(const_key_ref) const;
+    iterator LowerBound(const_key_ref) const;
+    iterator UpperBound(const_key_ref) const;
+    // Finger search as in RBTree; inline keys are binary searched anyway.
+    iterator IterateTo(iterator finger, const_key_ref) const;
+    iterator LowerBound(iterator finger, const_key_ref) const;
+    template <typename Fn>
+    void ForEachInRange(const_key_ref lo, const_key_ref hi, Fn&& fn) const;
+    // As RBTree::SplitPoints; none while the keys are inline.
+    std::vector<iterator> SplitPoints(std::size_t depth) const;
+    aggregate_type Reduce(const_key_ref lo, const_key_ref hi) const;
+
+    const Stats& GetStats() const;
+    void ResetStats();
+    // Shape of the tree; inline keys occupy no nodes.
+    my_rbt::stats::Shape GetShape() const;
+
+   private:
+    tree_type tree_;
+    std::size_t size_;
+    bool inline_;
+    alignas(T) unsigned char slots_[N * sizeof(T)];
+};
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+SmallTree<T, N, Stats, Augment, Balance>::SmallTree()
+    : tree_(), size_{0}, inline_{true} {}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+SmallTree<T, N, Stats, Augment, Balance>::SmallTree(const SmallTree& other)
+    : tree_(other.tree_), size_{0}, inline_{other.inline_} {
+    try {
+        for (; size_ < other.size_; ++size_) {
+            ::new (Slots() + size_) T(other.Slots()[size_]);
+        }
+    } catch (...) {
+        DestroySlots();
+        throw;
+    }
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+SmallTree<T, N, Stats, Augment, Balance>::~SmallTree() {
+    DestroySlots();
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+SmallTree<T, N, Stats, Augment, Balance>&
+SmallTree<T, N, Stats, Augment, Balance>::operator=(const SmallTree& other) {
+    if (this == &other) return *this;
+    Clear();
+    if (!other.inline_) {
+        tree_ = other.tree_;
+        inline_ = false;
+        return *this;
+    }
+    try {
+        for (; size_ < other.size_; ++size_) {
+            ::new (Slots() + size_) T(other.Slots()[size_]);
+        }
+    } catch (...) {
+        DestroySlots();
+        throw;
+    }
+    return *this;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+T* SmallTree<T, N, Stats, Augment, Balance>::Slots() {
+    return std::launder(reinterpret_cast<T*>(slots_));
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+const T* SmallTree<T, N, Stats, Augment, Balance>::Slots() const {
+    return std::launder(reinterpret_cast<const T*>(slots_));
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+std::size_t SmallTree<T, N, Stats, Augment, Balance>::SlotLowerBound(
+    const_key_ref key) const {
+    return std::lower_bound(Slots(), Slots() + size_, key, std::less<T>()) -
+           Slots();
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+void SmallTree<T, N, Stats, Augment, Balance>::DestroySlots() {
+    std::destroy_n(Slots(), size_);
+    size_ = 0;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+void SmallTree<T, N, Stats, Augment, Balance>::Spill() {
+    T* slots = Slots();
+    std::size_t i = 0;
+    // Sorted input: the tree is built balanced in O(N), no comparisons.
+    tree_.AssignSorted(size_, [slots, &i]() -> T {
+        return std::move_if_noexcept(slots[i++]);
+    });
+    DestroySlots();
+    inline_ = false;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+bool SmallTree<T, N, Stats, Augment, Balance>::Gather(node_ptr keep,
+                                                      std::size_t& index) {
+    index = tree_.GetSize();
+    T* slots = Slots();
+    try {
+        for (node_ptr n = tree_.MinNode(); n != nullptr; n = n->getNext()) {
+            if (n == keep) index = size_;
+            ::new (slots + size_) T(std::move_if_noexcept(n->key_));
+            ++size_;
+        }
+    } catch (...) {
+        // Only copies throw, so the tree still holds every key.
+        DestroySlots();
+        return false;
+    }
+    tree_.Clear();
+    inline_ = true;
+    return true;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+size_t SmallTree<T, N, Stats, Augment, Balance>::GetSize() const {
+    return inline_ ? size_ : tree_.GetSize();
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+bool SmallTree<T, N, Stats, Augment, Balance>::IsEmpty() const {
+    return GetSize() == 0;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+bool SmallTree<T, N, Stats, Augment, Balance>::IsInline() const {
+    return inline_;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+void SmallTree<T, N, Stats, Augment, Balance>::Clear() {
+    DestroySlots();
+    tree_.Clear();
+    inline_ = true;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+template <typename Generator>
+void SmallTree<T, N, Stats, Augment, Balance>::AssignSorted(std::size_t n,
+                                                            Generator&& next) {
+    Clear();
+    if (n > N) {
+        tree_.AssignSorted(n, std::forward<Generator>(next));
+        inline_ = false;
+        return;
+    }
+    try {
+        for (; size_ < n; ++size_) ::new (Slots() + size_) T(next());
+    } catch (...) {
+        DestroySlots();
+        throw;
+    }
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::begin() const noexcept {
+    return inline_ ? iterator(Slots()) : iterator(tree_.begin());
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::end() const noexcept {
+    return inline_ ? iterator(Slots() + size_) : iterator(tree_.end());
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::Insert(const_key_ref key) {
+    std::pair<iterator, bool> inserted = InsertUnique(key);
+    return inserted.second ? inserted.first : end();
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+std::pair<typename SmallTree<T, N, Stats, Augment, Balance>::iterator, bool>
+SmallTree<T, N, Stats, Augment, Balance>::InsertUnique(const_key_ref key) {
+    if (inline_) {
+        T* slots = Slots();
+        std::size_t i = SlotLowerBound(key);
+        if (i < size_ && !(key < slots[i])) return {iterator(slots + i), false};
+        if (size_ < N) {
+            if (i == size_) {
+                ::new (slots + i) T(key);
+            } else {
+                // Copy first: if that throws, nothing has moved yet.
+                T value(key);
+                ::new (slots + size_) T(std::move(slots[size_ - 1]));
+                std::move_backward(slots + i, slots + size_ - 1,
+                                   slots + size_);
+                slots[i] = std::move(value);
+            }
+            ++size_;
+            return {iterator(slots + i), true};
+        }
+        Spill();
+    }
+    std::pair<typename tree_type::iterator, bool> inserted =
+        tree_.InsertUnique(key);
+    return {iterator(inserted.first), inserted.second};
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::Erase(iterator pos) {
+    if (inline_) {
+        T* slots = Slots();
+        T* slot = slots + (pos.getSlot() - slots);
+        std::move(slot + 1, slots + size_, slot);
+        std::destroy_at(slots + size_ - 1);
+        --size_;
+        return iterator(slot);
+    }
+    typename tree_type::iterator next = tree_.Erase(pos.getNode());
+    std::size_t index = 0;
+    if (tree_.GetSize() <= kShrinkSize && Gather(next.getPtr(), index)) {
+        return iterator(Slots() + index);
+    }
+    return iterator(next);
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::IterateTo(const_key_ref key) const {
+    if (!inline_) return iterator(tree_.IterateTo(key));
+    std::size_t i = SlotLowerBound(key);
+    return (i < size_ && !(key < Slots()[i])) ? iterator(Slots() + i) : end();
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::LowerBound(const_key_ref key) const {
+    if (!inline_) return iterator(tree_.LowerBound(key));
+    return iterator(Slots() + SlotLowerBound(key));
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::IterateTo(iterator finger,
+                                           const_key_ref key) const {
+    if (!inline_) return iterator(tree_.IterateTo(finger.getNode(), key));
+    return IterateTo(key);
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::LowerBound(iterator finger,
+                                            const_key_ref key) const {
+    if (!inline_) return iterator(tree_.LowerBound(finger.getNode(), key));
+    return LowerBound(key);
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::iterator
+SmallTree<T, N, Stats, Augment, Balance>::UpperBound(const_key_ref key) const {
+    if (!inline_) return iterator(tree_.UpperBound(key));
+    return iterator(
+        std::upper_bound(Slots(), Slots() + size_, key, std::less<T>()));
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+template <typename Fn>
+void SmallTree<T, N, Stats, Augment, Balance>::ForEachInRange(
+    const_key_ref lo, const_key_ref hi, Fn&& fn) const {
+    if (!inline_) {
+        tree_.ForEachInRange(lo, hi, std::forward<Fn>(fn));
+        return;
+    }
+    const T* slots = Slots();
+    for (std::size_t i = SlotLowerBound(lo); i < size_ && slots[i] < hi;
+         ++i) {
+        fn(slots[i]);
+    }
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+std::vector<typename SmallTree<T, N, Stats, Augment, Balance>::iterator>
+SmallTree<T, N, Stats, Augment, Balance>::SplitPoints(
+    std::size_t depth) const {
+    std::vector<iterator> points;
+    if (inline_) return points;
+    for (const typename tree_type::iterator& it : tree_.SplitPoints(depth)) {
+        points.push_back(iterator(it));
+    }
+    return points;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+typename SmallTree<T, N, Stats, Augment, Balance>::aggregate_type
+SmallTree<T, N, Stats, Augment, Balance>::Reduce(const_key_ref lo,
+                                        const_key_ref hi) const {
+    if (!inline_) return tree_.Reduce(lo, hi);
+    aggregate_type total = Augment::Identity();
+    ForEachInRange(lo, hi, [&total](const T& key) {
+        total = Augment::Combine(total, Augment::Of(key));
+    });
+    return total;
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+const Stats& SmallTree<T, N, Stats, Augment, Balance>::GetStats() const {
+    return tree_.GetStats();
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+void SmallTree<T, N, Stats, Augment, Balance>::ResetStats() {
+    tree_.ResetStats();
+}
+
+template <typename T, std::size_t N, typename Stats, typename Augment,
+          typename Balance>
+my_rbt::stats::Shape
+SmallTree<T, N, Stats, Augment, Balance>::GetShape() const {
+    return tree_.GetShape();
+}
+}  // namespace my_rbt
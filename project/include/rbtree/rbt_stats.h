@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace my_rbt {
+namespace stats {
+
+// Plain snapshot of what a tree did, for exporting to a metrics pipeline.
+struct Counters {
+    std::uint64_t comparisons_ = 0;
+    std::uint64_t rotations_left_ = 0;
+    std::uint64_t rotations_right_ = 0;
+    std::uint64_t fix_insert_steps_ = 0;
+    std::uint64_t fix_remove_steps_ = 0;
+    std::uint64_t allocations_ = 0;
+    std::uint64_t frees_ = 0;
+    // One search per root-to-leaf descent; path lengths are in nodes.
+    std::uint64_t searches_ = 0;
+    std::uint64_t search_path_total_ = 0;
+    std::uint64_t search_path_max_ = 0;
+};
+
+// Structure of a tree at one point in time. Depth counts edges from the
+// root, height counts nodes on the longest root-to-leaf path. Black height
+// is 0 unless the tree is balanced as red-black.
+struct Shape {
+    std::size_t node_count_ = 0;
+    std::size_t height_ = 0;
+    std::size_t black_height_ = 0;
+    double average_depth_ = 0;
+};
+
+// Default policy: every hook is an empty inline function and the policy is
+// an empty member, so an uninstrumented tree pays nothing for it.
+struct NullStats {
+    void OnCompare() {}
+    void OnRotateLeft() {}
+    void OnRotateRight() {}
+    void OnFixInsertStep() {}
+    void OnFixRemoveStep() {}
+    void OnAlloc() {}
+    void OnFree() {}
+    void OnSearch(std::size_t) {}
+
+    Counters Snapshot() const { return Counters(); }
+    void Reset() {}
+};
+
+// Counts every hook. Not synchronised: a tree instrumented this way has the
+// same threading rules as the tree itself, including for const lookups.
+class CountingStats {
+   public:
+    void OnCompare() { ++counters_.comparisons_; }
+    void OnRotateLeft() { ++counters_.rotations_left_; }
+    void OnRotateRight() { ++counters_.rotations_right_; }
+    void OnFixInsertStep() { ++counters_.fix_insert_steps_; }
+    void OnFixRemoveStep() { ++counters_.fix_remove_steps_; }
+    void OnAlloc() { ++counters_.allocations_; }
+    void OnFree() { ++counters_.frees_; }
+    void OnSearch(std::size_t path_length) {
+        ++counters_.searches_;
+        counters_.search_path_total_ += path_length;
+        if (path_length > counters_.search_path_max_) {
+            counters_.search_path_max_ = path_length;
+        }
+    }
+
+    Counters Snapshot() const { return counters_; }
+    void Reset() { counters_ = Counters(); }
+
+   private:
+    Counters counters_;
+};
+}  // namespace stats
+}  // namespace my_rbt
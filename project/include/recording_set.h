@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+
+#include "my_set.h"
+#include "set_trace.h"
+#include "set_workload.h"
+
+namespace my_stl {
+
+// Set that logs insert, erase, find, lower_bound, clear and copy, with the
+// key and a timestamp, to a workload file that set_replay can play back
+// against any backend. The stream must outlive the set; records reach it a
+// block at a time, and the rest on flush() or destruction.
+template <class Key, class Stats = my_rbt::stats::NullStats>
+class RecordingSet {
+   public:
+    typedef Set<Key, Stats> set_type;
+    typedef typename set_type::key_type key_type;
+    typedef typename set_type::iterator iterator;
+    typedef typename set_type::const_iterator const_iterator;
+
+    explicit RecordingSet(std::ostream& os);
+    RecordingSet(const RecordingSet&) = delete;
+    RecordingSet& operator=(const RecordingSet&) = delete;
+
+    // The underlying set, for operations that are not recorded.
+    const set_type& get() const;
+    // A copy of the contents, logged as a copy.
+    set_type copy() const;
+    void flush();
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+    std::pair<const_iterator, bool> insert(const key_type&);
+    size_t erase(const key_type&);
+    void clear();
+
+    const_iterator find(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+
+   private:
+    void Log(trace::Op op, const key_type& key) const;
+
+    set_type set_;
+    mutable io::WorkloadWriter<Key> writer_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+template <class Key, class Stats>
+RecordingSet<Key, Stats>::RecordingSet(std::ostream& os)
+    : set_(), writer_(os), start_{std::chrono::steady_clock::now()} {}
+
+template <class Key, class Stats>
+void RecordingSet<Key, Stats>::Log(trace::Op op, const key_type& key) const {
+    std::uint64_t ns = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_)
+            .count());
+    writer_.Append(op, ns, key);
+}
+
+template <class Key, class Stats>
+const typename RecordingSet<Key, Stats>::set_type&
+RecordingSet<Key, Stats>::get() const {
+    return set_;
+}
+
+template <class Key, class Stats>
+typename RecordingSet<Key, Stats>::set_type RecordingSet<Key, Stats>::copy()
+    const {
+    Log(trace::Op::kCopy, key_type());
+    return set_;
+}
+
+template <class Key, class Stats>
+void RecordingSet<Key, Stats>::flush() {
+    writer_.Flush();
+}
+
+template <class Key, class Stats>
+typename RecordingSet<Key, Stats>::const_iterator
+RecordingSet<Key, Stats>::begin() const {
+    return set_.begin();
+}
+
+template <class Key, class Stats>
+typename RecordingSet<Key, Stats>::const_iterator
+RecordingSet<Key, Stats>::end() const {
+    return set_.end();
+}
+
+template <class Key, class Stats>
+size_t RecordingSet<Key, Stats>::size() const {
+    return set_.size();
+}
+
+template <class Key, class Stats>
+bool RecordingSet<Key, Stats>::empty() const {
+    return set_.empty();
+}
+
+template <class Key, class Stats>
+std::pair<typename RecordingSet<Key, Stats>::const_iterator, bool>
+RecordingSet<Key, Stats>::insert(const key_type& value) {
+    Log(trace::Op::kInsert, value);
+    return set_.insert(value);
+}
+
+template <class Key, class Stats>
+size_t RecordingSet<Key, Stats>::erase(const key_type& value) {
+    Log(trace::Op::kErase, value);
+    return set_.erase(value);
+}
+
+template <class Key, class Stats>
+void RecordingSet<Key, Stats>::clear() {
+    Log(trace::Op::kClear, key_type());
+    set_.clear();
+}
+
+template <class Key, class Stats>
+typename RecordingSet<Key, Stats>::const_iterator
+RecordingSet<Key, Stats>::find(const key_type& value) const {
+    Log(trace::Op::kFind, value);
+    return set_.find(value);
+}
+
+template <class Key, class Stats>
+typename RecordingSet<Key, Stats>::const_iterator
+RecordingSet<Key, Stats>::lower_bound(const key_type& value) const {
+    Log(trace::Op::kLowerBound, value);
+    return set_.lower_bound(value);
+}
+}  // namespace my_stl
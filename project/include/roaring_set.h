@@ -0,0 +1,942 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "set_memory.h"
+
+namespace my_stl {
+namespace roaring {
+
+// Keys of one 2^16 chunk, the low 16 bits of keys sharing their high bits,
+// in whichever of three encodings is smallest for them:
+//   array   sorted uint16 values, 2 bytes a key, up to kArrayMax keys;
+//   bitmap  one bit per possible value, 8 KiB;
+//   run     sorted [start, start + length] ranges, 4 bytes a range.
+// Array and bitmap switch automatically as keys come and go; runs are made
+// by Optimize, and turn back into one of the others once updates make
+// them larger.
+constexpr std::size_t kArrayMax = 4096;
+constexpr std::size_t kBitmapWords = 65536 / 64;
+// A bitmap turns back into an array only at half the size it came from, so
+// a chunk hovering around kArrayMax keys is not converted on every update.
+constexpr std::size_t kArrayMin = kArrayMax / 2;
+
+enum class Kind : std::uint8_t { kArray, kBitmap, kRun };
+
+// The values [start_, start_ + length_].
+struct Run {
+    std::uint16_t start_;
+    std::uint16_t length_;
+};
+
+// A position in a container: the value and, for array and run containers,
+// the index of the entry holding it.
+struct Cursor {
+    std::uint32_t index_ = 0;
+    std::uint16_t value_ = 0;
+};
+
+class Container {
+   public:
+    explicit Container(std::uint16_t high);
+
+    std::uint16_t high() const { return high_; }
+    Kind kind() const { return kind_; }
+    std::uint32_t Cardinality() const { return cardinality_; }
+    bool IsEmpty() const { return cardinality_ == 0; }
+
+    bool Contains(std::uint16_t value) const;
+    // Whether the value was absent and was added, or present and removed.
+    bool Add(std::uint16_t value);
+    bool Remove(std::uint16_t value);
+
+    // Each moves cursor to the value named, or returns false if there is
+    // none. LowerBound takes low up to 65536, which no value reaches.
+    bool First(Cursor& cursor) const;
+    bool Last(Cursor& cursor) const;
+    bool Next(Cursor& cursor) const;
+    bool Prev(Cursor& cursor) const;
+    bool LowerBound(std::uint32_t low, Cursor& cursor) const;
+
+    // Set algebra with another container of the same chunk. Bitmaps are
+    // combined a 64-bit word at a time, the others are first spread into
+    // words unless a merge of sorted arrays is cheaper.
+    void UniteWith(const Container& other);
+    void IntersectWith(const Container& other);
+    // Re-encodes as runs if that is smaller, or back if it no longer is.
+    void Optimize();
+
+    // Heap blocks held, as (bytes, allocations) for memory accounting.
+    std::size_t HeapBytes() const;
+    template <class Allocator>
+    std::size_t HeapFootprint() const;
+
+   private:
+    static std::size_t NextSetBit(const std::vector<std::uint64_t>& words,
+                                  std::uint32_t from);
+    static int PrevSetBit(const std::vector<std::uint64_t>& words,
+                          int from);
+    static void SetRange(std::vector<std::uint64_t>& words,
+                         std::uint32_t first, std::uint32_t last);
+    // Index of the last run starting at or before value, or -1.
+    std::ptrdiff_t RunBefore(std::uint16_t value) const;
+    // The keys as a bitmap, whatever the encoding.
+    std::vector<std::uint64_t> Words() const;
+    // Becomes a bitmap holding words, or an array if they are few.
+    void AssignWords(std::vector<std::uint64_t> words);
+    void ToArray();
+    void ToBitmap();
+    std::size_t RunCount() const;
+    // Leaves a run container whose ranges outgrew the other encodings.
+    void ShrinkRuns();
+
+    std::uint16_t high_;
+    Kind kind_;
+    std::uint32_t cardinality_;
+    std::vector<std::uint16_t> array_;
+    std::vector<std::uint64_t> words_;
+    std::vector<Run> runs_;
+};
+
+inline Container::Container(std::uint16_t high)
+    : high_{high},
+      kind_{Kind::kArray},
+      cardinality_{0},
+      array_(),
+      words_(),
+      runs_() {}
+
+inline bool Container::Contains(std::uint16_t value) const {
+    switch (kind_) {
+        case Kind::kArray:
+            return std::binary_search(array_.begin(), array_.end(), value);
+        case Kind::kBitmap:
+            return (words_[value >> 6] >> (value & 63)) & 1;
+        case Kind::kRun: {
+            std::ptrdiff_t r = RunBefore(value);
+            return r >= 0 && value - runs_[r].start_ <= runs_[r].length_;
+        }
+    }
+    return false;
+}
+
+inline bool Container::Add(std::uint16_t value) {
+    switch (kind_) {
+        case Kind::kArray: {
+            auto it = std::lower_bound(array_.begin(), array_.end(), value);
+            if (it != array_.end() && *it == value) return false;
+            if (cardinality_ == kArrayMax) {
+                ToBitmap();
+                return Add(value);
+            }
+            array_.insert(it, value);
+            break;
+        }
+        case Kind::kBitmap: {
+            std::uint64_t bit = std::uint64_t{1} << (value & 63);
+            if (words_[value >> 6] & bit) return false;
+            words_[value >> 6] |= bit;
+            break;
+        }
+        case Kind::kRun: {
+            std::ptrdiff_t r = RunBefore(value);
+            if (r >= 0 && value - runs_[r].start_ <= runs_[r].length_) {
+                return false;
+            }
+            std::size_t next = static_cast<std::size_t>(r + 1);
+            bool joins_prev =
+                r >= 0 && runs_[r].start_ + runs_[r].length_ + 1 == value;
+            bool joins_next =
+                next < runs_.size() && runs_[next].start_ == value + 1;
+            if (joins_prev && joins_next) {
+                runs_[r].length_ += runs_[next].length_ + 2;
+                runs_.erase(runs_.begin() + next);
+            } else if (joins_prev) {
+                ++runs_[r].length_;
+            } else if (joins_next) {
+                --runs_[next].start_;
+                ++runs_[next].length_;
+            } else {
+                runs_.insert(runs_.begin() + next, Run{value, 0});
+            }
+            ++cardinality_;
+            ShrinkRuns();
+            return true;
+        }
+    }
+    ++cardinality_;
+    return true;
+}
+
+inline bool Container::Remove(std::uint16_t value) {
+    switch (kind_) {
+        case Kind::kArray: {
+            auto it = std::lower_bound(array_.begin(), array_.end(), value);
+            if (it == array_.end() || *it != value) return false;
+            array_.erase(it);
+            --cardinality_;
+            break;
+        }
+        case Kind::kBitmap: {
+            std::uint64_t bit = std::uint64_t{1} << (value & 63);
+            if (!(words_[value >> 6] & bit)) return false;
+            words_[value >> 6] &= ~bit;
+            if (--cardinality_ <= kArrayMin) ToArray();
+            break;
+        }
+        case Kind::kRun: {
+            std::ptrdiff_t r = RunBefore(value);
+            if (r < 0 || value - runs_[r].start_ > runs_[r].length_) {
+                return false;
+            }
+            Run& run = runs_[r];
+            std::uint16_t end = run.start_ + run.length_;
+            if (run.length_ == 0) {
+                runs_.erase(runs_.begin() + r);
+            } else if (value == run.start_) {
+                ++run.start_;
+                --run.length_;
+            } else if (value == end) {
+                --run.length_;
+            } else {
+                run.length_ = value - run.start_ - 1;
+                runs_.insert(runs_.begin() + r + 1,
+                             Run{static_cast<std::uint16_t>(value + 1),
+                                 static_cast<std::uint16_t>(end - value - 1)});
+            }
+            --cardinality_;
+            ShrinkRuns();
+            break;
+        }
+    }
+    return true;
+}
+
+inline bool Container::First(Cursor& cursor) const {
+    if (cardinality_ == 0) return false;
+    cursor.index_ = 0;
+    switch (kind_) {
+        case Kind::kArray:
+            cursor.value_ = array_.front();
+            break;
+        case Kind::kBitmap:
+            cursor.value_ = static_cast<std::uint16_t>(NextSetBit(words_, 0));
+            break;
+        case Kind::kRun:
+            cursor.value_ = runs_.front().start_;
+            break;
+    }
+    return true;
+}
+
+inline bool Container::Last(Cursor& cursor) const {
+    if (cardinality_ == 0) return false;
+    switch (kind_) {
+        case Kind::kArray:
+            cursor.index_ = static_cast<std::uint32_t>(array_.size() - 1);
+            cursor.value_ = array_.back();
+            break;
+        case Kind::kBitmap:
+            cursor.value_ =
+                static_cast<std::uint16_t>(PrevSetBit(words_, 65535));
+            break;
+        case Kind::kRun:
+            cursor.index_ = static_cast<std::uint32_t>(runs_.size() - 1);
+            cursor.value_ = runs_.back().start_ + runs_.back().length_;
+            break;
+    }
+    return true;
+}
+
+inline bool Container::Next(Cursor& cursor) const {
+    switch (kind_) {
+        case Kind::kArray:
+            if (cursor.index_ + 1 >= array_.size()) return false;
+            cursor.value_ = array_[++cursor.index_];
+            return true;
+        case Kind::kBitmap: {
+            std::size_t next = NextSetBit(words_, cursor.value_ + 1u);
+            if (next == 65536) return false;
+            cursor.value_ = static_cast<std::uint16_t>(next);
+            return true;
+        }
+        case Kind::kRun: {
+            const Run& run = runs_[cursor.index_];
+            if (cursor.value_ != run.start_ + run.length_) {
+                ++cursor.value_;
+                return true;
+            }
+            if (cursor.index_ + 1 >= runs_.size()) return false;
+            cursor.value_ = runs_[++cursor.index_].start_;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool Container::Prev(Cursor& cursor) const {
+    switch (kind_) {
+        case Kind::kArray:
+            if (cursor.index_ == 0) return false;
+            cursor.value_ = array_[--cursor.index_];
+            return true;
+        case Kind::kBitmap: {
+            int prev = PrevSetBit(words_, int{cursor.value_} - 1);
+            if (prev < 0) return false;
+            cursor.value_ = static_cast<std::uint16_t>(prev);
+            return true;
+        }
+        case Kind::kRun: {
+            if (cursor.value_ != runs_[cursor.index_].start_) {
+                --cursor.value_;
+                return true;
+            }
+            if (cursor.index_ == 0) return false;
+            const Run& run = runs_[--cursor.index_];
+            cursor.value_ = run.start_ + run.length_;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool Container::LowerBound(std::uint32_t low, Cursor& cursor) const {
+    if (low > 65535 || cardinality_ == 0) return false;
+    std::uint16_t value = static_cast<std::uint16_t>(low);
+    switch (kind_) {
+        case Kind::kArray: {
+            auto it = std::lower_bound(array_.begin(), array_.end(), value);
+            if (it == array_.end()) return false;
+            cursor.index_ = static_cast<std::uint32_t>(it - array_.begin());
+            cursor.value_ = *it;
+            return true;
+        }
+        case Kind::kBitmap: {
+            std::size_t next = NextSetBit(words_, value);
+            if (next == 65536) return false;
+            cursor.value_ = static_cast<std::uint16_t>(next);
+            return true;
+        }
+        case Kind::kRun: {
+            std::ptrdiff_t r = RunBefore(value);
+            if (r >= 0 && value - runs_[r].start_ <= runs_[r].length_) {
+                cursor.index_ = static_cast<std::uint32_t>(r);
+                cursor.value_ = value;
+                return true;
+            }
+            std::size_t next = static_cast<std::size_t>(r + 1);
+            if (next == runs_.size()) return false;
+            cursor.index_ = static_cast<std::uint32_t>(next);
+            cursor.value_ = runs_[next].start_;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void Container::UniteWith(const Container& other) {
+    if (kind_ == Kind::kArray && other.kind_ == Kind::kArray &&
+        cardinality_ + other.cardinality_ <= kArrayMax) {
+        std::vector<std::uint16_t> merged;
+        merged.reserve(cardinality_ + other.cardinality_);
+        std::set_union(array_.begin(), array_.end(), other.array_.begin(),
+                       other.array_.end(), std::back_inserter(merged));
+        array_ = std::move(merged);
+        cardinality_ = static_cast<std::uint32_t>(array_.size());
+        return;
+    }
+    std::vector<std::uint64_t> words = Words();
+    switch (other.kind_) {
+        case Kind::kArray:
+            for (std::uint16_t v : other.array_) {
+                words[v >> 6] |= std::uint64_t{1} << (v & 63);
+            }
+            break;
+        case Kind::kBitmap:
+            for (std::size_t i = 0; i < kBitmapWords; ++i) {
+                words[i] |= other.words_[i];
+            }
+            break;
+        case Kind::kRun:
+            for (const Run& run : other.runs_) {
+                SetRange(words, run.start_, run.start_ + run.length_);
+            }
+            break;
+    }
+    AssignWords(std::move(words));
+}
+
+inline void Container::IntersectWith(const Container& other) {
+    if (kind_ == Kind::kArray || other.kind_ == Kind::kArray) {
+        // Probe the other container with each key of the array.
+        const Container& small = kind_ == Kind::kArray ? *this : other;
+        const Container& large = kind_ == Kind::kArray ? other : *this;
+        std::vector<std::uint16_t> kept;
+        kept.reserve(small.cardinality_);
+        for (std::uint16_t v : small.array_) {
+            if (large.Contains(v)) kept.push_back(v);
+        }
+        array_ = std::move(kept);
+        words_ = std::vector<std::uint64_t>();
+        runs_ = std::vector<Run>();
+        kind_ = Kind::kArray;
+        cardinality_ = static_cast<std::uint32_t>(array_.size());
+        return;
+    }
+    std::vector<std::uint64_t> words = Words();
+    if (other.kind_ == Kind::kBitmap) {
+        for (std::size_t i = 0; i < kBitmapWords; ++i) {
+            words[i] &= other.words_[i];
+        }
+    } else {
+        std::vector<std::uint64_t> mask = other.Words();
+        for (std::size_t i = 0; i < kBitmapWords; ++i) words[i] &= mask[i];
+    }
+    AssignWords(std::move(words));
+}
+
+inline void Container::Optimize() {
+    std::size_t runs = RunCount();
+    std::size_t current = kind_ == Kind::kArray    ? 2 * cardinality_
+                          : kind_ == Kind::kBitmap ? 8 * kBitmapWords
+                                                   : 4 * runs_.size();
+    if (kind_ == Kind::kRun || 4 * runs >= current) {
+        ShrinkRuns();
+        return;
+    }
+    std::vector<Run> built;
+    built.reserve(runs);
+    Cursor cursor;
+    for (bool more = First(cursor); more; more = Next(cursor)) {
+        if (!built.empty() &&
+            built.back().start_ + built.back().length_ + 1 == cursor.value_) {
+            ++built.back().length_;
+        } else {
+            built.push_back(Run{cursor.value_, 0});
+        }
+    }
+    runs_ = std::move(built);
+    array_ = std::vector<std::uint16_t>();
+    words_ = std::vector<std::uint64_t>();
+    kind_ = Kind::kRun;
+}
+
+inline std::size_t Container::HeapBytes() const {
+    return array_.capacity() * sizeof(std::uint16_t) +
+           words_.capacity() * sizeof(std::uint64_t) +
+           runs_.capacity() * sizeof(Run);
+}
+
+template <class Allocator>
+std::size_t Container::HeapFootprint() const {
+    std::size_t bytes = 0;
+    for (std::size_t block : {array_.capacity() * sizeof(std::uint16_t),
+                              words_.capacity() * sizeof(std::uint64_t),
+                              runs_.capacity() * sizeof(Run)}) {
+        if (block != 0) bytes += Allocator::Footprint(block);
+    }
+    return bytes;
+}
+
+inline std::size_t Container::NextSetBit(
+    const std::vector<std::uint64_t>& words, std::uint32_t from) {
+    if (from >= 65536) return 65536;
+    std::size_t i = from >> 6;
+    std::uint64_t word = words[i] & (~std::uint64_t{0} << (from & 63));
+    while (word == 0) {
+        if (++i == kBitmapWords) return 65536;
+        word = words[i];
+    }
+    return i * 64 + static_cast<std::size_t>(std::countr_zero(word));
+}
+
+inline int Container::PrevSetBit(const std::vector<std::uint64_t>& words,
+                                 int from) {
+    if (from < 0) return -1;
+    int i = from >> 6;
+    std::uint64_t word = words[i] & (~std::uint64_t{0} >> (63 - (from & 63)));
+    while (word == 0) {
+        if (--i < 0) return -1;
+        word = words[i];
+    }
+    return i * 64 + 63 - std::countl_zero(word);
+}
+
+inline void Container::SetRange(std::vector<std::uint64_t>& words,
+                                std::uint32_t first, std::uint32_t last) {
+    std::size_t a = first >> 6;
+    std::size_t b = last >> 6;
+    std::uint64_t head = ~std::uint64_t{0} << (first & 63);
+    std::uint64_t tail = ~std::uint64_t{0} >> (63 - (last & 63));
+    if (a == b) {
+        words[a] |= head & tail;
+        return;
+    }
+    words[a] |= head;
+    for (std::size_t i = a + 1; i < b; ++i) words[i] = ~std::uint64_t{0};
+    words[b] |= tail;
+}
+
+inline std::ptrdiff_t Container::RunBefore(std::uint16_t value) const {
+    auto it = std::upper_bound(
+        runs_.begin(), runs_.end(), value,
+        [](std::uint16_t v, const Run& run) { return v < run.start_; });
+    return (it - runs_.begin()) - 1;
+}
+
+inline std::vector<std::uint64_t> Container::Words() const {
+    if (kind_ == Kind::kBitmap) return words_;
+    std::vector<std::uint64_t> words(kBitmapWords, 0);
+    if (kind_ == Kind::kArray) {
+        for (std::uint16_t v : array_) {
+            words[v >> 6] |= std::uint64_t{1} << (v & 63);
+        }
+    } else {
+        for (const Run& run : runs_) {
+            SetRange(words, run.start_, run.start_ + run.length_);
+        }
+    }
+    return words;
+}
+
+inline void Container::AssignWords(std::vector<std::uint64_t> words) {
+    std::uint32_t cardinality = 0;
+    for (std::uint64_t word : words) {
+        cardinality += static_cast<std::uint32_t>(std::popcount(word));
+    }
+    words_ = std::move(words);
+    array_ = std::vector<std::uint16_t>();
+    runs_ = std::vector<Run>();
+    kind_ = Kind::kBitmap;
+    cardinality_ = cardinality;
+    if (cardinality_ <= kArrayMax) ToArray();
+}
+
+inline void Container::ToArray() {
+    std::vector<std::uint16_t> values;
+    values.reserve(cardinality_);
+    Cursor cursor;
+    for (bool more = First(cursor); more; more = Next(cursor)) {
+        values.push_back(cursor.value_);
+    }
+    array_ = std::move(values);
+    words_ = std::vector<std::uint64_t>();
+    runs_ = std::vector<Run>();
+    kind_ = Kind::kArray;
+}
+
+inline void Container::ToBitmap() {
+    words_ = Words();
+    array_ = std::vector<std::uint16_t>();
+    runs_ = std::vector<Run>();
+    kind_ = Kind::kBitmap;
+}
+
+inline std::size_t Container::RunCount() const {
+    switch (kind_) {
+        case Kind::kArray: {
+            std::size_t runs = 0;
+            for (std::size_t i = 0; i < array_.size(); ++i) {
+                if (i == 0 || array_[i] != array_[i - 1] + 1) ++runs;
+            }
+            return runs;
+        }
+        case Kind::kBitmap: {
+            // A run starts at every set bit whose lower neighbour is clear.
+            std::size_t runs = 0;
+            std::uint64_t carry = 0;
+            for (std::uint64_t word : words_) {
+                runs += static_cast<std::size_t>(
+                    std::popcount(word & ~(word << 1 | carry)));
+                carry = word >> 63;
+            }
+            return runs;
+        }
+        case Kind::kRun:
+            return runs_.size();
+    }
+    return 0;
+}
+
+inline void Container::ShrinkRuns() {
+    if (kind_ != Kind::kRun) return;
+    std::size_t best = std::min<std::size_t>(2 * cardinality_,
+                                             8 * kBitmapWords);
+    if (4 * runs_.size() <= best) return;
+    if (cardinality_ <= kArrayMax) {
+        ToArray();
+    } else {
+        ToBitmap();
+    }
+}
+}  // namespace roaring
+
+// Set of unsigned integers of up to 32 bits, stored as compressed bitmaps
+// in the manner of Roaring: keys are grouped by their high 16 bits into
+// chunks, each kept as a sorted array, a bitmap or a list of runs (see
+// roaring::Container), so a dense set takes a bit or two per key instead
+// of a tree node each. The chunks sit in a vector sorted by their high
+// bits, found by binary search.
+//
+// Reads and updates mirror Set. Iteration is ordered and bidirectional;
+// iterators hand out keys by value and any insert or erase invalidates
+// them. |= and &= combine whole chunks a 64-bit word at a time. optimize()
+// re-encodes chunks holding long ranges as runs. Sparse keys, one or two
+// per chunk, are better served by Set.
+template <class Key = std::uint32_t>
+class RoaringSet {
+    static_assert(std::is_unsigned_v<Key> && sizeof(Key) <= 4,
+                  "RoaringSet holds unsigned integers of up to 32 bits");
+
+   public:
+    typedef Key key_type;
+    class const_iterator;
+    typedef const_iterator iterator;
+
+    RoaringSet();
+    template <class Iterator>
+    RoaringSet(Iterator, Iterator);
+    RoaringSet(std::initializer_list<key_type> list);
+
+    void clear();
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    std::pair<const_iterator, bool> insert(const key_type&);
+    template <class Iterator>
+    void insert(Iterator, Iterator);
+    void erase(iterator);
+    size_t erase(const key_type&);
+
+    size_t size() const;
+    bool empty() const;
+
+    const_iterator find(const key_type&) const;
+    bool contains(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+
+    RoaringSet& operator|=(const RoaringSet& other);
+    RoaringSet& operator&=(const RoaringSet& other);
+    // Stores each chunk as runs where that is smaller, e.g. after loading
+    // long ranges of consecutive keys.
+    void optimize();
+    // As Set::memory_usage. The chunk directory is reported as index_, the
+    // chunks' arrays, bitmaps and runs as keys_.
+    template <class Allocator = memory::Malloc>
+    memory::Usage memory_usage() const;
+
+    friend RoaringSet operator|(RoaringSet a, const RoaringSet& b) {
+        return a |= b;
+    }
+    friend RoaringSet operator&(RoaringSet a, const RoaringSet& b) {
+        return a &= b;
+    }
+
+   private:
+    static std::uint16_t High(std::uint32_t key) {
+        return static_cast<std::uint16_t>(key >> 16);
+    }
+    static std::uint16_t Low(std::uint32_t key) {
+        return static_cast<std::uint16_t>(key & 0xffff);
+    }
+    // Index of the first chunk whose high bits are not less than high.
+    std::size_t ChunkIndex(std::uint16_t high) const;
+    // First key at or after low in chunk `chunk`, or in a later one.
+    const_iterator Seek(std::size_t chunk, std::uint32_t low) const;
+
+    std::vector<roaring::Container> chunks_;
+    std::size_t size_;
+};
+
+// Bidirectional iterator over the chunks in key order.
+template <class Key>
+class RoaringSet<Key>::const_iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef Key value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Key* pointer;
+    typedef Key reference;
+
+    const_iterator() : owner_{nullptr}, chunk_{0}, cursor_() {}
+
+    Key operator*() const {
+        return static_cast<Key>(
+            std::uint32_t{owner_->chunks_[chunk_].high()} << 16 |
+            cursor_.value_);
+    }
+    const_iterator& operator++() {
+        const std::vector<roaring::Container>& chunks = owner_->chunks_;
+        if (chunks[chunk_].Next(cursor_)) return *this;
+        if (++chunk_ < chunks.size()) chunks[chunk_].First(cursor_);
+        return *this;
+    }
+    const_iterator operator++(int) {
+        const_iterator tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+    const_iterator& operator--() {
+        const std::vector<roaring::Container>& chunks = owner_->chunks_;
+        if (chunk_ < chunks.size() && chunks[chunk_].Prev(cursor_)) {
+            return *this;
+        }
+        chunks[--chunk_].Last(cursor_);
+        return *this;
+    }
+    const_iterator operator--(int) {
+        const_iterator tmp(*this);
+        --(*this);
+        return tmp;
+    }
+    bool operator==(const const_iterator& other) const {
+        return chunk_ == other.chunk_ &&
+               (owner_ == nullptr || chunk_ == owner_->chunks_.size() ||
+                cursor_.value_ == other.cursor_.value_);
+    }
+    bool operator!=(const const_iterator& other) const {
+        return !(*this == other);
+    }
+
+   private:
+    friend class RoaringSet;
+    const_iterator(const RoaringSet* owner, std::size_t chunk,
+                   roaring::Cursor cursor)
+        : owner_{owner}, chunk_{chunk}, cursor_(cursor) {}
+
+    const RoaringSet* owner_;
+    std::size_t chunk_;
+    roaring::Cursor cursor_;
+};
+
+template <class Key>
+RoaringSet<Key>::RoaringSet() : chunks_(), size_{0} {}
+
+template <class Key>
+template <class Iterator>
+RoaringSet<Key>::RoaringSet(Iterator first, Iterator last)
+    : chunks_(), size_{0} {
+    insert(first, last);
+}
+
+template <class Key>
+RoaringSet<Key>::RoaringSet(std::initializer_list<key_type> list)
+    : chunks_(), size_{0} {
+    insert(list.begin(), list.end());
+}
+
+template <class Key>
+void RoaringSet<Key>::clear() {
+    chunks_.clear();
+    size_ = 0;
+}
+
+template <class Key>
+std::size_t RoaringSet<Key>::ChunkIndex(std::uint16_t high) const {
+    return static_cast<std::size_t>(
+        std::lower_bound(chunks_.begin(), chunks_.end(), high,
+                         [](const roaring::Container& c, std::uint16_t h) {
+                             return c.high() < h;
+                         }) -
+        chunks_.begin());
+}
+
+template <class Key>
+typename RoaringSet<Key>::const_iterator RoaringSet<Key>::Seek(
+    std::size_t chunk, std::uint32_t low) const {
+    roaring::Cursor cursor;
+    if (chunk < chunks_.size() && chunks_[chunk].LowerBound(low, cursor)) {
+        return const_iterator(this, chunk, cursor);
+    }
+    // Chunks are never empty, so the next one starts with a key.
+    if (++chunk < chunks_.size()) chunks_[chunk].First(cursor);
+    return const_iterator(this, std::min(chunk, chunks_.size()), cursor);
+}
+
+template <class Key>
+typename RoaringSet<Key>::const_iterator RoaringSet<Key>::begin() const {
+    roaring::Cursor cursor;
+    if (!chunks_.empty()) chunks_.front().First(cursor);
+    return const_iterator(this, 0, cursor);
+}
+
+template <class Key>
+typename RoaringSet<Key>::const_iterator RoaringSet<Key>::end() const {
+    return const_iterator(this, chunks_.size(), roaring::Cursor());
+}
+
+template <class Key>
+std::pair<typename RoaringSet<Key>::const_iterator, bool>
+RoaringSet<Key>::insert(const key_type& key) {
+    std::uint16_t high = High(key);
+    std::size_t chunk = ChunkIndex(high);
+    if (chunk == chunks_.size() || chunks_[chunk].high() != high) {
+        chunks_.insert(chunks_.begin() + chunk, roaring::Container(high));
+    }
+    bool added = chunks_[chunk].Add(Low(key));
+    size_ += added;
+    roaring::Cursor cursor;
+    chunks_[chunk].LowerBound(Low(key), cursor);
+    return std::pair<const_iterator, bool>(
+        const_iterator(this, chunk, cursor), added);
+}
+
+template <class Key>
+template <class Iterator>
+void RoaringSet<Key>::insert(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+        insert(*first);
+    }
+}
+
+template <class Key>
+void RoaringSet<Key>::erase(iterator position) {
+    erase(*position);
+}
+
+template <class Key>
+size_t RoaringSet<Key>::erase(const key_type& key) {
+    std::size_t chunk = ChunkIndex(High(key));
+    if (chunk == chunks_.size() || chunks_[chunk].high() != High(key) ||
+        !chunks_[chunk].Remove(Low(key))) {
+        return 0;
+    }
+    if (chunks_[chunk].IsEmpty()) chunks_.erase(chunks_.begin() + chunk);
+    --size_;
+    return 1;
+}
+
+template <class Key>
+size_t RoaringSet<Key>::size() const {
+    return size_;
+}
+
+template <class Key>
+bool RoaringSet<Key>::empty() const {
+    return size_ == 0;
+}
+
+template <class Key>
+typename RoaringSet<Key>::const_iterator RoaringSet<Key>::find(
+    const key_type& key) const {
+    const_iterator it = lower_bound(key);
+    return (it != end() && *it == key) ? it : end();
+}
+
+template <class Key>
+bool RoaringSet<Key>::contains(const key_type& key) const {
+    std::size_t chunk = ChunkIndex(High(key));
+    return chunk != chunks_.size() && chunks_[chunk].high() == High(key) &&
+           chunks_[chunk].Contains(Low(key));
+}
+
+template <class Key>
+typename RoaringSet<Key>::const_iterator RoaringSet<Key>::lower_bound(
+    const key_type& key) const {
+    std::size_t chunk = ChunkIndex(High(key));
+    if (chunk == chunks_.size()) return end();
+    if (chunks_[chunk].high() != High(key)) {
+        roaring::Cursor cursor;
+        chunks_[chunk].First(cursor);
+        return const_iterator(this, chunk, cursor);
+    }
+    return Seek(chunk, Low(key));
+}
+
+template <class Key>
+typename RoaringSet<Key>::const_iterator RoaringSet<Key>::upper_bound(
+    const key_type& key) const {
+    std::size_t chunk = ChunkIndex(High(key));
+    if (chunk == chunks_.size()) return end();
+    if (chunks_[chunk].high() != High(key)) {
+        roaring::Cursor cursor;
+        chunks_[chunk].First(cursor);
+        return const_iterator(this, chunk, cursor);
+    }
+    return Seek(chunk, Low(key) + 1u);
+}
+
+template <class Key>
+RoaringSet<Key>& RoaringSet<Key>::operator|=(const RoaringSet& other) {
+    if (this == &other) return *this;
+    // Merge of the two sorted chunk lists.
+    std::vector<roaring::Container> merged;
+    merged.reserve(chunks_.size() + other.chunks_.size());
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < chunks_.size() || j < other.chunks_.size()) {
+        if (j == other.chunks_.size() ||
+            (i < chunks_.size() &&
+             chunks_[i].high() < other.chunks_[j].high())) {
+            merged.push_back(std::move(chunks_[i++]));
+        } else if (i == chunks_.size() ||
+                   other.chunks_[j].high() < chunks_[i].high()) {
+            merged.push_back(other.chunks_[j++]);
+        } else {
+            merged.push_back(std::move(chunks_[i++]));
+            merged.back().UniteWith(other.chunks_[j++]);
+        }
+    }
+    chunks_ = std::move(merged);
+    size_ = 0;
+    for (const roaring::Container& chunk : chunks_) {
+        size_ += chunk.Cardinality();
+    }
+    return *this;
+}
+
+template <class Key>
+RoaringSet<Key>& RoaringSet<Key>::operator&=(const RoaringSet& other) {
+    if (this == &other) return *this;
+    std::vector<roaring::Container> kept;
+    std::size_t j = 0;
+    for (roaring::Container& chunk : chunks_) {
+        while (j < other.chunks_.size() &&
+               other.chunks_[j].high() < chunk.high()) {
+            ++j;
+        }
+        if (j == other.chunks_.size()) break;
+        if (other.chunks_[j].high() != chunk.high()) continue;
+        chunk.IntersectWith(other.chunks_[j]);
+        if (!chunk.IsEmpty()) kept.push_back(std::move(chunk));
+    }
+    chunks_ = std::move(kept);
+    size_ = 0;
+    for (const roaring::Container& chunk : chunks_) {
+        size_ += chunk.Cardinality();
+    }
+    return *this;
+}
+
+template <class Key>
+void RoaringSet<Key>::optimize() {
+    for (roaring::Container& chunk : chunks_) chunk.Optimize();
+}
+
+template <class Key>
+template <class Allocator>
+memory::Usage RoaringSet<Key>::memory_usage() const {
+    memory::Usage usage;
+    usage.object_ = sizeof(*this);
+    usage.index_ = chunks_.capacity() * sizeof(roaring::Container);
+    if (usage.index_ != 0) {
+        usage.slack_ += Allocator::Footprint(usage.index_) - usage.index_;
+    }
+    for (const roaring::Container& chunk : chunks_) {
+        std::size_t bytes = chunk.HeapBytes();
+        usage.keys_ += bytes;
+        usage.slack_ += chunk.template HeapFootprint<Allocator>() - bytes;
+    }
+    return usage;
+}
+}  // namespace my_stl
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace my_stl {
+namespace io {
+
+// On-disk layout written by Set::save:
+//   FileHeader | key payload
+// The payload is the keys in ascending order, each encoded by Codec<Key>.
+// Trivially copyable keys are stored as their raw bytes in host byte order;
+// byte_order_ lets a reader on a different architecture reject the file.
+constexpr char kMagic[4] = {'M', 'S', 'E', 'T'};
+constexpr std::uint16_t kFormatVersion = 1;
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+// FileHeader::flags_ records the order of the payload keys.
+constexpr std::uint16_t kLayoutSorted = 0;
+// Eytzinger order for MappedSet, starting at kMappedPayloadOffset so the
+// top levels of the search tree share the first cache lines.
+constexpr std::uint16_t kLayoutEytzinger = 1;
+constexpr std::size_t kMappedPayloadOffset = 64;
+
+struct FileHeader {
+    char magic_[4];
+    std::uint16_t version_;
+    std::uint16_t flags_;
+    std::uint32_t byte_order_;
+    std::uint32_t key_tag_;
+    std::uint64_t key_size_;
+    std::uint64_t count_;
+    std::uint64_t payload_size_;
+    std::uint64_t checksum_;
+};
+static_assert(sizeof(FileHeader) == 48, "FileHeader must have no padding");
+
+// Streaming 64-bit checksum over the payload. Bytes are consumed as
+// little-endian 8-byte words, so the digest does not depend on how the
+// payload is split into Update() calls.
+class Checksum {
+   public:
+    Checksum() : hash_{kSeed}, length_{0}, pending_size_{0}, pending_{} {}
+
+    void Update(const char* data, std::size_t n) {
+        length_ += n;
+        if (pending_size_ != 0) {
+            while (n != 0 && pending_size_ < 8) {
+                pending_[pending_size_++] = *data++;
+                --n;
+            }
+            if (pending_size_ < 8) return;
+            Mix(Load(pending_));
+            pending_size_ = 0;
+        }
+        for (; n >= 8; data += 8, n -= 8) {
+            Mix(Load(data));
+        }
+        std::memcpy(pending_, data, n);
+        pending_size_ = n;
+    }
+
+    std::uint64_t Digest() const {
+        Checksum tail(*this);
+        std::memset(tail.pending_ + tail.pending_size_, 0,
+                    8 - tail.pending_size_);
+        tail.Mix(Load(tail.pending_));
+        tail.Mix(length_);
+        std::uint64_t h = tail.hash_;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+   private:
+    static constexpr std::uint64_t kSeed = 0xcbf29ce484222325ULL;
+    static constexpr std::uint64_t kPrime = 0x100000001b3ULL;
+
+    static std::uint64_t Load(const char* p) {
+        std::uint64_t w = 0;
+        for (int i = 7; i >= 0; --i) {
+            w = (w << 8) | static_cast<unsigned char>(p[i]);
+        }
+        return w;
+    }
+
+    void Mix(std::uint64_t w) {
+        hash_ = (hash_ ^ w) * kPrime;
+        hash_ ^= hash_ >> 29;
+    }
+
+    std::uint64_t hash_;
+    std::uint64_t length_;
+    std::size_t pending_size_;
+    char pending_[8];
+};
+
+// Buffered writer: codecs append small pieces, the stream sees 64 KiB blocks.
+// Every flushed block is also checksummed. A writer built without a stream
+// only measures and hashes, which is how save() fills in the header before
+// the payload goes out.
+class Writer {
+   public:
+    Writer() : os_{nullptr}, buffer_(kBlockSize), used_{0}, size_{0} {}
+    explicit Writer(std::ostream& os)
+        : os_{&os}, buffer_(kBlockSize), used_{0}, size_{0} {}
+
+    void Write(const void* data, std::size_t n) {
+        const char* p = static_cast<const char*>(data);
+        if (used_ + n > buffer_.size()) {
+            Flush();
+            if (n >= buffer_.size()) {
+                Emit(p, n);
+                return;
+            }
+        }
+        std::memcpy(buffer_.data() + used_, p, n);
+        used_ += n;
+    }
+
+    void Flush() {
+        Emit(buffer_.data(), used_);
+        used_ = 0;
+    }
+
+    std::uint64_t Digest() const { return checksum_.Digest(); }
+    std::uint64_t Size() const { return size_; }
+
+   private:
+    static constexpr std::size_t kBlockSize = std::size_t{1} << 16;
+
+    void Emit(const char* data, std::size_t n) {
+        checksum_.Update(data, n);
+        size_ += n;
+        if (os_ == nullptr) return;
+        os_->write(data, static_cast<std::streamsize>(n));
+        if (!*os_) throw std::runtime_error("my_stl::io: write failed");
+    }
+
+    std::ostream* os_;
+    std::vector<char> buffer_;
+    std::size_t used_;
+    std::uint64_t size_;
+    Checksum checksum_;
+};
+
+// Buffered reader over exactly size bytes of payload, so a stream can carry
+// more data after a set. Blocks are checksummed as they are read.
+class Reader {
+   public:
+    Reader(std::istream& is, std::uint64_t size)
+        : is_{is}, buffer_(kBlockSize), pos_{0}, end_{0}, remaining_{size} {}
+
+    void Read(void* data, std::size_t n) {
+        char* p = static_cast<char*>(data);
+        while (n != 0) {
+            if (pos_ == end_) Fill();
+            std::size_t chunk = std::min(n, end_ - pos_);
+            std::memcpy(p, buffer_.data() + pos_, chunk);
+            pos_ += chunk;
+            p += chunk;
+            n -= chunk;
+        }
+    }
+
+    // True once the whole payload has been handed out.
+    bool Exhausted() const { return remaining_ == 0 && pos_ == end_; }
+    // Payload bytes not handed out yet.
+    std::uint64_t Remaining() const { return remaining_ + (end_ - pos_); }
+    std::uint64_t Digest() const { return checksum_.Digest(); }
+
+   private:
+    static constexpr std::size_t kBlockSize = std::size_t{1} << 16;
+
+    void Fill() {
+        if (remaining_ == 0) {
+            throw std::runtime_error("my_stl::io: payload overrun");
+        }
+        std::size_t want =
+            static_cast<std::size_t>(std::min<std::uint64_t>(remaining_,
+                                                             kBlockSize));
+        is_.read(buffer_.data(), static_cast<std::streamsize>(want));
+        if (static_cast<std::size_t>(is_.gcount()) != want) {
+            throw std::runtime_error("my_stl::io: truncated input");
+        }
+        checksum_.Update(buffer_.data(), want);
+        remaining_ -= want;
+        pos_ = 0;
+        end_ = want;
+    }
+
+    std::istream& is_;
+    std::vector<char> buffer_;
+    std::size_t pos_;
+    std::size_t end_;
+    std::uint64_t remaining_;
+    Checksum checksum_;
+};
+
+constexpr std::uint32_t MakeTag(char a, char b, char c, std::uint64_t size) {
+    return (static_cast<std::uint32_t>(a) << 24) |
+           (static_cast<std::uint32_t>(b) << 16) |
+           (static_cast<std::uint32_t>(c) << 8) |
+           static_cast<std::uint32_t>(size & 0xff);
+}
+
+// Codec<Key> describes how one key is stored. Specialise it for key types
+// that are neither trivially copyable nor covered below:
+//   static constexpr std::uint32_t kTag;     identifies the encoding
+//   static constexpr std::uint64_t kSize;    fixed width, or 0 if variable
+//   static constexpr std::uint64_t kMinSize; fewest bytes a key takes, > 0
+//   static void Encode(const Key&, Writer&);
+//   static Key Decode(Reader&);
+template <class Key, class Enable = void>
+struct Codec;
+
+template <class Key>
+struct Codec<Key, std::enable_if_t<std::is_trivially_copyable_v<Key>>> {
+    static constexpr std::uint32_t kTag =
+        std::is_floating_point_v<Key> ? MakeTag('F', 'P', 'N', sizeof(Key))
+        : std::is_signed_v<Key>       ? MakeTag('I', 'N', 'T', sizeof(Key))
+        : std::is_unsigned_v<Key>     ? MakeTag('U', 'N', 'S', sizeof(Key))
+                                      : MakeTag('R', 'A', 'W', sizeof(Key));
+    static constexpr std::uint64_t kSize = sizeof(Key);
+    static constexpr std::uint64_t kMinSize = sizeof(Key);
+
+    static void Encode(const Key& key, Writer& writer) {
+        writer.Write(&key, sizeof(Key));
+    }
+
+    static Key Decode(Reader& reader) {
+        Key key;
+        reader.Read(&key, sizeof(Key));
+        return key;
+    }
+};
+
+// Length-prefixed: a uint64 byte count followed by the characters.
+template <>
+struct Codec<std::string> {
+    static constexpr std::uint32_t kTag = MakeTag('S', 'T', 'R', 0);
+    static constexpr std::uint64_t kSize = 0;
+    static constexpr std::uint64_t kMinSize = sizeof(std::uint64_t);
+
+    static void Encode(const std::string& key, Writer& writer) {
+        std::uint64_t length = key.size();
+        writer.Write(&length, sizeof(length));
+        writer.Write(key.data(), key.size());
+    }
+
+    static std::string Decode(Reader& reader) {
+        std::uint64_t length = 0;
+        reader.Read(&length, sizeof(length));
+        // A damaged length must not turn into a huge allocation.
+        if (length > reader.Remaining()) {
+            throw std::runtime_error("my_stl::io: bad string length");
+        }
+        std::string key(length, '\0');
+        reader.Read(key.data(), length);
+        return key;
+    }
+};
+
+template <class First, class Second>
+struct Codec<std::pair<First, Second>,
+             std::enable_if_t<!std::is_trivially_copyable_v<
+                 std::pair<First, Second>>>> {
+    static constexpr std::uint32_t kTag =
+        MakeTag('P', 'A', 'R', 0) ^
+        (Codec<First>::kTag * 31u + Codec<Second>::kTag);
+    static constexpr std::uint64_t kSize =
+        (Codec<First>::kSize != 0 && Codec<Second>::kSize != 0)
+            ? Codec<First>::kSize + Codec<Second>::kSize
+            : 0;
+    static constexpr std::uint64_t kMinSize =
+        Codec<First>::kMinSize + Codec<Second>::kMinSize;
+
+    static void Encode(const std::pair<First, Second>& key, Writer& writer) {
+        Codec<First>::Encode(key.first, writer);
+        Codec<Second>::Encode(key.second, writer);
+    }
+
+    static std::pair<First, Second> Decode(Reader& reader) {
+        First first = Codec<First>::Decode(reader);
+        Second second = Codec<Second>::Decode(reader);
+        return std::pair<First, Second>(std::move(first), std::move(second));
+    }
+};
+}  // namespace io
+}  // namespace my_stl
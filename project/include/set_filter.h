@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace my_stl {
+namespace filter {
+
+// Default Set filter: answers "maybe" for every key and keeps no state, so
+// an unfiltered Set is unchanged in size and speed.
+struct None {
+    template <class Key>
+    bool MayContain(const Key&) const {
+        return true;
+    }
+    template <class Key>
+    void Add(const Key&) {}
+    template <class Key>
+    void Remove(const Key&) {}
+    bool NeedsRebuild(std::size_t) const { return false; }
+    template <class Iterator>
+    void Rebuild(Iterator, Iterator, std::size_t) {}
+    void Clear() {}
+    std::size_t HeapBytes() const { return 0; }
+};
+
+// Split-block Bloom filter: each key sets one bit in each of the eight
+// 32-bit words of a single 32-byte block, so a lookup hashes once and reads
+// one cache line. Hash only has to be a std::hash-like functor; its result
+// is remixed, so identity hashes of integers are fine.
+//
+// Bits cannot be cleared, so Remove only counts the stale keys. The owner
+// calls Rebuild when NeedsRebuild says the filter has filled up or most of
+// it is stale; a rebuild sizes it for twice the live keys, which keeps the
+// false positive rate under about 0.5% and the work amortised O(1).
+template <class Key, class Hash = std::hash<Key>>
+class BlockedBloom {
+   public:
+    bool MayContain(const Key& key) const;
+    void Add(const Key& key);
+    void Remove(const Key& key);
+    // Whether size live keys are better served by a fresh filter.
+    bool NeedsRebuild(std::size_t size) const;
+    // Refills the filter from the size keys in [first, last).
+    template <class Iterator>
+    void Rebuild(Iterator first, Iterator last, std::size_t size);
+    void Clear();
+    // Bytes of the bit array.
+    std::size_t HeapBytes() const;
+
+   private:
+    struct alignas(32) Block {
+        std::uint32_t words_[8];
+    };
+    static constexpr std::size_t kKeysPerBlock = 16;
+
+    static std::uint64_t Mix(const Key& key);
+    static void SetBits(Block& block, std::uint32_t h);
+    static bool TestBits(const Block& block, std::uint32_t h);
+    std::size_t IndexOf(std::uint64_t h) const;
+
+    std::vector<Block> blocks_;
+    // Keys added and removed since the last rebuild.
+    std::size_t added_ = 0;
+    std::size_t removed_ = 0;
+};
+
+template <class Key, class Hash>
+std::uint64_t BlockedBloom<Key, Hash>::Mix(const Key& key) {
+    // MurmurHash3's 64-bit finaliser.
+    std::uint64_t h = static_cast<std::uint64_t>(Hash()(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template <class Key, class Hash>
+void BlockedBloom<Key, Hash>::SetBits(Block& block, std::uint32_t h) {
+    static constexpr std::uint32_t kSalt[8] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+    for (int i = 0; i < 8; ++i) {
+        block.words_[i] |= std::uint32_t(1) << ((h * kSalt[i]) >> 27);
+    }
+}
+
+template <class Key, class Hash>
+bool BlockedBloom<Key, Hash>::TestBits(const Block& block, std::uint32_t h) {
+    Block probe{};
+    SetBits(probe, h);
+    bool hit = true;
+    for (int i = 0; i < 8; ++i) {
+        hit &= (block.words_[i] & probe.words_[i]) == probe.words_[i];
+    }
+    return hit;
+}
+
+template <class Key, class Hash>
+std::size_t BlockedBloom<Key, Hash>::IndexOf(std::uint64_t h) const {
+    // The high half picks the block by multiply-shift instead of a modulo.
+    return ((h >> 32) * blocks_.size()) >> 32;
+}
+
+template <class Key, class Hash>
+bool BlockedBloom<Key, Hash>::MayContain(const Key& key) const {
+    // Without blocks the filter knows nothing unless nothing was added,
+    // e.g. if the allocation in the first Rebuild failed.
+    if (blocks_.empty()) return added_ != 0;
+    std::uint64_t h = Mix(key);
+    return TestBits(blocks_[IndexOf(h)], static_cast<std::uint32_t>(h));
+}
+
+template <class Key, class Hash>
+void BlockedBloom<Key, Hash>::Add(const Key& key) {
+    ++added_;
+    if (blocks_.empty()) return;
+    std::uint64_t h = Mix(key);
+    SetBits(blocks_[IndexOf(h)], static_cast<std::uint32_t>(h));
+}
+
+template <class Key, class Hash>
+void BlockedBloom<Key, Hash>::Remove(const Key&) {
+    ++removed_;
+}
+
+template <class Key, class Hash>
+bool BlockedBloom<Key, Hash>::NeedsRebuild(std::size_t size) const {
+    return added_ > blocks_.size() * kKeysPerBlock || removed_ > size;
+}
+
+template <class Key, class Hash>
+template <class Iterator>
+void BlockedBloom<Key, Hash>::Rebuild(Iterator first, Iterator last,
+                                      std::size_t size) {
+    std::vector<Block> blocks((2 * size + kKeysPerBlock - 1) / kKeysPerBlock,
+                              Block{});
+    blocks_.swap(blocks);
+    for (; first != last; ++first) {
+        std::uint64_t h = Mix(*first);
+        SetBits(blocks_[IndexOf(h)], static_cast<std::uint32_t>(h));
+    }
+    added_ = size;
+    removed_ = 0;
+}
+
+template <class Key, class Hash>
+void BlockedBloom<Key, Hash>::Clear() {
+    blocks_.clear();
+    added_ = 0;
+    removed_ = 0;
+}
+
+template <class Key, class Hash>
+std::size_t BlockedBloom<Key, Hash>::HeapBytes() const {
+    return blocks_.capacity() * sizeof(Block);
+}
+}  // namespace filter
+}  // namespace my_stl
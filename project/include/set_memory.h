@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace my_stl {
+namespace memory {
+
+// Bytes a container holds, as reported by Set::memory_usage. Every field
+// is a size the container asked for except slack_, which is the allocator's
+// rounding and bookkeeping on top of those requests, as estimated by the
+// Allocator model the usage was computed with.
+struct Usage {
+    // The container object itself, keys stored inline in it included.
+    std::size_t object_ = 0;
+    // One node per key that lives in the tree: links, colour, cached
+    // aggregate and key prefix, and the key object.
+    std::size_t nodes_ = 0;
+    // Heap blocks owned by the keys themselves (KeyHeap), e.g. the
+    // characters of a long std::string, or keys packed in containers
+    // without nodes, such as RoaringSet's chunks.
+    std::size_t keys_ = 0;
+    // Auxiliary structures such as the Filter or a chunk directory.
+    std::size_t index_ = 0;
+    std::size_t slack_ = 0;
+};
+
+inline std::size_t Total(const Usage& usage) {
+    return usage.object_ + usage.nodes_ + usage.keys_ + usage.index_ +
+           usage.slack_;
+}
+
+// Allocator models: Footprint(bytes) is what one allocation of bytes
+// really takes. Malloc follows the common general-purpose allocators
+// (glibc, jemalloc and tcmalloc small classes are within a word of it): an
+// 8-byte header, 16-byte granules and a 32-byte minimum. Exact is for
+// pools that hand out slots of exactly the node size.
+struct Malloc {
+    static constexpr std::size_t Footprint(std::size_t bytes) {
+        std::size_t chunk = (bytes + 8 + 15) & ~std::size_t{15};
+        return chunk < 32 ? 32 : chunk;
+    }
+};
+
+struct Exact {
+    static constexpr std::size_t Footprint(std::size_t bytes) {
+        return bytes;
+    }
+};
+
+// KeyHeap<Key> tells how much heap memory one key owns outside its own
+// object. Specialise it for key types that own some:
+//   static constexpr bool kOwnsHeap;   false skips the walk over the keys
+//   static std::size_t Bytes(const Key&);
+//   static std::size_t Blocks(const Key&);  allocations, for the slack
+// The default is for keys that own none.
+template <class Key, class Enable = void>
+struct KeyHeap {
+    static constexpr bool kOwnsHeap = false;
+    static std::size_t Bytes(const Key&) { return 0; }
+    static std::size_t Blocks(const Key&) { return 0; }
+};
+
+// Short strings live in the object; a longer one owns capacity() + 1.
+template <class Char, class Traits, class Alloc>
+struct KeyHeap<std::basic_string<Char, Traits, Alloc>> {
+    typedef std::basic_string<Char, Traits, Alloc> key_type;
+    static constexpr bool kOwnsHeap = true;
+
+    static bool IsInline(const key_type& key) {
+        const char* data = reinterpret_cast<const char*>(key.data());
+        const char* self = reinterpret_cast<const char*>(&key);
+        return data >= self && data < self + sizeof(key_type);
+    }
+    static std::size_t Bytes(const key_type& key) {
+        return IsInline(key) ? 0 : (key.capacity() + 1) * sizeof(Char);
+    }
+    static std::size_t Blocks(const key_type& key) {
+        return IsInline(key) ? 0 : 1;
+    }
+};
+
+template <class First, class Second>
+struct KeyHeap<std::pair<First, Second>> {
+    static constexpr bool kOwnsHeap =
+        KeyHeap<First>::kOwnsHeap || KeyHeap<Second>::kOwnsHeap;
+
+    static std::size_t Bytes(const std::pair<First, Second>& key) {
+        return KeyHeap<First>::Bytes(key.first) +
+               KeyHeap<Second>::Bytes(key.second);
+    }
+    static std::size_t Blocks(const std::pair<First, Second>& key) {
+        return KeyHeap<First>::Blocks(key.first) +
+               KeyHeap<Second>::Blocks(key.second);
+    }
+};
+
+// What the keys' own heap blocks take, slack included. Blocks are assumed
+// to be of equal size when a key owns several.
+template <class Key, class Allocator = Malloc>
+std::size_t KeyFootprint(const Key& key) {
+    std::size_t blocks = KeyHeap<Key>::Blocks(key);
+    if (blocks == 0) return 0;
+    return blocks * Allocator::Footprint(KeyHeap<Key>::Bytes(key) / blocks);
+}
+
+// Thrown by an insert that would take a container over its Budget.
+class BudgetExceeded : public std::length_error {
+   public:
+    using std::length_error::length_error;
+};
+
+// A byte limit shared by any number of containers, on any threads: each
+// charges what it allocates before allocating and releases it when freed.
+// The budget only counts; what to do when a charge fails is up to the
+// container (see BudgetedSet).
+class Budget {
+   public:
+    explicit Budget(std::size_t limit) : limit_{limit}, used_{0} {}
+    Budget(const Budget&) = delete;
+    Budget& operator=(const Budget&) = delete;
+
+    std::size_t limit() const { return limit_.load(); }
+    // Lowering the limit below used() only fails later charges.
+    void set_limit(std::size_t limit) { limit_ = limit; }
+    std::size_t used() const { return used_.load(); }
+
+    // Adds bytes to used() unless that would exceed limit().
+    bool TryCharge(std::size_t bytes) {
+        std::size_t used = used_.load(std::memory_order_relaxed);
+        do {
+            if (bytes > limit() || used > limit() - bytes) return false;
+        } while (!used_.compare_exchange_weak(used, used + bytes));
+        return true;
+    }
+    // Adds bytes even past limit(), for costs only known once allocated.
+    void Charge(std::size_t bytes) { used_ += bytes; }
+    void Release(std::size_t bytes) { used_ -= bytes; }
+
+   private:
+    std::atomic<std::size_t> limit_;
+    std::atomic<std::size_t> used_;
+};
+}  // namespace memory
+}  // namespace my_stl
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace my_stl {
+namespace parallel {
+
+struct Options {
+    // Threads to scan with, the caller included; 0 picks
+    // std::thread::hardware_concurrency().
+    unsigned threads = 0;
+    // Runs cut per thread. More runs even out subtrees of different sizes
+    // and threads that start late, at one tree descent per run.
+    std::size_t pieces_per_thread = 8;
+};
+
+// Runs task(i) once for every i in [0, n) on up to `threads` threads,
+// including the caller, and returns when all have finished. Each thread
+// starts on its own contiguous block of indices, taken from the front;
+// one that runs dry steals from the back of another's block, so a thread
+// stuck on a large task does not hold up the rest. If a task throws, the
+// remaining tasks are skipped and the first exception is rethrown here.
+template <class Task>
+void Run(std::size_t n, unsigned threads, const Task& task);
+
+namespace detail {
+// Indices [front, back) not yet taken from one thread's block.
+struct alignas(64) Block {
+    std::mutex mutex;
+    std::size_t front = 0;
+    std::size_t back = 0;
+};
+
+inline bool Take(Block& block, bool steal, std::size_t& index) {
+    std::lock_guard<std::mutex> lock(block.mutex);
+    if (block.front == block.back) return false;
+    index = steal ? --block.back : block.front++;
+    return true;
+}
+
+inline unsigned ThreadCount(const Options& options) {
+    unsigned threads = options.threads;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    return std::max(threads, 1u);
+}
+
+// One result per run, each on its own cache line, so threads writing
+// neighbouring results do not contend; also keeps bool results apart.
+template <class T>
+struct alignas(64) Slot {
+    T value;
+};
+
+// The runs, as in Set::split_points, for `threads` threads.
+template <class Set>
+std::vector<typename Set::const_iterator> Cut(const Set& set,
+                                              unsigned threads,
+                                              const Options& options) {
+    return set.split_points(
+        threads * std::max<std::size_t>(options.pieces_per_thread, 1));
+}
+}  // namespace detail
+
+template <class Task>
+void Run(std::size_t n, unsigned threads, const Task& task) {
+    std::size_t workers = std::min<std::size_t>(std::max(threads, 1u), n);
+    if (workers <= 1) {
+        for (std::size_t i = 0; i < n; ++i) task(i);
+        return;
+    }
+
+    std::vector<detail::Block> blocks(workers);
+    for (std::size_t w = 0; w < workers; ++w) {
+        blocks[w].front = n * w / workers;
+        blocks[w].back = n * (w + 1) / workers;
+    }
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto work = [&](std::size_t self) {
+        std::size_t index;
+        for (std::size_t k = 0; k < workers; ++k) {
+            detail::Block& block = blocks[(self + k) % workers];
+            while (detail::Take(block, k != 0, index)) {
+                try {
+                    task(index);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                    // Drains every block, so all threads stop soon.
+                    for (detail::Block& other : blocks) {
+                        std::lock_guard<std::mutex> drain(other.mutex);
+                        other.front = other.back;
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    try {
+        for (std::size_t w = 1; w < workers; ++w) pool.emplace_back(work, w);
+    } catch (...) {
+        // Could not start a thread: the ones running and the caller still
+        // take every task between them.
+    }
+    work(0);
+    for (std::thread& thread : pool) thread.join();
+    if (error) std::rethrow_exception(error);
+}
+}  // namespace parallel
+
+// Scans of a whole Set on several threads. The set is cut at the top of
+// its tree into runs of about one subtree each (Set::split_points), which
+// threads walk independently; see parallel::Run for the scheduling. Each
+// key is visited exactly once. The set must not change during the call;
+// concurrent reads are fine.
+
+// Calls fn(key) for every key, from several threads at once and in no
+// particular order across runs, so fn must be safe to call concurrently.
+template <class Set, class Fn>
+void parallel_for_each(const Set& set, const Fn& fn,
+                       const parallel::Options& options = {}) {
+    unsigned threads = parallel::detail::ThreadCount(options);
+    auto points = parallel::detail::Cut(set, threads, options);
+    std::size_t runs = points.empty() ? 0 : points.size() - 1;
+    parallel::Run(runs, threads, [&points, &fn](std::size_t i) {
+        for (auto it = points[i]; it != points[i + 1]; ++it) fn(*it);
+    });
+}
+
+// Monoid::Combine over Monoid::Of of every key, as Set::reduce but without
+// the per-node cache and on several threads. Runs are folded separately
+// and their results combined in key order, so Combine only has to be
+// associative, e.g. concatenation; Of is called concurrently.
+template <class Monoid, class Set>
+typename Monoid::value_type parallel_reduce(
+    const Set& set, const parallel::Options& options = {}) {
+    typedef typename Monoid::value_type value_type;
+    unsigned threads = parallel::detail::ThreadCount(options);
+    auto points = parallel::detail::Cut(set, threads, options);
+    std::size_t runs = points.empty() ? 0 : points.size() - 1;
+    std::vector<parallel::detail::Slot<value_type>> partial(runs);
+    parallel::Run(runs, threads, [&points, &partial](std::size_t i) {
+        value_type total = Monoid::Identity();
+        for (auto it = points[i]; it != points[i + 1]; ++it) {
+            total = Monoid::Combine(total, Monoid::Of(*it));
+        }
+        partial[i].value = std::move(total);
+    });
+
+    value_type total = Monoid::Identity();
+    for (parallel::detail::Slot<value_type>& run : partial) {
+        total = Monoid::Combine(total, run.value);
+    }
+    return total;
+}
+
+// Number of keys for which pred(key) is true; pred is called concurrently.
+template <class Set, class Pred>
+std::size_t parallel_count_if(const Set& set, const Pred& pred,
+                              const parallel::Options& options = {}) {
+    unsigned threads = parallel::detail::ThreadCount(options);
+    auto points = parallel::detail::Cut(set, threads, options);
+    std::size_t runs = points.empty() ? 0 : points.size() - 1;
+    std::vector<parallel::detail::Slot<std::size_t>> counts(runs);
+    parallel::Run(runs, threads, [&points, &pred, &counts](std::size_t i) {
+        std::size_t count = 0;
+        for (auto it = points[i]; it != points[i + 1]; ++it) {
+            if (pred(*it)) ++count;
+        }
+        counts[i].value = count;
+    });
+
+    std::size_t total = 0;
+    for (const parallel::detail::Slot<std::size_t>& run : counts) {
+        total += run.value;
+    }
+    return total;
+}
+}  // namespace my_stl
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace my_stl {
+namespace io {
+
+// Delimited text layout shared by Set::write_text and Set::read_text. The
+// defaults reproduce operator<<: "1, 2, 3, \n". With a "\n" delimiter, turn
+// newline_ off so the output does not end in an empty line.
+struct TextFormat {
+    std::string_view delimiter_ = ", ";
+    bool trailing_delimiter_ = true;
+    bool newline_ = true;
+};
+
+// Formats keys into a 64 KiB buffer and hands the stream whole blocks.
+// Arithmetic keys go through std::to_chars, strings are copied as is, and
+// anything else falls back to its operator<<.
+class TextWriter {
+   public:
+    explicit TextWriter(std::ostream& os)
+        : os_{os}, buffer_(kBlockSize), used_{0} {}
+
+    template <class Key>
+    void Append(const Key& key) {
+        if constexpr (std::is_arithmetic_v<Key> &&
+                      !std::is_same_v<Key, bool>) {
+            Reserve(kMaxNumberWidth);
+            std::to_chars_result res = std::to_chars(
+                buffer_.data() + used_, buffer_.data() + buffer_.size(), key);
+            used_ = static_cast<std::size_t>(res.ptr - buffer_.data());
+        } else if constexpr (std::is_convertible_v<const Key&,
+                                                   std::string_view>) {
+            Append(std::string_view(key));
+        } else {
+            Flush();
+            os_ << key;
+        }
+    }
+
+    void Append(std::string_view text) {
+        if (text.size() > buffer_.size() - used_) {
+            Flush();
+            if (text.size() >= buffer_.size()) {
+                os_.write(text.data(),
+                          static_cast<std::streamsize>(text.size()));
+                return;
+            }
+        }
+        text.copy(buffer_.data() + used_, text.size());
+        used_ += text.size();
+    }
+
+    void Flush() {
+        os_.write(buffer_.data(), static_cast<std::streamsize>(used_));
+        used_ = 0;
+    }
+
+   private:
+    static constexpr std::size_t kBlockSize = std::size_t{1} << 16;
+    // Enough for any integer and the shortest round-trip form of a double.
+    static constexpr std::size_t kMaxNumberWidth = 64;
+
+    void Reserve(std::size_t n) {
+        if (buffer_.size() - used_ < n) Flush();
+    }
+
+    std::ostream& os_;
+    std::vector<char> buffer_;
+    std::size_t used_;
+};
+
+// Parses one token. Numbers may be surrounded by whitespace; strings are
+// taken verbatim. Throws std::runtime_error on malformed input.
+template <class Key>
+Key ParseKey(std::string_view token) {
+    if constexpr (std::is_arithmetic_v<Key> && !std::is_same_v<Key, bool>) {
+        const char* first = token.data();
+        const char* last = token.data() + token.size();
+        while (first != last &&
+               std::isspace(static_cast<unsigned char>(*first)))
+            ++first;
+        while (last != first &&
+               std::isspace(static_cast<unsigned char>(*(last - 1))))
+            --last;
+        if (first != last && *first == '+') ++first;
+        Key key{};
+        std::from_chars_result res = std::from_chars(first, last, key);
+        if (res.ec != std::errc() || res.ptr != last || first == last) {
+            throw std::runtime_error("my_stl::io: bad key '" +
+                                     std::string(token) + "'");
+        }
+        return key;
+    } else if constexpr (std::is_constructible_v<Key, std::string_view>) {
+        return Key(token);
+    } else {
+        std::istringstream in{std::string(token)};
+        Key key;
+        if (!(in >> key) || !(in >> std::ws).eof()) {
+            throw std::runtime_error("my_stl::io: bad key '" +
+                                     std::string(token) + "'");
+        }
+        return key;
+    }
+}
+
+// Splits the whole stream on format.delimiter_, reading it in 64 KiB
+// blocks, and calls fn on every token. A trailing delimiter and the final
+// newline written by TextWriter are not tokens.
+template <class Fn>
+void ForEachToken(std::istream& is, const TextFormat& format, Fn&& fn) {
+    if (format.delimiter_.empty()) {
+        throw std::invalid_argument("my_stl::io: empty delimiter");
+    }
+    constexpr std::size_t kBlockSize = std::size_t{1} << 16;
+    std::string buffer;
+    std::size_t pos = 0;
+    std::vector<char> block(kBlockSize);
+
+    while (is) {
+        is.read(block.data(), static_cast<std::streamsize>(block.size()));
+        buffer.append(block.data(), static_cast<std::size_t>(is.gcount()));
+        for (std::size_t next; (next = buffer.find(format.delimiter_, pos)) !=
+                               std::string::npos;
+             pos = next + format.delimiter_.size()) {
+            fn(std::string_view(buffer).substr(pos, next - pos));
+        }
+        buffer.erase(0, pos);
+        pos = 0;
+    }
+
+    std::string_view rest(buffer);
+    if (format.newline_ && !rest.empty() && rest.back() == '\n') {
+        rest.remove_suffix(1);
+    }
+    if (!rest.empty()) fn(rest);
+}
+}  // namespace io
+}  // namespace my_stl
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Define MY_STL_TRACING to 0 (consistently across the program) to compile
+// tracing out: TracedSet then reads no clocks and holds no recorder.
+#ifndef MY_STL_TRACING
+#define MY_STL_TRACING 1
+#endif
+
+namespace my_stl {
+namespace trace {
+
+inline constexpr bool kTracingEnabled = MY_STL_TRACING != 0;
+
+enum class Op : std::uint8_t {
+    kInsert,
+    kErase,
+    kFind,
+    kLowerBound,
+    kCopy,
+    kClear,
+};
+inline constexpr std::size_t kOpCount = 6;
+
+const char* OpName(Op op);
+
+// Log-bucketed latency histogram in the HDR style: values below 8 get a
+// bucket each, and every power of two above is split into 8 linear
+// sub-buckets, so a reported value is within 12.5% of the recorded one
+// over the whole 64-bit range. Recording is a few relaxed atomic
+// increments, safe from any number of threads without a lock.
+class Histogram {
+   public:
+    static constexpr std::size_t kSubBuckets = 8;
+    static constexpr std::size_t kBucketCount = 496;
+
+    Histogram();
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void Record(std::uint64_t value);
+    void Reset();
+
+    std::uint64_t Count() const;
+    std::uint64_t Sum() const;
+    std::uint64_t Max() const;
+    // Upper bound of the bucket holding the q-quantile, capped at Max();
+    // 0 if nothing was recorded.
+    std::uint64_t Percentile(double q) const;
+
+    static std::size_t BucketOf(std::uint64_t value);
+    // Smallest value that lands in the given bucket.
+    static std::uint64_t BucketFloor(std::size_t bucket);
+
+    // {"count": .., "sum": .., "max": .., "p50": .., "p90": .., "p99": ..,
+    //  "p999": .., "buckets": [[floor, count], ...]}, empty buckets omitted.
+    void WriteJson(std::ostream& os) const;
+
+   private:
+    std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_;
+    std::atomic<std::uint64_t> count_;
+    std::atomic<std::uint64_t> sum_;
+    std::atomic<std::uint64_t> max_;
+};
+
+// One sampled operation, for the Chrome trace view.
+struct Event {
+    Op op_;
+    std::uint32_t thread_;
+    std::uint64_t start_ns_;
+    std::uint64_t duration_ns_;
+};
+
+// Latency histograms for every Op, plus an optional sample of individual
+// operations. Every sample_every-th operation (0: none) is kept, up to
+// max_events; later samples are dropped. Recording never locks. The dumps
+// read whatever has been recorded so far and are meant for quiescent
+// points such as the end of a run.
+class Recorder {
+   public:
+    explicit Recorder(std::size_t sample_every = 0,
+                      std::size_t max_events = std::size_t{1} << 16);
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Shared by every TracedSet that is not given a recorder of its own.
+    static Recorder& Global();
+
+    void Record(Op op, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point stop);
+    void Reset();
+
+    const Histogram& Latency(Op op) const;
+    std::size_t EventCount() const;
+
+    // {"insert": <histogram>, "erase": ..., ...}, latencies in nanoseconds.
+    void WriteJson(std::ostream& os) const;
+    // Sampled operations in the Trace Event format read by chrome://tracing
+    // and Perfetto.
+    void WriteChromeTrace(std::ostream& os) const;
+
+   private:
+    std::array<Histogram, kOpCount> latency_;
+    std::size_t sample_every_;
+    std::atomic<std::uint64_t> operations_;
+    std::vector<Event> events_;
+    std::atomic<std::size_t> event_count_;
+    std::chrono::steady_clock::time_point epoch_;
+};
+
+// What a traced container keeps of its recorder: a pointer, or an empty
+// object when tracing is compiled out.
+template <bool Enabled = kTracingEnabled>
+class RecorderRef {
+   public:
+    explicit RecorderRef(Recorder* recorder) : recorder_{recorder} {}
+    Recorder* get() const { return recorder_; }
+
+   private:
+    Recorder* recorder_;
+};
+
+template <>
+class RecorderRef<false> {
+   public:
+    explicit RecorderRef(Recorder*) {}
+    Recorder* get() const { return nullptr; }
+};
+
+// Times one operation and hands it to a recorder on destruction; a null
+// recorder or disabled tracing makes it a no-op.
+class ScopedOp {
+   public:
+    ScopedOp(Recorder* recorder, Op op);
+    ScopedOp(const ScopedOp&) = delete;
+    ScopedOp& operator=(const ScopedOp&) = delete;
+    ~ScopedOp();
+
+   private:
+    Recorder* recorder_;
+    Op op_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline ScopedOp::ScopedOp(Recorder* recorder, Op op)
+    : recorder_{recorder}, op_{op}, start_{} {
+    if constexpr (kTracingEnabled) {
+        if (recorder_ != nullptr) start_ = std::chrono::steady_clock::now();
+    }
+}
+
+inline ScopedOp::~ScopedOp() {
+    if constexpr (kTracingEnabled) {
+        if (recorder_ != nullptr) {
+            recorder_->Record(op_, start_, std::chrono::steady_clock::now());
+        }
+    }
+}
+}  // namespace trace
+}  // namespace my_stl
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "set_codec.h"
+#include "set_trace.h"
+
+namespace my_stl {
+namespace io {
+
+// Workload file written by RecordingSet and replayed by set_replay:
+//   WorkloadHeader | block | block | ...
+// Every block is a WorkloadBlock followed by count_ records:
+//   op (1 byte) | time delta in ns (LEB128) | key (Codec<Key>)
+// Clear and copy carry no key. Blocks are self-contained and checksummed,
+// so a file cut short by a crash is still readable up to the last whole
+// block: WorkloadReader ends there instead of throwing.
+constexpr char kWorkloadMagic[4] = {'M', 'S', 'W', 'L'};
+constexpr std::uint16_t kWorkloadVersion = 1;
+
+struct WorkloadHeader {
+    char magic_[4];
+    std::uint16_t version_;
+    std::uint16_t reserved_;
+    std::uint32_t byte_order_;
+    std::uint32_t key_tag_;
+    std::uint64_t key_size_;
+};
+static_assert(sizeof(WorkloadHeader) == 24,
+              "WorkloadHeader must have no padding");
+
+struct WorkloadBlock {
+    std::uint32_t count_;
+    std::uint32_t reserved_;
+    std::uint64_t payload_size_;
+    std::uint64_t checksum_;
+};
+static_assert(sizeof(WorkloadBlock) == 24,
+              "WorkloadBlock must have no padding");
+
+// One operation: what was done, when (ns since recording started) and to
+// which key. key_ is default-constructed for clear and copy.
+template <class Key>
+struct WorkloadRecord {
+    trace::Op op_;
+    std::uint64_t time_ns_;
+    Key key_;
+};
+
+inline bool HasKey(trace::Op op) {
+    return op != trace::Op::kClear && op != trace::Op::kCopy;
+}
+
+// Reads and validates the file header. Throws std::runtime_error if the
+// stream does not hold a workload file.
+inline WorkloadHeader ReadWorkloadHeader(std::istream& is) {
+    WorkloadHeader header{};
+    is.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (static_cast<std::size_t>(is.gcount()) != sizeof(header) ||
+        std::memcmp(header.magic_, kWorkloadMagic, sizeof(header.magic_)) !=
+            0 ||
+        header.version_ != kWorkloadVersion) {
+        throw std::runtime_error("my_stl::io: not a workload file");
+    }
+    if (header.byte_order_ != kByteOrderMark) {
+        throw std::runtime_error("my_stl::io: workload byte order mismatch");
+    }
+    return header;
+}
+
+// Appends records to a workload file, a block of up to kBlockRecords at a
+// time. The destructor writes out the last partial block.
+template <class Key>
+class WorkloadWriter {
+   public:
+    static constexpr std::size_t kBlockRecords = 4096;
+
+    explicit WorkloadWriter(std::ostream& os);
+    WorkloadWriter(const WorkloadWriter&) = delete;
+    WorkloadWriter& operator=(const WorkloadWriter&) = delete;
+    ~WorkloadWriter();
+
+    void Append(trace::Op op, std::uint64_t time_ns, const Key& key);
+    void Flush();
+
+   private:
+    void Encode(const WorkloadRecord<Key>& record, std::uint64_t& last_ns,
+                Writer& writer) const;
+
+    std::ostream& os_;
+    std::vector<WorkloadRecord<Key>> pending_;
+    std::uint64_t last_ns_;
+};
+
+// Reads a workload file record by record.
+template <class Key>
+class WorkloadReader {
+   public:
+    // Throws std::runtime_error if the file was written for another key
+    // type.
+    explicit WorkloadReader(std::istream& is);
+
+    // False at the end of the file, or where it ends inside a block.
+    // Throws std::runtime_error on a damaged block.
+    bool Next(WorkloadRecord<Key>& record);
+    // True once the file turned out to end inside a block, e.g. cut short
+    // by a crash; that block's records are dropped unread.
+    bool Truncated() const;
+
+   private:
+    void ReadBlock();
+    void DecodeRecords(Reader& reader, std::uint32_t count);
+
+    std::istream& is_;
+    std::vector<WorkloadRecord<Key>> block_;
+    std::size_t pos_;
+    std::uint64_t last_ns_;
+    bool truncated_;
+};
+
+template <class Key>
+WorkloadWriter<Key>::WorkloadWriter(std::ostream& os)
+    : os_{os}, pending_(), last_ns_{0} {
+    WorkloadHeader header{};
+    std::memcpy(header.magic_, kWorkloadMagic, sizeof(header.magic_));
+    header.version_ = kWorkloadVersion;
+    header.byte_order_ = kByteOrderMark;
+    header.key_tag_ = Codec<Key>::kTag;
+    header.key_size_ = Codec<Key>::kSize;
+    os_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pending_.reserve(kBlockRecords);
+}
+
+template <class Key>
+WorkloadWriter<Key>::~WorkloadWriter() {
+    try {
+        Flush();
+    } catch (...) {
+        // The stream reports the failure through its state.
+    }
+}
+
+template <class Key>
+void WorkloadWriter<Key>::Append(trace::Op op, std::uint64_t time_ns,
+                                 const Key& key) {
+    pending_.push_back(WorkloadRecord<Key>{op, time_ns, key});
+    if (pending_.size() == kBlockRecords) Flush();
+}
+
+template <class Key>
+void WorkloadWriter<Key>::Encode(const WorkloadRecord<Key>& record,
+                                 std::uint64_t& last_ns,
+                                 Writer& writer) const {
+    std::uint8_t op = static_cast<std::uint8_t>(record.op_);
+    writer.Write(&op, 1);
+    std::uint64_t delta = record.time_ns_ - last_ns;
+    last_ns = record.time_ns_;
+    do {
+        std::uint8_t byte = static_cast<std::uint8_t>(
+            (delta & 0x7f) | (delta > 0x7f ? 0x80 : 0));
+        writer.Write(&byte, 1);
+        delta >>= 7;
+    } while (delta != 0);
+    if (HasKey(record.op_)) Codec<Key>::Encode(record.key_, writer);
+}
+
+template <class Key>
+void WorkloadWriter<Key>::Flush() {
+    if (pending_.empty()) return;
+
+    std::uint64_t last_ns = last_ns_;
+    Writer measure;
+    for (const auto& record : pending_) Encode(record, last_ns, measure);
+    measure.Flush();
+
+    WorkloadBlock block{};
+    block.count_ = static_cast<std::uint32_t>(pending_.size());
+    block.payload_size_ = measure.Size();
+    block.checksum_ = measure.Digest();
+    os_.write(reinterpret_cast<const char*>(&block), sizeof(block));
+
+    Writer writer(os_);
+    for (const auto& record : pending_) Encode(record, last_ns_, writer);
+    writer.Flush();
+    os_.flush();
+    pending_.clear();
+}
+
+template <class Key>
+WorkloadReader<Key>::WorkloadReader(std::istream& is)
+    : is_{is}, block_(), pos_{0}, last_ns_{0}, truncated_{false} {
+    WorkloadHeader header = ReadWorkloadHeader(is_);
+    if (header.key_tag_ != Codec<Key>::kTag ||
+        header.key_size_ != Codec<Key>::kSize) {
+        throw std::runtime_error("my_stl::io: workload key type mismatch");
+    }
+}
+
+template <class Key>
+bool WorkloadReader<Key>::Next(WorkloadRecord<Key>& record) {
+    if (pos_ == block_.size()) {
+        ReadBlock();
+        if (block_.empty()) return false;
+    }
+    record = std::move(block_[pos_++]);
+    return true;
+}
+
+template <class Key>
+void WorkloadReader<Key>::DecodeRecords(Reader& reader, std::uint32_t count) {
+    for (std::uint32_t i = 0; i < count; ++i) {
+        WorkloadRecord<Key> record{};
+        std::uint8_t op = 0;
+        reader.Read(&op, 1);
+        if (op >= trace::kOpCount) {
+            throw std::runtime_error("my_stl::io: bad workload record");
+        }
+        record.op_ = static_cast<trace::Op>(op);
+        std::uint64_t delta = 0;
+        for (int shift = 0;; shift += 7) {
+            std::uint8_t byte = 0;
+            reader.Read(&byte, 1);
+            if (shift > 63) {
+                throw std::runtime_error("my_stl::io: bad workload record");
+            }
+            delta |= std::uint64_t{byte & 0x7fu} << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        last_ns_ += delta;
+        record.time_ns_ = last_ns_;
+        if (HasKey(record.op_)) record.key_ = Codec<Key>::Decode(reader);
+        block_.push_back(std::move(record));
+    }
+}
+
+template <class Key>
+bool WorkloadReader<Key>::Truncated() const {
+    return truncated_;
+}
+
+template <class Key>
+void WorkloadReader<Key>::ReadBlock() {
+    block_.clear();
+    pos_ = 0;
+
+    WorkloadBlock block{};
+    is_.read(reinterpret_cast<char*>(&block), sizeof(block));
+    if (is_.gcount() == 0) return;
+    if (static_cast<std::size_t>(is_.gcount()) != sizeof(block)) {
+        truncated_ = true;
+        return;
+    }
+
+    // Each record takes at least two bytes, the op and the time delta, so
+    // a damaged count cannot turn into a huge reservation.
+    if (block.count_ > block.payload_size_ / 2) {
+        throw std::runtime_error("my_stl::io: bad workload block");
+    }
+    Reader reader(is_, block.payload_size_);
+    block_.reserve(block.count_);
+    try {
+        DecodeRecords(reader, block.count_);
+    } catch (const std::runtime_error&) {
+        // Running out of file inside the block means the capture was cut
+        // short, not damaged. Its records cannot be verified, so the block
+        // is dropped whole.
+        if (!is_.eof()) throw;
+        block_.clear();
+        truncated_ = true;
+        return;
+    }
+    if (!reader.Exhausted() || reader.Digest() != block.checksum_) {
+        throw std::runtime_error("my_stl::io: workload checksum mismatch");
+    }
+}
+}  // namespace io
+}  // namespace my_stl
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "my_set.h"
+
+namespace my_stl {
+
+// Set for many writer threads: the key space is cut into ranges, each kept
+// by its own Set behind its own lock, so updates to different ranges run
+// in parallel. Finding a key's shard is a binary search over the split
+// keys of the current layout, read through an atomic pointer without a
+// lock, so an update writes only to its own shard: its lock and its count.
+//
+// The shards rebalance online. When one outgrows twice its fair share of
+// size() / shards, it is split at a sampled median, a middle one of its
+// Set::split_points. When one shrinks below a quarter of its share, it is
+// merged into a neighbour. The shares are those of the last rebalance, so
+// updates compare their shard's own size against them. A rebalance locks
+// only the shards it replaces, publishes a new layout and marks the old
+// shards retired; an update that finds its shard retired reloads the
+// layout. The cost is linear in the shards involved, amortised over the
+// updates that made them uneven.
+//
+// Because a reader may still be using an old layout, the layouts and
+// retired shards a rebalance replaces are kept, emptied, until the set is
+// destroyed: a pointer and a key per shard for each split or merge.
+//
+// insert, erase, contains, size, for_each and copying are safe to call
+// concurrently. Iterators are not synchronised: begin, end, find and
+// lower_bound walk the shards in key order, and are only valid while no
+// other thread writes.
+template <class Key>
+class ShardedSet {
+   public:
+    typedef Key key_type;
+    class const_iterator;
+    typedef const_iterator iterator;
+
+    static constexpr std::size_t kDefaultShards = 16;
+    // Shards below this size are never split: locking is not the
+    // bottleneck there.
+    static constexpr std::size_t kMinSplitSize = 4096;
+
+    ShardedSet();
+    // About `shards` shards once the set is large; it starts with one.
+    explicit ShardedSet(std::size_t shards);
+    ShardedSet(const ShardedSet& other);
+    ShardedSet& operator=(const ShardedSet&) = delete;
+
+    bool insert(const key_type&);
+    size_t erase(const key_type&);
+    bool contains(const key_type&) const;
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+    size_t shard_count() const;
+
+    // Calls fn(key) for every key in ascending order, holding one shard's
+    // lock at a time; fn must not write to this set.
+    template <class Fn>
+    Fn for_each(Fn fn) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator find(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+
+   private:
+    struct Shard {
+        mutable std::shared_mutex mutex_;
+        Set<Key> set_;
+        // set_.size(), for reading without the lock.
+        std::atomic<size_t> size_{0};
+        // Replaced by a rebalance: empty and in no later layout.
+        bool retired_{false};
+    };
+
+    // Immutable once published.
+    struct Layout {
+        std::vector<std::shared_ptr<Shard>> shards_;
+        // bounds_[i] is the smallest key shard i + 1 may hold.
+        std::vector<Key> bounds_;
+    };
+
+    const Layout& Current() const;
+    static size_t ShardIndex(const Layout& layout, const key_type& key);
+    // Shard whose range holds key, locked with lock; retries on the new
+    // layout if a rebalance retired it first.
+    template <class Lock>
+    Shard& Acquire(const key_type& key, Lock& lock) const;
+    size_t SplitSize(size_t total) const;
+    size_t MergeSize(size_t total) const;
+    // Splits and merges shards until all are within bounds; takes
+    // rebalance_.
+    void Rebalance();
+    void Split(size_t index);
+    // Moves shard index + 1 into shard index.
+    void Merge(size_t index);
+    // Makes layout current; needs rebalance_ held.
+    void Publish(std::unique_ptr<Layout> layout);
+    static void Retire(Shard& shard);
+    // First key at or after position `it` of shard `shard`, skipping empty
+    // shards.
+    const_iterator Skip(size_t shard,
+                        typename Set<Key>::const_iterator it) const;
+
+    // Held by rebalances and clear, and shared by whole-set reads.
+    mutable std::shared_mutex rebalance_;
+    // Every layout published, the current one last.
+    std::vector<std::unique_ptr<Layout>> layouts_;
+    std::atomic<const Layout*> layout_;
+    // Shard sizes that call for a rebalance, from the last one's total.
+    std::atomic<size_t> split_size_;
+    std::atomic<size_t> merge_size_;
+    size_t target_;
+};
+
+// Forward iterator over all shards in key order.
+template <class Key>
+class ShardedSet<Key>::const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Key value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Key* pointer;
+    typedef const Key& reference;
+
+    const_iterator() : owner_{nullptr}, shard_{0}, it_() {}
+
+    const Key& operator*() const { return *it_; }
+    const Key* operator->() const { return &*it_; }
+    const_iterator& operator++() {
+        *this = owner_->Skip(shard_, std::next(it_));
+        return *this;
+    }
+    const_iterator operator++(int) {
+        const_iterator tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+    bool operator==(const const_iterator& other) const {
+        return shard_ == other.shard_ && it_ == other.it_;
+    }
+    bool operator!=(const const_iterator& other) const {
+        return !(*this == other);
+    }
+
+   private:
+    friend class ShardedSet;
+    const_iterator(const ShardedSet* owner, size_t shard,
+                   typename Set<Key>::const_iterator it)
+        : owner_{owner}, shard_{shard}, it_(it) {}
+
+    const ShardedSet* owner_;
+    size_t shard_;
+    typename Set<Key>::const_iterator it_;
+};
+
+template <class Key>
+ShardedSet<Key>::ShardedSet() : ShardedSet(kDefaultShards) {}
+
+template <class Key>
+ShardedSet<Key>::ShardedSet(std::size_t shards)
+    : rebalance_(), layouts_(), layout_{nullptr},
+      split_size_{kMinSplitSize}, merge_size_{0},
+      target_{std::max<std::size_t>(shards, 1)} {
+    auto layout = std::make_unique<Layout>();
+    layout->shards_.push_back(std::make_shared<Shard>());
+    Publish(std::move(layout));
+}
+
+template <class Key>
+ShardedSet<Key>::ShardedSet(const ShardedSet& other)
+    : rebalance_(), layouts_(), layout_{nullptr},
+      split_size_{other.split_size_.load()},
+      merge_size_{other.merge_size_.load()}, target_{other.target_} {
+    std::shared_lock<std::shared_mutex> guard(other.rebalance_);
+    const Layout& from = other.Current();
+    auto layout = std::make_unique<Layout>();
+    layout->bounds_ = from.bounds_;
+    for (const std::shared_ptr<Shard>& shard : from.shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex_);
+        layout->shards_.push_back(std::make_shared<Shard>());
+        layout->shards_.back()->set_ = shard->set_;
+        layout->shards_.back()->size_ = shard->set_.size();
+    }
+    Publish(std::move(layout));
+}
+
+template <class Key>
+const typename ShardedSet<Key>::Layout& ShardedSet<Key>::Current() const {
+    return *layout_.load(std::memory_order_acquire);
+}
+
+template <class Key>
+size_t ShardedSet<Key>::ShardIndex(const Layout& layout,
+                                   const key_type& key) {
+    return static_cast<size_t>(
+        std::upper_bound(layout.bounds_.begin(), layout.bounds_.end(), key) -
+        layout.bounds_.begin());
+}
+
+template <class Key>
+template <class Lock>
+typename ShardedSet<Key>::Shard& ShardedSet<Key>::Acquire(
+    const key_type& key, Lock& lock) const {
+    for (;;) {
+        const Layout& layout = Current();
+        Shard& shard = *layout.shards_[ShardIndex(layout, key)];
+        lock = Lock(shard.mutex_);
+        // A rebalance publishes its layout before it lets go of the shards
+        // it retires, so the reload finds the one that replaced this.
+        if (!shard.retired_) return shard;
+        lock.unlock();
+    }
+}
+
+template <class Key>
+size_t ShardedSet<Key>::SplitSize(size_t total) const {
+    return std::max(kMinSplitSize, 2 * total / target_);
+}
+
+template <class Key>
+size_t ShardedSet<Key>::MergeSize(size_t total) const {
+    return total / (4 * target_);
+}
+
+template <class Key>
+bool ShardedSet<Key>::insert(const key_type& key) {
+    bool split;
+    {
+        std::unique_lock<std::shared_mutex> lock;
+        Shard& shard = Acquire(key, lock);
+        if (!shard.set_.insert(key).second) return false;
+        size_t size = shard.set_.size();
+        shard.size_.store(size, std::memory_order_relaxed);
+        split = size > split_size_.load(std::memory_order_relaxed);
+    }
+    if (split) Rebalance();
+    return true;
+}
+
+template <class Key>
+size_t ShardedSet<Key>::erase(const key_type& key) {
+    bool merge;
+    {
+        std::unique_lock<std::shared_mutex> lock;
+        Shard& shard = Acquire(key, lock);
+        if (shard.set_.erase(key) == 0) return 0;
+        size_t size = shard.set_.size();
+        shard.size_.store(size, std::memory_order_relaxed);
+        merge = size < merge_size_.load(std::memory_order_relaxed);
+    }
+    if (merge) Rebalance();
+    return 1;
+}
+
+template <class Key>
+bool ShardedSet<Key>::contains(const key_type& key) const {
+    std::shared_lock<std::shared_mutex> lock;
+    const Shard& shard = Acquire(key, lock);
+    return shard.set_.contains(key);
+}
+
+template <class Key>
+void ShardedSet<Key>::clear() {
+    std::unique_lock<std::shared_mutex> guard(rebalance_);
+    const Layout& old = Current();
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    for (const std::shared_ptr<Shard>& shard : old.shards_) {
+        locks.emplace_back(shard->mutex_);
+    }
+    auto layout = std::make_unique<Layout>();
+    layout->shards_.push_back(std::make_shared<Shard>());
+    Publish(std::move(layout));
+    for (const std::shared_ptr<Shard>& shard : old.shards_) Retire(*shard);
+    split_size_ = kMinSplitSize;
+    merge_size_ = 0;
+}
+
+template <class Key>
+void ShardedSet<Key>::Rebalance() {
+    std::unique_lock<std::shared_mutex> guard(rebalance_);
+    // Other writers may have rebalanced since the caller looked, so every
+    // shard is checked against the current totals.
+    size_t total = 0;
+    for (const std::shared_ptr<Shard>& shard : Current().shards_) {
+        total += shard->size_;
+    }
+    size_t split = SplitSize(total);
+    size_t merge = MergeSize(total);
+    for (size_t i = 0; i < Current().shards_.size();) {
+        const std::vector<std::shared_ptr<Shard>>& shards = Current().shards_;
+        size_t size = shards[i]->size_;
+        if (size > split) {
+            Split(i);
+        } else if (shards.size() > 1 && size < merge) {
+            // Into the smaller neighbour, unless that would split again.
+            size_t left = i == 0 ? i : i - 1;
+            if (i != 0 && i + 1 < shards.size() &&
+                shards[i + 1]->size_ < shards[i - 1]->size_) {
+                left = i;
+            }
+            if (shards[left]->size_ + shards[left + 1]->size_ >= split) {
+                ++i;
+                continue;
+            }
+            Merge(left);
+            i = left;
+        } else {
+            ++i;
+        }
+    }
+    split_size_ = split;
+    merge_size_ = Current().shards_.size() > 1 ? merge : 0;
+}
+
+template <class Key>
+void ShardedSet<Key>::Split(size_t index) {
+    const Layout& old = Current();
+    Shard& shard = *old.shards_[index];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+    // A middle one of the tree's top keys: a sampled median.
+    std::vector<typename Set<Key>::const_iterator> points =
+        shard.set_.split_points(16);
+    Key median = *points[points.size() / 2];
+
+    // Both halves are new shards: a writer still on the old layout would
+    // otherwise put a key of the upper range into the lower one.
+    std::vector<BatchOp<Key>> low;
+    std::vector<BatchOp<Key>> high;
+    for (const Key& key : shard.set_) {
+        (key < median ? low : high).push_back({key, true});
+    }
+    auto lower = std::make_shared<Shard>();
+    lower->set_.apply_batch(low);
+    lower->size_ = lower->set_.size();
+    auto upper = std::make_shared<Shard>();
+    upper->set_.apply_batch(high);
+    upper->size_ = upper->set_.size();
+
+    auto layout = std::make_unique<Layout>(old);
+    layout->shards_[index] = std::move(lower);
+    layout->shards_.insert(layout->shards_.begin() + index + 1,
+                           std::move(upper));
+    layout->bounds_.insert(layout->bounds_.begin() + index, median);
+    Publish(std::move(layout));
+    Retire(shard);
+}
+
+template <class Key>
+void ShardedSet<Key>::Merge(size_t index) {
+    const Layout& old = Current();
+    Shard& lower = *old.shards_[index];
+    Shard& upper = *old.shards_[index + 1];
+    std::unique_lock<std::shared_mutex> lower_lock(lower.mutex_);
+    std::unique_lock<std::shared_mutex> upper_lock(upper.mutex_);
+    // The lower shard keeps its place: its range only grows, so writers on
+    // the old layout still find their keys' shard.
+    std::vector<BatchOp<Key>> moved;
+    for (const Key& key : upper.set_) moved.push_back({key, true});
+    lower.set_.apply_batch(moved);
+    lower.size_ = lower.set_.size();
+
+    auto layout = std::make_unique<Layout>(old);
+    layout->shards_.erase(layout->shards_.begin() + index + 1);
+    layout->bounds_.erase(layout->bounds_.begin() + index);
+    Publish(std::move(layout));
+    Retire(upper);
+}
+
+template <class Key>
+void ShardedSet<Key>::Publish(std::unique_ptr<Layout> layout) {
+    layout_.store(layout.get(), std::memory_order_release);
+    layouts_.push_back(std::move(layout));
+}
+
+template <class Key>
+void ShardedSet<Key>::Retire(Shard& shard) {
+    shard.retired_ = true;
+    shard.set_.clear();
+    shard.size_ = 0;
+}
+
+template <class Key>
+size_t ShardedSet<Key>::size() const {
+    std::shared_lock<std::shared_mutex> guard(rebalance_);
+    size_t total = 0;
+    for (const std::shared_ptr<Shard>& shard : Current().shards_) {
+        total += shard->size_;
+    }
+    return total;
+}
+
+template <class Key>
+bool ShardedSet<Key>::empty() const {
+    return size() == 0;
+}
+
+template <class Key>
+size_t ShardedSet<Key>::shard_count() const {
+    return Current().shards_.size();
+}
+
+template <class Key>
+template <class Fn>
+Fn ShardedSet<Key>::for_each(Fn fn) const {
+    std::shared_lock<std::shared_mutex> guard(rebalance_);
+    for (const std::shared_ptr<Shard>& shard : Current().shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex_);
+        for (const Key& key : shard->set_) fn(key);
+    }
+    return fn;
+}
+
+template <class Key>
+typename ShardedSet<Key>::const_iterator ShardedSet<Key>::Skip(
+    size_t shard, typename Set<Key>::const_iterator it) const {
+    const Layout& layout = Current();
+    while (it == layout.shards_[shard]->set_.end()) {
+        if (++shard == layout.shards_.size()) return end();
+        it = layout.shards_[shard]->set_.begin();
+    }
+    return const_iterator(this, shard, it);
+}
+
+template <class Key>
+typename ShardedSet<Key>::const_iterator ShardedSet<Key>::begin() const {
+    return Skip(0, Current().shards_[0]->set_.begin());
+}
+
+template <class Key>
+typename ShardedSet<Key>::const_iterator ShardedSet<Key>::end() const {
+    return const_iterator(this, Current().shards_.size(),
+                          typename Set<Key>::const_iterator());
+}
+
+template <class Key>
+typename ShardedSet<Key>::const_iterator ShardedSet<Key>::find(
+    const key_type& key) const {
+    const Layout& layout = Current();
+    size_t shard = ShardIndex(layout, key);
+    const Set<Key>& set = layout.shards_[shard]->set_;
+    typename Set<Key>::const_iterator it = set.find(key);
+    if (it == set.end()) return end();
+    return const_iterator(this, shard, it);
+}
+
+template <class Key>
+typename ShardedSet<Key>::const_iterator ShardedSet<Key>::lower_bound(
+    const key_type& key) const {
+    const Layout& layout = Current();
+    size_t shard = ShardIndex(layout, key);
+    return Skip(shard, layout.shards_[shard]->set_.lower_bound(key));
+}
+}  // namespace my_stl
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include "eytzinger.h"
+
+namespace my_stl {
+
+// Fixed set of at most N keys, built from a literal list in a constexpr
+// context, e.g.
+//
+//   constexpr my_stl::StaticSet<std::string_view, 3> kReserved{
+//       {"if", "else", "while"}};
+//
+// The list is sorted and deduplicated at compile time and stored inline in
+// Eytzinger order (see eytzinger.h), so a constant set costs nothing at
+// startup and lookups are branch-free descents over a few cache lines.
+// Reads mirror Set and are all constexpr. Key must be default-constructible
+// and, to be built at compile time, a literal type ordered by a constexpr
+// operator<.
+template <class Key, std::size_t N>
+class StaticSet {
+    static_assert(N > 0, "StaticSet needs at least one key");
+
+   public:
+    typedef Key key_type;
+    typedef my_stl::eytzinger::ConstIterator<Key> iterator;
+    typedef my_stl::eytzinger::ConstIterator<Key> const_iterator;
+
+    constexpr StaticSet(const Key (&keys)[N]);
+
+    constexpr const_iterator begin() const;
+    constexpr const_iterator end() const;
+
+    // Distinct keys, at most N.
+    constexpr size_t size() const;
+    constexpr bool empty() const;
+
+    constexpr const_iterator find(const key_type&) const;
+    constexpr bool contains(const key_type&) const;
+    constexpr const_iterator lower_bound(const key_type&) const;
+    constexpr const_iterator upper_bound(const key_type&) const;
+
+   private:
+    // Slots [0, size_) in Eytzinger order; the rest default-constructed.
+    std::array<Key, N> keys_;
+    size_t size_;
+};
+
+template <class Key, std::size_t N>
+constexpr StaticSet<Key, N>::StaticSet(const Key (&keys)[N])
+    : keys_(), size_{0} {
+    std::array<Key, N> sorted{};
+    std::copy_n(keys, N, sorted.begin());
+    std::sort(sorted.begin(), sorted.end());
+    size_ = static_cast<size_t>(std::unique(sorted.begin(), sorted.end()) -
+                                sorted.begin());
+    my_stl::eytzinger::Fill(sorted.begin(), keys_.data(), size_);
+}
+
+template <class Key, std::size_t N>
+constexpr typename StaticSet<Key, N>::const_iterator
+StaticSet<Key, N>::begin() const {
+    return const_iterator(keys_.data(), size_,
+                          my_stl::eytzinger::First(size_));
+}
+
+template <class Key, std::size_t N>
+constexpr typename StaticSet<Key, N>::const_iterator
+StaticSet<Key, N>::end() const {
+    return const_iterator(keys_.data(), size_, size_);
+}
+
+template <class Key, std::size_t N>
+constexpr size_t StaticSet<Key, N>::size() const {
+    return size_;
+}
+
+template <class Key, std::size_t N>
+constexpr bool StaticSet<Key, N>::empty() const {
+    return size_ == 0;
+}
+
+template <class Key, std::size_t N>
+constexpr typename StaticSet<Key, N>::const_iterator StaticSet<Key, N>::find(
+    const key_type& value) const {
+    const_iterator i(lower_bound(value));
+    if (i != end() && (value < *i)) {
+        i = end();
+    }
+    return i;
+}
+
+template <class Key, std::size_t N>
+constexpr bool StaticSet<Key, N>::contains(const key_type& value) const {
+    std::size_t slot =
+        my_stl::eytzinger::LowerBound(keys_.data(), size_, value);
+    return slot != size_ && !(value < keys_[slot]);
+}
+
+template <class Key, std::size_t N>
+constexpr typename StaticSet<Key, N>::const_iterator
+StaticSet<Key, N>::lower_bound(const key_type& value) const {
+    return const_iterator(
+        keys_.data(), size_,
+        my_stl::eytzinger::LowerBound(keys_.data(), size_, value));
+}
+
+template <class Key, std::size_t N>
+constexpr typename StaticSet<Key, N>::const_iterator
+StaticSet<Key, N>::upper_bound(const key_type& value) const {
+    return const_iterator(
+        keys_.data(), size_,
+        my_stl::eytzinger::UpperBound(keys_.data(), size_, value));
+}
+}  // namespace my_stl
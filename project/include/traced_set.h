@@ -0,0 +1,163 @@
+#pragma once
+
+#include <initializer_list>
+#include <utility>
+
+#include "my_set.h"
+#include "set_trace.h"
+
+namespace my_stl {
+
+// Set whose insert, erase, find, lower_bound, copy and clear report their
+// latency to a trace::Recorder: the global one by default, one given per
+// instance, or none (nullptr). Everything else is passed through untimed.
+// With MY_STL_TRACING defined to 0 this is a plain Set of the same size.
+template <class Key, class Stats = my_rbt::stats::NullStats>
+class TracedSet {
+   public:
+    typedef Set<Key, Stats> set_type;
+    typedef typename set_type::key_type key_type;
+    typedef typename set_type::iterator iterator;
+    typedef typename set_type::const_iterator const_iterator;
+
+    TracedSet();
+    explicit TracedSet(trace::Recorder* recorder);
+    TracedSet(std::initializer_list<key_type> list);
+    // The copy reports to the same recorder as other.
+    TracedSet(const TracedSet& other);
+    TracedSet& operator=(const TracedSet& other);
+
+    trace::Recorder* recorder() const;
+    void set_recorder(trace::Recorder* recorder);
+    // The underlying set, for operations that are not traced.
+    const set_type& get() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+    std::pair<const_iterator, bool> insert(const key_type&);
+    void erase(iterator);
+    size_t erase(const key_type&);
+    void clear();
+
+    const_iterator find(const key_type&) const;
+    const_iterator lower_bound(const key_type&) const;
+    const_iterator upper_bound(const key_type&) const;
+
+   private:
+    set_type set_;
+    [[no_unique_address]] trace::RecorderRef<> recorder_;
+};
+
+template <class Key, class Stats>
+TracedSet<Key, Stats>::TracedSet()
+    : set_(), recorder_(&trace::Recorder::Global()) {}
+
+template <class Key, class Stats>
+TracedSet<Key, Stats>::TracedSet(trace::Recorder* recorder)
+    : set_(), recorder_(recorder) {}
+
+template <class Key, class Stats>
+TracedSet<Key, Stats>::TracedSet(std::initializer_list<key_type> list)
+    : set_(list), recorder_(&trace::Recorder::Global()) {}
+
+template <class Key, class Stats>
+TracedSet<Key, Stats>::TracedSet(const TracedSet& other)
+    : set_(), recorder_(other.recorder_) {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kCopy);
+    set_ = other.set_;
+}
+
+template <class Key, class Stats>
+TracedSet<Key, Stats>& TracedSet<Key, Stats>::operator=(
+    const TracedSet& other) {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kCopy);
+    set_ = other.set_;
+    return *this;
+}
+
+template <class Key, class Stats>
+trace::Recorder* TracedSet<Key, Stats>::recorder() const {
+    return recorder_.get();
+}
+
+template <class Key, class Stats>
+void TracedSet<Key, Stats>::set_recorder(trace::Recorder* recorder) {
+    recorder_ = trace::RecorderRef<>(recorder);
+}
+
+template <class Key, class Stats>
+const typename TracedSet<Key, Stats>::set_type& TracedSet<Key, Stats>::get()
+    const {
+    return set_;
+}
+
+template <class Key, class Stats>
+typename TracedSet<Key, Stats>::const_iterator TracedSet<Key, Stats>::begin()
+    const {
+    return set_.begin();
+}
+
+template <class Key, class Stats>
+typename TracedSet<Key, Stats>::const_iterator TracedSet<Key, Stats>::end()
+    const {
+    return set_.end();
+}
+
+template <class Key, class Stats>
+size_t TracedSet<Key, Stats>::size() const {
+    return set_.size();
+}
+
+template <class Key, class Stats>
+bool TracedSet<Key, Stats>::empty() const {
+    return set_.empty();
+}
+
+template <class Key, class Stats>
+std::pair<typename TracedSet<Key, Stats>::const_iterator, bool>
+TracedSet<Key, Stats>::insert(const key_type& value) {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kInsert);
+    return set_.insert(value);
+}
+
+template <class Key, class Stats>
+void TracedSet<Key, Stats>::erase(iterator position) {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kErase);
+    set_.erase(position);
+}
+
+template <class Key, class Stats>
+size_t TracedSet<Key, Stats>::erase(const key_type& value) {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kErase);
+    return set_.erase(value);
+}
+
+template <class Key, class Stats>
+void TracedSet<Key, Stats>::clear() {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kClear);
+    set_.clear();
+}
+
+template <class Key, class Stats>
+typename TracedSet<Key, Stats>::const_iterator TracedSet<Key, Stats>::find(
+    const key_type& value) const {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kFind);
+    return set_.find(value);
+}
+
+template <class Key, class Stats>
+typename TracedSet<Key, Stats>::const_iterator
+TracedSet<Key, Stats>::lower_bound(const key_type& value) const {
+    trace::ScopedOp op(recorder_.get(), trace::Op::kLowerBound);
+    return set_.lower_bound(value);
+}
+
+template <class Key, class Stats>
+typename TracedSet<Key, Stats>::const_iterator
+TracedSet<Key, Stats>::upper_bound(const key_type& value) const {
+    return set_.upper_bound(value);
+}
+}  // namespace my_stl
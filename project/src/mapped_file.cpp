@@ -0,0 +1,83 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+namespace my_stl {
+namespace io {
+
+MappedFile::MappedFile() : data_{nullptr}, size_{0} {}
+
+MappedFile::MappedFile(const std::string& path) : data_{nullptr}, size_{0} {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "MappedFile: open " + path);
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(),
+                                "MappedFile: stat " + path);
+    }
+
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ != 0) {
+        void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(),
+                                    "MappedFile: mmap " + path);
+        }
+        data_ = static_cast<const char*>(addr);
+    }
+    // The mapping keeps the file referenced on its own.
+    ::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)},
+      size_{std::exchange(other.size_, 0)} {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() { Unmap(); }
+
+const char* MappedFile::data() const { return data_; }
+
+std::size_t MappedFile::size() const { return size_; }
+
+void MappedFile::WillNeed(std::size_t offset, std::size_t length) const {
+    if (data_ == nullptr || offset >= size_) return;
+    std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t begin = offset / page * page;
+    std::size_t end = std::min(size_, offset + length);
+    ::madvise(const_cast<char*>(data_) + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::Unmap() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+}  // namespace io
+}  // namespace my_stl
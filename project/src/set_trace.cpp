@@ -0,0 +1,193 @@
+#include "set_trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <thread>
+
+namespace my_stl {
+namespace trace {
+
+namespace {
+
+std::uint64_t Load(const std::atomic<std::uint64_t>& a) {
+    return a.load(std::memory_order_relaxed);
+}
+
+std::uint32_t CurrentThread() {
+    return static_cast<std::uint32_t>(
+        std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+}  // namespace
+
+const char* OpName(Op op) {
+    switch (op) {
+        case Op::kInsert:
+            return "insert";
+        case Op::kErase:
+            return "erase";
+        case Op::kFind:
+            return "find";
+        case Op::kLowerBound:
+            return "lower_bound";
+        case Op::kCopy:
+            return "copy";
+        case Op::kClear:
+            return "clear";
+    }
+    return "unknown";
+}
+
+Histogram::Histogram() : buckets_{}, count_{0}, sum_{0}, max_{0} {}
+
+std::size_t Histogram::BucketOf(std::uint64_t value) {
+    if (value < kSubBuckets) return static_cast<std::size_t>(value);
+    // value has its top bit at position e >= 3; keep the three bits below.
+    std::size_t e = static_cast<std::size_t>(std::bit_width(value)) - 1;
+    std::size_t sub = static_cast<std::size_t>(value >> (e - 3)) & 7;
+    return (e - 2) * kSubBuckets + sub;
+}
+
+std::uint64_t Histogram::BucketFloor(std::size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    std::size_t e = bucket / kSubBuckets + 2;
+    std::uint64_t sub = bucket % kSubBuckets;
+    return (kSubBuckets + sub) << (e - 3);
+}
+
+void Histogram::Record(std::uint64_t value) {
+    buckets_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    std::uint64_t seen = Load(max_);
+    while (value > seen &&
+           !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::Reset() {
+    for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t Histogram::Count() const { return Load(count_); }
+
+std::uint64_t Histogram::Sum() const { return Load(sum_); }
+
+std::uint64_t Histogram::Max() const { return Load(max_); }
+
+std::uint64_t Histogram::Percentile(double q) const {
+    std::uint64_t total = 0;
+    for (const auto& b : buckets_) total += Load(b);
+    if (total == 0) return 0;
+
+    q = std::clamp(q, 0.0, 1.0);
+    std::uint64_t rank = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(q * static_cast<double>(total) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        seen += Load(buckets_[i]);
+        if (seen >= rank) {
+            std::uint64_t top = (i + 1 < kBucketCount)
+                                    ? BucketFloor(i + 1) - 1
+                                    : ~std::uint64_t{0};
+            return std::min(top, Max());
+        }
+    }
+    return Max();
+}
+
+void Histogram::WriteJson(std::ostream& os) const {
+    os << "{\"count\": " << Count() << ", \"sum\": " << Sum()
+       << ", \"max\": " << Max() << ", \"p50\": " << Percentile(0.5)
+       << ", \"p90\": " << Percentile(0.9) << ", \"p99\": " << Percentile(0.99)
+       << ", \"p999\": " << Percentile(0.999) << ", \"buckets\": [";
+    const char* sep = "";
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        std::uint64_t n = Load(buckets_[i]);
+        if (n == 0) continue;
+        os << sep << '[' << BucketFloor(i) << ", " << n << ']';
+        sep = ", ";
+    }
+    os << "]}";
+}
+
+Recorder::Recorder(std::size_t sample_every, std::size_t max_events)
+    : latency_{},
+      sample_every_{sample_every},
+      operations_{0},
+      events_(sample_every == 0 ? 0 : max_events),
+      event_count_{0},
+      epoch_{std::chrono::steady_clock::now()} {}
+
+Recorder& Recorder::Global() {
+    static Recorder recorder;
+    return recorder;
+}
+
+void Recorder::Record(Op op, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point stop) {
+    std::uint64_t ns = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+            .count());
+    latency_[static_cast<std::size_t>(op)].Record(ns);
+
+    if (sample_every_ == 0) return;
+    if (operations_.fetch_add(1, std::memory_order_relaxed) % sample_every_ !=
+        0) {
+        return;
+    }
+    std::size_t slot = event_count_.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= events_.size()) return;
+    events_[slot] = Event{
+        op, CurrentThread(),
+        static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_)
+                .count()),
+        ns};
+}
+
+void Recorder::Reset() {
+    for (auto& h : latency_) h.Reset();
+    operations_.store(0, std::memory_order_relaxed);
+    event_count_.store(0, std::memory_order_relaxed);
+    epoch_ = std::chrono::steady_clock::now();
+}
+
+const Histogram& Recorder::Latency(Op op) const {
+    return latency_[static_cast<std::size_t>(op)];
+}
+
+std::size_t Recorder::EventCount() const {
+    return std::min(event_count_.load(std::memory_order_relaxed),
+                    events_.size());
+}
+
+void Recorder::WriteJson(std::ostream& os) const {
+    os << '{';
+    for (std::size_t i = 0; i < kOpCount; ++i) {
+        os << (i ? ",\n " : "") << '"' << OpName(static_cast<Op>(i))
+           << "\": ";
+        latency_[i].WriteJson(os);
+    }
+    os << "}\n";
+}
+
+void Recorder::WriteChromeTrace(std::ostream& os) const {
+    // Complete ("X") events; the format counts time in microseconds.
+    os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    std::size_t n = EventCount();
+    for (std::size_t i = 0; i < n; ++i) {
+        const Event& e = events_[i];
+        os << (i ? ",\n" : "\n") << "  {\"name\": \"" << OpName(e.op_)
+           << "\", \"cat\": \"my_stl::Set\", \"ph\": \"X\", \"ts\": "
+           << static_cast<double>(e.start_ns_) / 1000
+           << ", \"dur\": " << static_cast<double>(e.duration_ns_) / 1000
+           << ", \"pid\": 1, \"tid\": " << e.thread_ << '}';
+    }
+    os << "\n]}\n";
+}
+}  // namespace trace
+}  // namespace my_stl
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+// Expectations shared by the tests of containers with the Set interface,
+// checked against a std::set holding the same keys.
+namespace set_expect {
+
+// Same size and keys, walked forwards and backwards.
+template <class Set, class Key>
+void ExpectSame(const Set& set, const std::set<Key>& expected) {
+    ASSERT_EQ(set.size(), expected.size());
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), expected.begin(),
+                           expected.end()));
+    std::vector<Key> backward;
+    for (auto it = set.end(); it != set.begin();) backward.push_back(*--it);
+    EXPECT_TRUE(std::equal(backward.begin(), backward.end(),
+                           expected.rbegin(), expected.rend()));
+}
+
+// contains, find, lower_bound and upper_bound agree for key.
+template <class Set, class Key>
+void ExpectSameBounds(const Set& set, const std::set<Key>& expected,
+                      const std::type_identity_t<Key>& key) {
+    bool present = expected.count(key) == 1;
+    EXPECT_EQ(set.contains(key), present) << key;
+    EXPECT_EQ(set.find(key) != set.end(), present) << key;
+    auto lower = set.lower_bound(key);
+    auto expected_lower = expected.lower_bound(key);
+    ASSERT_EQ(lower == set.end(), expected_lower == expected.end()) << key;
+    if (lower != set.end()) {
+        EXPECT_EQ(*lower, *expected_lower);
+    }
+    auto upper = set.upper_bound(key);
+    auto expected_upper = expected.upper_bound(key);
+    ASSERT_EQ(upper == set.end(), expected_upper == expected.end()) << key;
+    if (upper != set.end()) {
+        EXPECT_EQ(*upper, *expected_upper);
+    }
+}
+}  // namespace set_expect
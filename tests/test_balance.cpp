@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <set>
+#include <vector>
+
+#include "my_set.h"
+#include "rb_tree.h"
+
+namespace {
+struct Sum {
+    typedef long value_type;
+    static long Identity() { return 0; }
+    static long Of(int key) { return key; }
+    static long Combine(long a, long b) { return a + b; }
+};
+
+template <typename Balance>
+using Tree = my_rbt::RBTree<int, my_rbt::stats::CountingStats,
+                            std::less<int>, my_rbt::key_of_value::Identity,
+                            my_rbt::augment::None, Balance>;
+
+// Checks links, order and the policy's invariant under n; returns the
+// height in nodes.
+template <typename Balance, typename Node>
+int CheckSubtree(const Node* n, const Node* parent) {
+    if (n == nullptr) return 0;
+    EXPECT_EQ(n->parent_, parent);
+    if (n->left_ != nullptr) {
+        EXPECT_LT(n->left_->key_, n->key_);
+    }
+    if (n->right_ != nullptr) {
+        EXPECT_LT(n->key_, n->right_->key_);
+    }
+    int left = CheckSubtree<Balance>(n->left_, n);
+    int right = CheckSubtree<Balance>(n->right_, n);
+
+    if constexpr (std::is_same_v<Balance, my_rbt::balance::Avl>) {
+        EXPECT_LE(std::abs(left - right), 1);
+        EXPECT_EQ(n->color_, 1 + std::max(left, right));
+    } else if constexpr (std::is_same_v<Balance, my_rbt::balance::Wavl>) {
+        for (const Node* child : {n->left_, n->right_}) {
+            int diff = n->color_ - my_rbt::balance::Wavl::Rank(child);
+            EXPECT_TRUE(diff == 1 || diff == 2);
+        }
+        if (n->left_ == nullptr && n->right_ == nullptr) {
+            EXPECT_EQ(n->color_, 0);
+        }
+    }
+    return 1 + std::max(left, right);
+}
+
+// Red nodes have black children and every path down to a leaf crosses
+// the same number of black nodes; returns that number.
+template <typename Node>
+int CheckBlackHeight(const Node* n) {
+    if (n == nullptr) return 1;
+    if (!my_rbt::balance::RedBlack::IsBlack(n)) {
+        EXPECT_TRUE(my_rbt::balance::RedBlack::IsBlack(n->left_));
+        EXPECT_TRUE(my_rbt::balance::RedBlack::IsBlack(n->right_));
+    }
+    int left = CheckBlackHeight(n->left_);
+    EXPECT_EQ(left, CheckBlackHeight(n->right_));
+    return left + my_rbt::balance::RedBlack::IsBlack(n);
+}
+
+template <typename Balance>
+void CheckTree(const Tree<Balance>& tree) {
+    typedef typename Tree<Balance>::node_type Node;
+    const Node* root = tree.GetRoot();
+    CheckSubtree<Balance, Node>(root, nullptr);
+    if constexpr (std::is_same_v<Balance, my_rbt::balance::RedBlack>) {
+        EXPECT_TRUE(my_rbt::balance::RedBlack::IsBlack(root));
+        CheckBlackHeight(root);
+    }
+}
+}  // namespace
+
+template <typename Balance>
+class TestBalance : public ::testing::Test {};
+
+typedef ::testing::Types<my_rbt::balance::RedBlack, my_rbt::balance::Avl,
+                         my_rbt::balance::Wavl>
+    Policies;
+TYPED_TEST_SUITE(TestBalance, Policies);
+
+TYPED_TEST(TestBalance, MatchesStdSet) {
+    Tree<TypeParam> tree;
+    std::set<int> std_set;
+    unsigned state = 2024;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1103515245u + 12345u;
+        int key = static_cast<int>((state >> 8) % 2000);
+        if (state % 7 < 4) {
+            EXPECT_EQ(tree.InsertUnique(key).second,
+                      std_set.insert(key).second);
+        } else {
+            EXPECT_EQ(tree.Erase(key), std_set.erase(key));
+        }
+        if (i % 1000 == 0) CheckTree(tree);
+    }
+    CheckTree(tree);
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), std_set.begin(),
+                           std_set.end()));
+
+    // Ascending inserts are the worst case for an unbalanced tree.
+    Tree<TypeParam> ascending;
+    for (int i = 0; i < 4096; ++i) ascending.Insert(i);
+    CheckTree(ascending);
+    EXPECT_LE(ascending.GetShape().height_, 2 * 13);
+
+    Tree<TypeParam> copy(tree);
+    CheckTree(copy);
+    std::vector<int> keys(1000);
+    std::iota(keys.begin(), keys.end(), 0);
+    auto next = keys.begin();
+    copy.AssignSorted(keys.size(), [&next]() { return *next++; });
+    CheckTree(copy);
+    for (int key = 0; key < 1000; key += 3) copy.Erase(key);
+    CheckTree(copy);
+    EXPECT_EQ(copy.GetSize(), 666);
+}
+
+TEST(TestBalance, SetWithAggregates) {
+    my_stl::Set<int, my_rbt::stats::CountingStats, Sum, 0,
+                my_stl::filter::None, false, my_rbt::balance::Avl>
+        avl;
+    my_stl::Set<int, my_rbt::stats::CountingStats, Sum, 0,
+                my_stl::filter::None, false, my_rbt::balance::Wavl>
+        wavl;
+    for (int i = 0; i < 3000; ++i) {
+        avl.insert(i);
+        wavl.insert(i);
+    }
+    for (int i = 0; i < 3000; i += 2) {
+        avl.erase(i);
+        wavl.erase(i);
+    }
+    // 1 + 3 + ... + 2999 = 1500^2
+    EXPECT_EQ(avl.reduce(0, 3000), 1500L * 1500);
+    EXPECT_EQ(wavl.reduce(0, 3000), 1500L * 1500);
+    EXPECT_EQ(avl.reduce(100, 200), wavl.reduce(100, 200));
+    EXPECT_EQ(avl.shape().black_height_, 0);
+    // An AVL tree of 1500 keys is at most 1.44 log2(1502) < 16 nodes deep.
+    EXPECT_LE(avl.shape().height_, 15);
+    EXPECT_GT(avl.stats().rotations_left_, 0u);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "buffered_set.h"
+
+TEST(TestBufferedSet, MatchesStdSet) {
+    // A small capacity exercises both the key-by-key and the rebuild merge.
+    my_stl::BufferedSet<std::string> s(64);
+    std::set<std::string> std_set;
+    unsigned state = 41;
+    for (int i = 0; i < 40000; ++i) {
+        state = state * 1103515245u + 12345u;
+        std::string key = std::to_string((state >> 8) % 3000);
+        if (state % 5 < 3) {
+            s.insert(key);
+            std_set.insert(key);
+        } else {
+            s.erase(key);
+            std_set.erase(key);
+        }
+        if (i % 97 == 0) {
+            ASSERT_EQ(s.contains(key), std_set.count(key) == 1);
+            ASSERT_EQ(s.pending(), 0);
+        }
+        if (i % 5000 == 0) {
+            auto it = s.lower_bound("5");
+            auto expected = std_set.lower_bound("5");
+            ASSERT_EQ(it == s.end(), expected == std_set.end());
+            if (expected != std_set.end()) {
+                ASSERT_EQ(*it, *expected);
+            }
+        }
+    }
+    EXPECT_EQ(s.size(), std_set.size());
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), std_set.begin(), std_set.end()));
+    EXPECT_EQ(s.shape().node_count_, std_set.size());
+}
+
+TEST(TestBufferedSet, DefersWork) {
+    my_stl::BufferedSet<int, my_rbt::stats::CountingStats> s(1000);
+    for (int i = 999; i >= 0; --i) s.insert(i % 500);
+    s.erase(7);
+    s.insert(7);
+    s.erase(8);
+    // Only the 1000th operation filled the log; the rest is still pending.
+    EXPECT_EQ(s.pending(), 3);
+    EXPECT_EQ(s.stats().comparisons_, 0);
+
+    my_stl::BufferedSet<int, my_rbt::stats::CountingStats> copy(s);
+    EXPECT_EQ(copy.size(), 499);
+    EXPECT_TRUE(copy.contains(7));
+    EXPECT_FALSE(copy.contains(8));
+    EXPECT_EQ(s.pending(), 3);
+
+    s.flush();
+    EXPECT_EQ(s.pending(), 0);
+    EXPECT_EQ(*s.begin(), 0);
+    s.clear();
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(TestBufferedSet, ReverseIterationWithPendingOps) {
+    my_stl::BufferedSet<int> s;
+    s.insert(1);
+    s.flush();
+    s.insert(9);
+    EXPECT_EQ(*std::prev(s.end()), 9);
+    s.insert(5);
+    s.erase(9);
+    std::vector<int> backward;
+    for (auto it = s.end(); it != s.begin();) backward.push_back(*--it);
+    EXPECT_EQ(backward, (std::vector<int>{5, 1}));
+}
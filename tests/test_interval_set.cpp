@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "interval_set.h"
+
+namespace {
+typedef std::pair<int, int> Interval;
+
+std::vector<Interval> Scan(const std::vector<Interval>& all, int lo, int hi) {
+    std::vector<Interval> out;
+    for (const Interval& i : all) {
+        if (i.first <= hi && lo <= i.second) out.push_back(i);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+}  // namespace
+
+TEST(TestIntervalSet, MatchesLinearScan) {
+    my_stl::IntervalSet<int> s;
+    std::vector<Interval> all;
+    unsigned state = 99;
+    auto next = [&state](unsigned mod) {
+        state = state * 1103515245u + 12345u;
+        return static_cast<int>((state >> 8) % mod);
+    };
+    for (int i = 0; i < 4000; ++i) {
+        int start = next(10000);
+        Interval interval{start, start + next(i % 10 == 0 ? 2000 : 50)};
+        if (s.insert(interval).second) all.push_back(interval);
+    }
+    // Erasing reshapes the tree, so the subtree maxima must follow.
+    for (int i = 0; i < 1500; ++i) {
+        std::size_t victim = next(static_cast<unsigned>(all.size()));
+        EXPECT_EQ(s.erase(all[victim]), 1);
+        all.erase(all.begin() + victim);
+    }
+    ASSERT_EQ(s.size(), all.size());
+    EXPECT_LE(s.shape().height_, 2 * s.shape().black_height_);
+
+    for (int q = 0; q < 500; ++q) {
+        int lo = next(11000) - 500;
+        int hi = lo + next(q % 2 == 0 ? 1 : 300);
+        std::vector<Interval> expected = Scan(all, lo, hi);
+        EXPECT_EQ(s.overlapping(lo, hi), expected);
+        EXPECT_EQ(s.any_overlap(lo, hi), !expected.empty());
+        EXPECT_EQ(s.overlapping(lo), Scan(all, lo, lo));
+    }
+}
+
+TEST(TestIntervalSet, Basics) {
+    my_stl::IntervalSet<int> s{{1, 5}, {3, 3}, {10, 20}, {1, 5}};
+    EXPECT_EQ(s.size(), 3);
+    EXPECT_EQ(s.begin()->first, 1);
+    EXPECT_TRUE(s.contains({3, 3}));
+    EXPECT_EQ(s.overlapping(3), (std::vector<Interval>{{1, 5}, {3, 3}}));
+    EXPECT_EQ(s.overlapping(5, 10), (std::vector<Interval>{{1, 5}, {10, 20}}));
+    EXPECT_FALSE(s.any_overlap(6, 9));
+    EXPECT_TRUE(s.overlapping(21).empty());
+    EXPECT_THROW(s.insert({4, 2}), std::invalid_argument);
+
+    int count = 0;
+    s.for_each_overlap(0, 100, [&count](const Interval&) { ++count; });
+    EXPECT_EQ(count, 3);
+
+    my_stl::IntervalSet<int> copy(s);
+    s.clear();
+    EXPECT_TRUE(copy.any_overlap(15, 15));
+    EXPECT_FALSE(s.any_overlap(15, 15));
+}
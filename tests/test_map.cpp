@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "my_map.h"
+
+namespace {
+// Not default constructible; counts how often it is built.
+struct Tracked {
+    static int constructed;
+
+    explicit Tracked(int v) : value_{v} { ++constructed; }
+    Tracked(const Tracked& other) : value_{other.value_} { ++constructed; }
+    Tracked& operator=(const Tracked&) = default;
+
+    int value_;
+};
+int Tracked::constructed = 0;
+}  // namespace
+
+TEST(TestMap, MatchesStdMap) {
+    my_stl::Map<int, int> m;
+    std::map<int, int> std_map;
+    unsigned state = 4242;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1103515245u + 12345u;
+        int key = static_cast<int>((state >> 8) % 500);
+        switch (state % 4) {
+            case 0:
+                m[key] += i;
+                std_map[key] += i;
+                break;
+            case 1:
+                EXPECT_EQ(m.insert_or_assign(key, i).second,
+                          std_map.insert_or_assign(key, i).second);
+                break;
+            case 2:
+                EXPECT_EQ(m.erase(key), std_map.erase(key));
+                break;
+            default:
+                EXPECT_EQ(m.try_emplace(key, -i).second,
+                          std_map.try_emplace(key, -i).second);
+        }
+    }
+    EXPECT_EQ(m.size(), std_map.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), std_map.begin(), std_map.end()));
+
+    my_stl::Map<int, int> copy(m);
+    for (auto it = copy.begin(); it != copy.end(); ++it) it->second = 0;
+    EXPECT_EQ(copy.size(), m.size());
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), std_map.begin(), std_map.end()));
+    EXPECT_EQ(m.lower_bound(250)->first, std_map.lower_bound(250)->first);
+}
+
+TEST(TestMap, SingleDescentWithoutTemporaries) {
+    my_stl::Map<int, Tracked, std::less<int>, my_rbt::stats::CountingStats> m;
+    for (int i = 0; i < 1000; ++i) m.try_emplace(i, i);
+    EXPECT_EQ(Tracked::constructed, 1000);
+
+    // Existing key: one search, nothing built.
+    m.reset_stats();
+    auto hit = m.try_emplace(500, -1);
+    EXPECT_FALSE(hit.second);
+    EXPECT_EQ(hit.first->second.value_, 500);
+    EXPECT_EQ(Tracked::constructed, 1000);
+    EXPECT_EQ(m.stats().searches_, 1);
+    EXPECT_EQ(m.stats().allocations_, 0);
+
+    // insert_or_assign assigns in place.
+    m.reset_stats();
+    EXPECT_FALSE(m.insert_or_assign(500, Tracked(7)).second);
+    EXPECT_EQ(m.at(500).value_, 7);
+    EXPECT_EQ(m.stats().searches_, 2);
+    EXPECT_EQ(m.stats().allocations_, 0);
+
+    const auto& cm = m;
+    EXPECT_EQ(cm.at(999).value_, 999);
+    EXPECT_THROW(cm.at(1000), std::out_of_range);
+    EXPECT_THROW(m.at(-1), std::out_of_range);
+}
+
+TEST(TestMap, StringKeys) {
+    my_stl::Map<std::string, std::string> m{{"b", "2"}, {"a", "1"}};
+    std::string key = "c";
+    m[std::move(key)] = "3";
+    m["a"] += "!";
+    EXPECT_EQ(m.size(), 3);
+    EXPECT_EQ(m.begin()->second, "1!");
+    EXPECT_EQ(m.find("c")->second, "3");
+    EXPECT_TRUE(m.contains("b"));
+    EXPECT_EQ(m.count("z"), 0);
+    auto next = m.erase(m.find("b"));
+    EXPECT_EQ(next->first, "c");
+    EXPECT_EQ(m.size(), 2);
+}
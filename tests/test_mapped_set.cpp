@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mapped_set.h"
+#include "my_set.h"
+
+namespace {
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+}  // namespace
+
+TEST(TestMappedSet, MatchesSet) {
+    std::string path = TempPath("test_mapped_set_matches.bin");
+    for (int n : {0, 1, 2, 3, 7, 8, 100, 1023, 5000}) {
+        my_stl::Set<int> s;
+        std::set<int> std_set;
+        for (int i = 0; i < n; ++i) {
+            s.insert(i * 3 - n);
+            std_set.insert(i * 3 - n);
+        }
+        {
+            std::ofstream out(path, std::ios::binary);
+            my_stl::MappedSet<int>::write(out, s);
+        }
+        my_stl::MappedSet<int> mapped(path);
+        EXPECT_EQ(mapped.size(), std_set.size());
+        EXPECT_EQ(mapped.empty(), std_set.empty());
+        EXPECT_TRUE(mapped.verify());
+        EXPECT_TRUE(std::equal(mapped.begin(), mapped.end(), std_set.begin(),
+                               std_set.end()));
+
+        std::vector<int> backwards;
+        for (auto it = mapped.end(); it != mapped.begin();) {
+            backwards.push_back(*--it);
+        }
+        EXPECT_TRUE(std::equal(backwards.begin(), backwards.end(),
+                               std_set.rbegin(), std_set.rend()));
+
+        for (int x = -n - 2; x < 2 * n + 2; ++x) {
+            auto it = mapped.lower_bound(x);
+            auto want = std_set.lower_bound(x);
+            if (want == std_set.end()) {
+                EXPECT_EQ(it, mapped.end());
+            } else {
+                EXPECT_EQ(*it, *want);
+            }
+            auto up = mapped.upper_bound(x);
+            auto want_up = std_set.upper_bound(x);
+            EXPECT_EQ(up == mapped.end(), want_up == std_set.end());
+            EXPECT_EQ(mapped.contains(x), std_set.count(x) == 1);
+            EXPECT_EQ(mapped.find(x) != mapped.end(), std_set.count(x) == 1);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TestMappedSet, RejectsOtherFiles) {
+    std::string path = TempPath("test_mapped_set_reject.bin");
+    {
+        std::ofstream out(path, std::ios::binary);
+        my_stl::Set<int>{1, 2, 3}.save(out);
+    }
+    EXPECT_THROW(my_stl::MappedSet<int>{path}, std::runtime_error);
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::vector<int> keys{1, 2, 3};
+        my_stl::MappedSet<int>::write(out, keys.begin(), keys.end());
+    }
+    EXPECT_THROW(my_stl::MappedSet<long long>{path}, std::runtime_error);
+    my_stl::MappedSet<int> mapped(path);
+    my_stl::MappedSet<int> moved(std::move(mapped));
+    EXPECT_EQ(moved.size(), 3);
+    EXPECT_TRUE(mapped.empty());
+
+    std::vector<int> unsorted{3, 1};
+    std::ofstream out(path, std::ios::binary);
+    EXPECT_THROW(
+        my_stl::MappedSet<int>::write(out, unsorted.begin(), unsorted.end()),
+        std::invalid_argument);
+    std::remove(path.c_str());
+}
+
+TEST(TestMappedSet, RejectsOverflowingCount) {
+    std::string path = TempPath("test_mapped_set_count.bin");
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::vector<std::uint64_t> keys{1};
+        my_stl::MappedSet<std::uint64_t>::write(out, keys.begin(), keys.end());
+    }
+    // count_ * 8 wraps around to the 8-byte payload.
+    {
+        std::fstream file(path,
+                          std::ios::binary | std::ios::in | std::ios::out);
+        std::uint64_t count = (std::uint64_t{1} << 61) + 1;
+        file.seekp(offsetof(my_stl::io::FileHeader, count_));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    EXPECT_THROW(my_stl::MappedSet<std::uint64_t>{path}, std::runtime_error);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "budgeted_set.h"
+#include "my_set.h"
+
+TEST(TestMemory, Usage) {
+    typedef my_stl::Set<int> IntSet;
+    IntSet set;
+    my_stl::memory::Usage empty = set.memory_usage();
+    EXPECT_EQ(empty.object_, sizeof(IntSet));
+    EXPECT_EQ(empty.nodes_, 0);
+    EXPECT_EQ(empty.slack_, 0);
+    for (int i = 0; i < 1000; ++i) set.insert(i);
+    my_stl::memory::Usage usage = set.memory_usage();
+    EXPECT_EQ(usage.nodes_ % 1000, 0);
+    EXPECT_GE(usage.nodes_, 1000 * (3 * sizeof(void*) + sizeof(int)));
+    EXPECT_EQ(usage.keys_, 0);
+    EXPECT_EQ(my_stl::memory::Total(usage),
+              usage.object_ + usage.nodes_ + usage.slack_);
+    EXPECT_EQ(my_stl::memory::Total(usage),
+              sizeof(IntSet) + 1000 * IntSet::key_footprint(0));
+    EXPECT_EQ(set.memory_usage<my_stl::memory::Exact>().slack_, 0);
+
+    // Inline keys take no nodes until they spill.
+    my_stl::Set<int, my_rbt::stats::NullStats, my_rbt::augment::None, 8>
+        small{1, 2, 3};
+    EXPECT_EQ(small.memory_usage().nodes_, 0);
+    for (int i = 0; i < 9; ++i) small.insert(i);
+    EXPECT_EQ(small.memory_usage().nodes_ % 9, 0);
+    EXPECT_GT(small.memory_usage().nodes_, 0);
+
+    my_stl::Set<int, my_rbt::stats::NullStats, my_rbt::augment::None, 0,
+                my_stl::filter::BlockedBloom<int>>
+        filtered{1, 2, 3};
+    EXPECT_GT(filtered.memory_usage().index_, 0);
+
+    // Only strings too long for the object own heap memory.
+    my_stl::Set<std::string> strings{"a", "b"};
+    EXPECT_EQ(strings.memory_usage().keys_, 0);
+    std::string long_key(100, 'x');
+    strings.insert(long_key);
+    EXPECT_GE(strings.memory_usage().keys_, 101);
+    EXPECT_GT(my_stl::Set<std::string>::key_footprint(long_key),
+              my_stl::Set<std::string>::key_footprint("a") + 100);
+}
+
+TEST(TestMemory, BudgetFailsFast) {
+    const std::size_t cost = my_stl::Set<int>::key_footprint(0);
+    my_stl::memory::Budget budget(10 * cost);
+    {
+        my_stl::BudgetedSet<int> set(&budget);
+        for (int i = 0; i < 10; ++i) EXPECT_TRUE(set.insert(i).second);
+        EXPECT_EQ(budget.used(), 10 * cost);
+        // Present keys cost nothing.
+        EXPECT_FALSE(set.insert(3).second);
+        EXPECT_THROW(set.insert(10), my_stl::memory::BudgetExceeded);
+        EXPECT_EQ(set.size(), 10);
+        EXPECT_FALSE(set.contains(10));
+
+        // Sharing the budget, a second set gets what the first frees.
+        my_stl::BudgetedSet<int> other(&budget);
+        EXPECT_THROW(other.insert(1), my_stl::memory::BudgetExceeded);
+        set.erase(0);
+        EXPECT_TRUE(other.insert(1).second);
+        EXPECT_EQ(budget.used(), 10 * cost);
+        EXPECT_THROW(my_stl::BudgetedSet<int> copy(set),
+                     my_stl::memory::BudgetExceeded);
+        set.clear();
+        EXPECT_EQ(budget.used(), cost);
+    }
+    EXPECT_EQ(budget.used(), 0);
+}
+
+TEST(TestMemory, BudgetEvicts) {
+    my_stl::memory::Budget budget(20 * 1024);
+    my_stl::BudgetedSet<std::string> set(&budget);
+    int evictions = 0;
+    // Evicts the smallest keys, oldest first here, like an LRU by key.
+    set.set_evict([&set, &evictions](std::size_t) {
+        if (set.empty()) return false;
+        ++evictions;
+        set.erase(set.begin());
+        return true;
+    });
+    for (int i = 0; i < 1000; ++i) {
+        set.insert(std::to_string(100000 + i) + std::string(40, 'k'));
+        ASSERT_LE(budget.used(), budget.limit());
+    }
+    EXPECT_GT(evictions, 0);
+    EXPECT_EQ(set.size() + evictions, 1000);
+    EXPECT_EQ(set.charged(), budget.used());
+    EXPECT_TRUE(set.contains(std::to_string(100999) + std::string(40, 'k')));
+    my_stl::memory::Usage usage = set.memory_usage();
+    EXPECT_EQ(usage.nodes_ + usage.keys_ + usage.slack_, set.charged());
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "my_multiset.h"
+
+namespace {
+struct ByFirst {
+    bool operator()(const std::pair<int, int>& a,
+                    const std::pair<int, int>& b) const {
+        return a.first < b.first;
+    }
+};
+}  // namespace
+
+TEST(TestMultiSet, MatchesStdMultiset) {
+    my_stl::MultiSet<int> s;
+    std::multiset<int> std_set;
+    unsigned state = 777;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1103515245u + 12345u;
+        int key = static_cast<int>((state >> 8) % 300);
+        if (state % 3 != 0) {
+            s.insert(key);
+            std_set.insert(key);
+        } else if (state % 2 == 0) {
+            EXPECT_EQ(s.erase(key), std_set.erase(key));
+        } else {
+            auto it = s.find(key);
+            auto std_it = std_set.find(key);
+            ASSERT_EQ(it == s.end(), std_it == std_set.end());
+            if (it != s.end()) {
+                s.erase(it);
+                std_set.erase(std_it);
+            }
+        }
+        ASSERT_EQ(s.count(key), std_set.count(key));
+    }
+    EXPECT_EQ(s.size(), std_set.size());
+    EXPECT_TRUE(
+        std::equal(s.begin(), s.end(), std_set.begin(), std_set.end()));
+    EXPECT_LE(s.shape().height_, 2 * s.shape().black_height_);
+
+    my_stl::MultiSet<int> copy(s);
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), copy.begin(), copy.end()));
+    EXPECT_EQ(copy.shape().height_, s.shape().height_);
+}
+
+TEST(TestMultiSet, EqualKeysKeepInsertionOrder) {
+    my_stl::MultiSet<std::pair<int, int>, ByFirst> s;
+    for (int i = 0; i < 100; ++i) s.insert({i % 5, i});
+
+    auto range = s.equal_range({3, 0});
+    ASSERT_EQ(std::ranges::distance(range), 20);
+    EXPECT_EQ(s.count({3, -1}), 20);
+    int expected = 3;
+    for (const auto& p : range) {
+        EXPECT_EQ(p.first, 3);
+        EXPECT_EQ(p.second, expected);
+        expected += 5;
+    }
+    EXPECT_EQ(s.find({2, 0})->second, 2);
+    EXPECT_TRUE(s.equal_range({7, 0}).empty());
+
+    EXPECT_EQ(s.erase({3, 0}), 20);
+    EXPECT_EQ(s.size(), 80);
+    EXPECT_FALSE(s.contains({3, 0}));
+}
+
+TEST(TestMultiSet, HintedInsert) {
+    my_stl::MultiSet<int> s;
+    for (int i = 0; i < 1000; ++i) s.insert(s.end(), i / 3);
+    EXPECT_EQ(s.size(), 1000);
+    EXPECT_TRUE(std::is_sorted(s.begin(), s.end()));
+
+    // Right hints: before the first key not less than the new one.
+    auto it = s.insert(s.lower_bound(10), 10);
+    EXPECT_EQ(it, s.lower_bound(10));
+    EXPECT_EQ(s.count(10), 4);
+    // Wrong hints still insert in order.
+    s.insert(s.begin(), 500);
+    s.insert(s.end(), -1);
+    s.insert(s.find(200), 5);
+    EXPECT_TRUE(std::is_sorted(s.begin(), s.end()));
+    EXPECT_EQ(s.size(), 1004);
+    EXPECT_EQ(*s.begin(), -1);
+    EXPECT_EQ(s.count(5), 4);
+
+    std::vector<int> data{5, 1, 4, 1, 5, 9, 2, 6, 5, 3};
+    my_stl::MultiSet<int, std::greater<int>> desc(data.begin(), data.end());
+    std::vector<int> sorted(data);
+    std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+    EXPECT_TRUE(
+        std::equal(desc.begin(), desc.end(), sorted.begin(), sorted.end()));
+    EXPECT_EQ(desc.count(5), 3);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <vector>
+
+#include "my_set.h"
+#include "packed_set.h"
+#include "set_expect.h"
+
+using set_expect::ExpectSame;
+using set_expect::ExpectSameBounds;
+
+namespace {
+std::uint64_t Next(std::uint64_t& state) {
+    state = state * 6364136223846793005u + 1442695040888963407u;
+    return state ^ state >> 29;
+}
+}  // namespace
+
+TEST(TestPackedSet, MatchesStdSet) {
+    my_stl::PackedSet<std::uint64_t> set;
+    std::set<std::uint64_t> expected;
+    const std::uint64_t kMax = std::numeric_limits<std::uint64_t>::max();
+    // Keys over the whole range, which need wide gaps, next to a dense
+    // cluster whose blocks pack to a few bits a key, and the extremes.
+    std::uint64_t state = 5;
+    for (int i = 0; i < 40000; ++i) {
+        std::uint64_t r = Next(state);
+        std::uint64_t key = i % 3 == 0 ? 1000000 + r % 20000
+                            : i % 50 == 1 ? (r % 2 ? kMax - r % 4 : r % 4)
+                                          : r;
+        if (i > 25000 && r % 3 == 0) {
+            ASSERT_EQ(set.erase(key), expected.erase(key)) << key;
+        } else {
+            auto p = set.insert(key);
+            ASSERT_EQ(p.second, expected.insert(key).second) << key;
+            ASSERT_EQ(*p.first, key);
+        }
+    }
+    ExpectSame(set, expected);
+    for (std::uint64_t key : {std::uint64_t{0}, std::uint64_t{1},
+                              std::uint64_t{999999}, std::uint64_t{1010000},
+                              kMax - 1, kMax}) {
+        ExpectSameBounds(set, expected, key);
+    }
+    for (int i = 0; i < 3000; ++i) {
+        std::uint64_t key = i % 2 ? Next(state) : 1000000 + Next(state) % 20000;
+        ExpectSameBounds(set, expected, key);
+    }
+
+    // Erasing most keys merges blocks.
+    std::vector<std::uint64_t> keys(expected.begin(), expected.end());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (i % 8 != 0) {
+            ASSERT_EQ(set.erase(keys[i]), 1);
+            expected.erase(keys[i]);
+        }
+    }
+    ExpectSame(set, expected);
+    set.erase(set.begin());
+    expected.erase(expected.begin());
+    ExpectSame(set, expected);
+
+    my_stl::PackedSet<std::uint64_t> copy(set);
+    ExpectSame(copy, expected);
+    set.clear();
+    EXPECT_TRUE(set.empty());
+    EXPECT_EQ(set.begin(), set.end());
+    EXPECT_EQ(set.lower_bound(0), set.end());
+    EXPECT_EQ(set.erase(0), 0);
+}
+
+TEST(TestPackedSet, NarrowKeys) {
+    std::vector<std::uint32_t> keys;
+    std::uint64_t state = 9;
+    for (int i = 0; i < 5000; ++i) {
+        keys.push_back(static_cast<std::uint32_t>(Next(state)));
+    }
+    keys.push_back(0);
+    keys.push_back(std::numeric_limits<std::uint32_t>::max());
+    my_stl::PackedSet<std::uint32_t> set(keys.begin(), keys.end());
+    std::set<std::uint32_t> expected(keys.begin(), keys.end());
+    ExpectSame(set, expected);
+    for (std::uint32_t key : keys) {
+        ExpectSameBounds(set, expected, key);
+        ExpectSameBounds(set, expected, key + 1);
+    }
+
+    my_stl::PackedSet<std::uint8_t> bytes{200, 3, 255, 0, 3};
+    EXPECT_EQ(bytes.size(), 4);
+    EXPECT_EQ(*--bytes.end(), 255);
+    EXPECT_EQ(bytes.upper_bound(255), bytes.end());
+}
+
+TEST(TestPackedSet, Memory) {
+    // Ids spread over the 64-bit space: the tree's links dominate.
+    std::vector<std::uint64_t> keys;
+    std::uint64_t state = 1;
+    for (int i = 0; i < 200000; ++i) keys.push_back(Next(state));
+    my_stl::Set<std::uint64_t> set(keys.begin(), keys.end());
+    my_stl::PackedSet<std::uint64_t> built(keys.begin(), keys.end());
+    my_stl::PackedSet<std::uint64_t> inserted;
+    for (std::uint64_t key : keys) inserted.insert(key);
+
+    std::size_t set_bytes = my_stl::memory::Total(set.memory_usage());
+    EXPECT_LT(5 * my_stl::memory::Total(built.memory_usage()), set_bytes);
+    EXPECT_LT(4 * my_stl::memory::Total(inserted.memory_usage()), set_bytes);
+}
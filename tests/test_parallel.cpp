@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "my_set.h"
+#include "set_parallel.h"
+
+namespace {
+// Whether the keys came in ascending order, with the first and last; not
+// commutative, so it checks that runs are combined in key order.
+struct Ascending {
+    struct value_type {
+        bool empty = true;
+        bool ascending = true;
+        int first = 0;
+        int last = 0;
+        long count = 0;
+    };
+    static value_type Identity() { return value_type(); }
+    static value_type Of(int key) { return {false, true, key, key, 1}; }
+    static value_type Combine(const value_type& a, const value_type& b) {
+        if (a.empty) return b;
+        if (b.empty) return a;
+        return {false, a.ascending && b.ascending && a.last < b.first,
+                a.first, b.last, a.count + b.count};
+    }
+};
+}  // namespace
+
+TEST(TestParallel, VisitsEveryKeyOnce) {
+    my_stl::Set<int> set;
+    unsigned state = 7;
+    for (int i = 0; i < 100000; ++i) {
+        state = state * 1103515245u + 12345u;
+        set.insert(static_cast<int>(state >> 4));
+    }
+    long long expected = 0;
+    std::size_t odd = 0;
+    for (int key : set) {
+        expected += key;
+        odd += key % 2 != 0;
+    }
+
+    for (unsigned threads : {1u, 3u, 8u}) {
+        my_stl::parallel::Options options;
+        options.threads = threads;
+        std::atomic<long long> sum{0};
+        std::atomic<std::size_t> visits{0};
+        my_stl::parallel_for_each(
+            set,
+            [&](int key) {
+                sum += key;
+                ++visits;
+            },
+            options);
+        EXPECT_EQ(visits, set.size());
+        EXPECT_EQ(sum, expected);
+
+        Ascending::value_type all =
+            my_stl::parallel_reduce<Ascending>(set, options);
+        EXPECT_TRUE(all.ascending);
+        EXPECT_EQ(all.count, static_cast<long>(set.size()));
+        EXPECT_EQ(all.first, *set.begin());
+
+        EXPECT_EQ(my_stl::parallel_count_if(
+                      set, [](int key) { return key % 2 != 0; }, options),
+                  odd);
+    }
+
+    std::vector<my_stl::Set<int>::const_iterator> points =
+        set.split_points(64);
+    EXPECT_GE(points.size(), 33);
+    EXPECT_EQ(points.front(), set.begin());
+    EXPECT_EQ(points.back(), set.end());
+}
+
+TEST(TestParallel, SmallSetsAndErrors) {
+    my_stl::Set<int> empty;
+    EXPECT_TRUE(my_stl::parallel_reduce<Ascending>(empty).empty);
+    EXPECT_EQ(my_stl::parallel_count_if(empty, [](int) { return true; }), 0);
+
+    // Inline keys make a single run.
+    my_stl::Set<int, my_rbt::stats::NullStats, my_rbt::augment::None, 8>
+        small{5, 3, 9};
+    EXPECT_EQ(small.split_points(16).size(), 2);
+    EXPECT_EQ(my_stl::parallel_reduce<Ascending>(small).count, 3);
+
+    my_stl::Set<int> set;
+    for (int i = 0; i < 5000; ++i) set.insert(i);
+    my_stl::parallel::Options options;
+    options.threads = 4;
+    EXPECT_THROW(my_stl::parallel_for_each(
+                     set,
+                     [](int key) {
+                         if (key == 4321) throw std::runtime_error("stop");
+                     },
+                     options),
+                 std::runtime_error);
+}
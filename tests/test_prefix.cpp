@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "my_map.h"
+#include "my_set.h"
+#include "set_expect.h"
+
+namespace {
+// Keys that share long prefixes, differ in their first bytes or not at
+// all, run out before 8 bytes, or hold NULs and bytes above 0x7f, which
+// compare unsigned.
+std::vector<std::string> Keys() {
+    std::vector<std::string> keys;
+    unsigned state = 11;
+    for (int i = 0; i < 3000; ++i) {
+        state = state * 1103515245u + 12345u;
+        std::string tail = std::to_string(state % 100000);
+        keys.push_back("https://www.example.com/item/" + tail);
+        keys.push_back("https://www.example.com/item/" + tail + '\0');
+        if (i % 10 == 0) keys.push_back(tail.substr(0, i % 4));
+    }
+    keys.push_back("https://www.example.com/");
+    keys.push_back("https://www.example.com/item");
+    keys.push_back(std::string(3, '\0'));
+    keys.push_back("\xff\xfe");
+    keys.push_back("z");
+    return keys;
+}
+
+template <class Set>
+void ExpectSameBounds(const Set& set, const std::set<std::string>& expected,
+                      const std::vector<std::string>& probes) {
+    for (const std::string& key : probes) {
+        set_expect::ExpectSameBounds(set, expected, key);
+    }
+}
+}  // namespace
+
+TEST(TestPrefix, MatchesStdSet) {
+    std::vector<std::string> keys = Keys();
+    std::vector<std::string> probes = keys;
+    probes.push_back("");
+    probes.push_back("https://www.example.com/item/");
+    probes.push_back("https://www.example.com/itex");
+    probes.push_back("https://www.example.co");
+    probes.push_back("\xff");
+
+    my_stl::Set<std::string> set;
+    std::set<std::string> expected;
+    // The long shared prefix first, so the keys after it shorten it at a
+    // size where every node is restamped.
+    for (const std::string& key : keys) {
+        if (key.rfind("https://", 0) != 0) continue;
+        ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+    }
+    ExpectSameBounds(set, expected, probes);
+    for (const std::string& key : keys) {
+        ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+    }
+    ExpectSameBounds(set, expected, probes);
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), expected.begin(),
+                           expected.end()));
+
+    // Copies keep the cached prefixes; bulk builds compute them.
+    my_stl::Set<std::string> copy(set);
+    ExpectSameBounds(copy, expected, probes);
+    std::stringstream snapshot;
+    set.save(snapshot);
+    my_stl::Set<std::string> loaded;
+    loaded.load(snapshot);
+    ExpectSameBounds(loaded, expected, probes);
+
+    for (std::size_t i = 0; i < keys.size(); i += 3) {
+        ASSERT_EQ(set.erase(keys[i]), expected.erase(keys[i]));
+    }
+    ExpectSameBounds(set, expected, probes);
+    set.clear();
+    set.insert("b");
+    EXPECT_TRUE(set.contains("b"));
+    EXPECT_FALSE(set.contains("bb"));
+    EXPECT_EQ(*set.lower_bound("a"), "b");
+}
+
+TEST(TestPrefix, MapKeys) {
+    my_stl::Map<std::string, int> map;
+    for (int i = 0; i < 500; ++i) {
+        map["user:00000" + std::to_string(i)] = i;
+    }
+    for (int i = 0; i < 500; ++i) {
+        EXPECT_EQ(map.at("user:00000" + std::to_string(i)), i);
+    }
+    EXPECT_EQ(map.find("user:00000500"), map.end());
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "recording_set.h"
+#include "set_workload.h"
+
+TEST(TestRecordingSet, RoundTrip) {
+    using my_stl::trace::Op;
+    std::stringstream file;
+    {
+        my_stl::RecordingSet<std::string> s(file);
+        for (int i = 0; i < 5000; ++i) s.insert(std::to_string(i % 700));
+        EXPECT_NE(s.find("42"), s.end());
+        EXPECT_NE(s.lower_bound("5"), s.end());
+        EXPECT_EQ(s.erase("42"), 1);
+        EXPECT_EQ(s.copy().size(), 699);
+        s.clear();
+        EXPECT_TRUE(s.empty());
+    }
+
+    my_stl::io::WorkloadReader<std::string> reader(file);
+    std::vector<my_stl::io::WorkloadRecord<std::string>> records;
+    for (my_stl::io::WorkloadRecord<std::string> r{}; reader.Next(r);) {
+        records.push_back(r);
+    }
+    ASSERT_EQ(records.size(), 5005);
+    EXPECT_EQ(records[0].op_, Op::kInsert);
+    EXPECT_EQ(records[701].key_, "1");
+    EXPECT_EQ(records[5000].op_, Op::kFind);
+    EXPECT_EQ(records[5001].op_, Op::kLowerBound);
+    EXPECT_EQ(records[5001].key_, "5");
+    EXPECT_EQ(records[5002].op_, Op::kErase);
+    EXPECT_EQ(records[5003].op_, Op::kCopy);
+    EXPECT_EQ(records[5004].op_, Op::kClear);
+    for (std::size_t i = 1; i < records.size(); ++i) {
+        EXPECT_LE(records[i - 1].time_ns_, records[i].time_ns_);
+    }
+
+    file.clear();
+    file.seekg(0);
+    EXPECT_THROW(my_stl::io::WorkloadReader<int> wrong(file),
+                 std::runtime_error);
+
+    std::string damaged = file.str();
+    damaged[damaged.size() / 2] ^= 0x40;
+    std::stringstream bad(damaged);
+    my_stl::io::WorkloadReader<std::string> bad_reader(bad);
+    EXPECT_THROW(
+        {
+            for (my_stl::io::WorkloadRecord<std::string> r{};
+                 bad_reader.Next(r);) {
+            }
+        },
+        std::runtime_error);
+
+    // A damaged record count fails as a format error, not std::bad_alloc.
+    std::string counted = file.str();
+    std::uint32_t count = 0xffffffffu;
+    std::memcpy(counted.data() + sizeof(my_stl::io::WorkloadHeader) +
+                    offsetof(my_stl::io::WorkloadBlock, count_),
+                &count, sizeof(count));
+    std::stringstream overcounted(counted);
+    my_stl::io::WorkloadReader<std::string> count_reader(overcounted);
+    my_stl::io::WorkloadRecord<std::string> record{};
+    EXPECT_THROW(count_reader.Next(record), std::runtime_error);
+}
+
+TEST(TestRecordingSet, TruncatedCapture) {
+    // A capture cut short, say by a crash, replays every whole block.
+    std::stringstream file;
+    {
+        my_stl::RecordingSet<int> s(file);
+        for (int i = 0; i < 3 * 4096 + 100; ++i) s.insert(i);
+    }
+    std::string full = file.str();
+    std::size_t last = sizeof(my_stl::io::WorkloadHeader);
+    std::size_t whole = 0;
+    for (;;) {
+        my_stl::io::WorkloadBlock block{};
+        std::memcpy(&block, full.data() + last, sizeof(block));
+        std::size_t end = last + sizeof(block) + block.payload_size_;
+        ASSERT_LE(end, full.size());
+        if (end == full.size()) break;
+        whole += block.count_;
+        last = end;
+    }
+    ASSERT_EQ(whole, 3 * 4096);
+
+    auto read = [](const std::string& bytes, bool& truncated) {
+        std::stringstream is(bytes);
+        my_stl::io::WorkloadReader<int> reader(is);
+        std::size_t n = 0;
+        for (my_stl::io::WorkloadRecord<int> r{}; reader.Next(r); ++n) {
+            EXPECT_EQ(r.key_, static_cast<int>(n));
+        }
+        truncated = reader.Truncated();
+        return n;
+    };
+    bool truncated = true;
+    EXPECT_EQ(read(full, truncated), 3 * 4096 + 100);
+    EXPECT_FALSE(truncated);
+    for (std::size_t cut : {last + 1, last + sizeof(my_stl::io::WorkloadBlock),
+                            last + sizeof(my_stl::io::WorkloadBlock) + 7,
+                            full.size() - 1}) {
+        EXPECT_EQ(read(full.substr(0, cut), truncated), whole) << cut;
+        EXPECT_TRUE(truncated) << cut;
+    }
+    EXPECT_EQ(read(full.substr(0, last), truncated), whole);
+    EXPECT_FALSE(truncated);
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <set>
+
+#include "my_set.h"
+#include "roaring_set.h"
+#include "set_expect.h"
+
+using set_expect::ExpectSame;
+using set_expect::ExpectSameBounds;
+
+TEST(TestRoaringSet, MatchesStdSet) {
+    my_stl::RoaringSet<std::uint32_t> set;
+    std::set<std::uint32_t> expected;
+    // Chunk 0 is sparse (array), chunk 1 dense (bitmap), chunk 2 grows
+    // past kArrayMax and shrinks back, and the last chunk holds the
+    // largest keys.
+    std::uint32_t state = 7;
+    auto next = [&state] { return state = state * 1103515245u + 12345u; };
+    for (int i = 0; i < 60000; ++i) {
+        std::uint32_t r = next() >> 8;
+        std::uint32_t key;
+        switch (i % 4) {
+            case 0:
+                key = r % 65536 * 17 % 65536;
+                break;
+            case 1:
+                key = 65536 + r % 65536;
+                break;
+            case 2:
+                key = 2 * 65536 + r % 12000;
+                break;
+            default:
+                key = 0xffffffffu - r % 300;
+                break;
+        }
+        if (i > 40000 && r % 3 != 0) {
+            ASSERT_EQ(set.erase(key), expected.erase(key)) << key;
+        } else {
+            ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+        }
+    }
+    ExpectSame(set, expected);
+    for (std::uint32_t key :
+         {0u, 1u, 65535u, 65536u, 2 * 65536u - 1, 2 * 65536u + 11999,
+          5 * 65536u, 0xfffffe00u, 0xffffffffu}) {
+        ExpectSameBounds(set, expected, key);
+    }
+    for (int i = 0; i < 2000; ++i) {
+        ExpectSameBounds(set, expected, next() % (3 * 65536));
+    }
+
+    // Runs behave the same, and updates that break them up convert back.
+    set.optimize();
+    ExpectSame(set, expected);
+    for (int i = 0; i < 2000; ++i) {
+        ExpectSameBounds(set, expected, next() % (3 * 65536));
+    }
+    for (int i = 0; i < 20000; ++i) {
+        std::uint32_t key = next() % (3 * 65536);
+        if (i % 2) {
+            ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+        } else {
+            ASSERT_EQ(set.erase(key), expected.erase(key));
+        }
+    }
+    ExpectSame(set, expected);
+
+    auto it = set.find(*expected.begin());
+    EXPECT_EQ(it, set.begin());
+    set.erase(it);
+    expected.erase(expected.begin());
+    EXPECT_EQ(set.find(5 * 65536u), set.end());
+    ExpectSame(set, expected);
+}
+
+TEST(TestRoaringSet, Runs) {
+    my_stl::RoaringSet<std::uint32_t> set;
+    std::set<std::uint32_t> expected;
+    for (std::uint32_t key = 1000; key < 200000; ++key) {
+        if (key % 10000 == 0) continue;
+        set.insert(key);
+        expected.insert(key);
+    }
+    std::size_t before = my_stl::memory::Total(set.memory_usage());
+    set.optimize();
+    EXPECT_LT(my_stl::memory::Total(set.memory_usage()), before / 50);
+    ExpectSame(set, expected);
+
+    // Splitting, joining and trimming runs.
+    for (std::uint32_t key : {1000u, 1500u, 1501u, 9999u, 10000u, 10001u,
+                              65535u, 65536u, 199999u}) {
+        if (expected.count(key)) {
+            set.erase(key);
+            expected.erase(key);
+        } else {
+            set.insert(key);
+            expected.insert(key);
+        }
+        ExpectSameBounds(set, expected, key - 1);
+        ExpectSameBounds(set, expected, key);
+        ExpectSameBounds(set, expected, key + 1);
+    }
+    ExpectSame(set, expected);
+}
+
+TEST(TestRoaringSet, SetAlgebra) {
+    std::uint32_t state = 3;
+    auto next = [&state] { return state = state * 1103515245u + 12345u; };
+    std::set<std::uint32_t> a_keys;
+    std::set<std::uint32_t> b_keys;
+    for (int i = 0; i < 50000; ++i) {
+        // Both dense in chunk 0, sparse elsewhere, a alone in chunk 4.
+        a_keys.insert(next() % 65536);
+        b_keys.insert(next() % 65536);
+        if (i % 20 == 0) {
+            a_keys.insert(next() % (4 * 65536));
+            b_keys.insert(next() % (4 * 65536));
+            a_keys.insert(4 * 65536 + next() % 1000);
+        }
+    }
+    for (std::uint32_t key = 3 * 65536; key < 3 * 65536 + 30000; ++key) {
+        b_keys.insert(key);
+    }
+    my_stl::RoaringSet<std::uint32_t> a(a_keys.begin(), a_keys.end());
+    my_stl::RoaringSet<std::uint32_t> b(b_keys.begin(), b_keys.end());
+    b.optimize();
+
+    std::set<std::uint32_t> expected;
+    std::set_union(a_keys.begin(), a_keys.end(), b_keys.begin(),
+                   b_keys.end(), std::inserter(expected, expected.end()));
+    ExpectSame(a | b, expected);
+    ExpectSame(b | a, expected);
+
+    expected.clear();
+    std::set_intersection(a_keys.begin(), a_keys.end(), b_keys.begin(),
+                          b_keys.end(),
+                          std::inserter(expected, expected.end()));
+    ExpectSame(a & b, expected);
+    ExpectSame(b & a, expected);
+
+    my_stl::RoaringSet<std::uint32_t> empty;
+    EXPECT_TRUE((a & empty).empty());
+    ExpectSame(a | empty, a_keys);
+    a &= a;
+    ExpectSame(a, a_keys);
+}
+
+TEST(TestRoaringSet, Memory) {
+    // A dense range: one bit per key against a node per key.
+    my_stl::RoaringSet<std::uint32_t> roaring;
+    my_stl::Set<std::uint32_t> set;
+    for (std::uint32_t key = 0; key < 1000000; key += 2) {
+        roaring.insert(key);
+        set.insert(key);
+    }
+    std::size_t roaring_bytes = my_stl::memory::Total(roaring.memory_usage());
+    std::size_t set_bytes = my_stl::memory::Total(set.memory_usage());
+    EXPECT_LT(roaring_bytes * 100, set_bytes);
+
+    my_stl::RoaringSet<std::uint16_t> small{3, 1, 2};
+    EXPECT_EQ(*small.begin(), 1);
+    EXPECT_EQ(*--small.end(), 3);
+    small.clear();
+    EXPECT_TRUE(small.empty());
+    EXPECT_EQ(small.begin(), small.end());
+}
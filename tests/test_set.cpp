@@ -1,7 +1,15 @@
 #include <gtest/gtest.h>
 #include <math.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <numeric>
 #include <set>
+#include <sstream>
+#include <string>
 
 #include "chrono"
 #include "my_set.h"
@@ -11,6 +19,27 @@ typedef std::chrono::high_resolution_clock Time;
 typedef std::chrono::milliseconds ms;
 typedef std::chrono::duration<float> fsec;
 
+namespace {
+// Total bytes of the keys.
+struct Bytes {
+    typedef size_t value_type;
+    static size_t Identity() { return 0; }
+    static size_t Of(const std::string& key) { return key.size(); }
+    static size_t Combine(size_t a, size_t b) { return a + b; }
+};
+
+// First characters in key order; not commutative, so it checks the order
+// in which subtrees are combined.
+struct Initials {
+    typedef std::string value_type;
+    static std::string Identity() { return std::string(); }
+    static std::string Of(const std::string& key) { return key.substr(0, 1); }
+    static std::string Combine(const std::string& a, const std::string& b) {
+        return a + b;
+    }
+};
+}  // namespace
+
 TEST(TestConstructorsSet, Default) {
     my_stl::Set<int> s;
     EXPECT_EQ(s.size(), 0);
@@ -354,3 +383,605 @@ TEST(TestMethodsSet, LowerBound) {
     fs = t1 - t0;
     std::cout << "std set lowerbound time:" << fs.count() << "s\n";
 }
+
+TEST(TestIteratorsSet, EndDecrement) {
+    my_stl::Set<int> s = {5, 1, 3};
+    auto it = s.end();
+    EXPECT_EQ(*--it, 5);
+    EXPECT_EQ(*--it, 3);
+    EXPECT_EQ(*--it, 1);
+    EXPECT_EQ(it, s.begin());
+}
+
+TEST(TestRangesSet, Range) {
+    static_assert(
+        std::ranges::bidirectional_range<my_stl::Set<int>::range_type>);
+    static_assert(std::ranges::view<my_stl::Set<int>::range_type>);
+
+    my_stl::Set<int> s;
+    std::set<int> std_set;
+    for (int i = 0; i < 10000; i += 3) {
+        s.insert(i);
+        std_set.insert(i);
+    }
+    for (int lo = -10; lo < 10010; lo += 97) {
+        for (int hi : {lo - 5, lo, lo + 1, lo + 50, lo + 5000}) {
+            auto r = s.range(lo, hi);
+            std::vector<int> got(r.begin(), r.end());
+            std::vector<int> want;
+            if (lo < hi) {
+                want.assign(std_set.lower_bound(lo), std_set.lower_bound(hi));
+            }
+            EXPECT_EQ(got, want);
+            EXPECT_EQ(s.count_range(lo, hi), want.size());
+
+            std::vector<int> back;
+            for (auto it = r.end(); it != r.begin();) {
+                back.push_back(*--it);
+            }
+            EXPECT_TRUE(std::equal(back.rbegin(), back.rend(), want.begin(),
+                                   want.end()));
+        }
+    }
+}
+
+TEST(TestRangesSet, CopyRange) {
+    std::vector<int> vec;
+    for (int i = 20000; i > 0; i -= 2) {
+        vec.push_back(i);
+    }
+    my_stl::Set<int> s(vec.begin(), vec.end());
+    std::set<int> std_set(vec.begin(), vec.end());
+
+    std::vector<int> out;
+    out.reserve(s.count_range(101, 15001));
+    s.copy_range(101, 15001, std::back_inserter(out));
+    std::vector<int> want(std_set.lower_bound(101), std_set.lower_bound(15001));
+    EXPECT_EQ(out, want);
+    EXPECT_EQ(out.capacity(), want.size());
+
+    long long sum = 0;
+    s.for_each_range(0, 100000, [&sum](int k) { sum += k; });
+    EXPECT_EQ(sum, std::accumulate(vec.begin(), vec.end(), 0LL));
+}
+
+TEST(TestSerializationSet, RoundTrip) {
+    my_stl::Set<int> s;
+    for (int i = 0; i < 100000; i += 7) {
+        s.insert(i * (i % 2 ? -1 : 1));
+    }
+    my_stl::Set<std::string> strings{"", "abacaba", "hello", "p"};
+    my_stl::Set<std::pair<int, int>> pairs{{-3, 5}, {5, 5}, {-4, 1}, {0, 1}};
+
+    std::stringstream stream;
+    s.save(stream);
+    strings.save(stream);
+    pairs.save(stream);
+    my_stl::Set<int>().save(stream);
+
+    my_stl::Set<int> s2{1, 2, 3};
+    my_stl::Set<std::string> strings2;
+    my_stl::Set<std::pair<int, int>> pairs2;
+    my_stl::Set<int> empty{42};
+    s2.load(stream);
+    strings2.load(stream);
+    pairs2.load(stream);
+    empty.load(stream);
+
+    EXPECT_EQ(s2.size(), s.size());
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), s2.begin(), s2.end()));
+    EXPECT_TRUE(std::equal(strings.begin(), strings.end(), strings2.begin(),
+                           strings2.end()));
+    EXPECT_TRUE(
+        std::equal(pairs.begin(), pairs.end(), pairs2.begin(), pairs2.end()));
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(*--s2.end(), *--s.end());
+    s2.insert(-1);
+    s2.erase(0);
+    EXPECT_EQ(s2.size(), s.size());
+}
+
+TEST(TestSerializationSet, RejectsBadInput) {
+    my_stl::Set<int> s{1, 2, 3, 4, 5};
+    std::stringstream stream;
+    s.save(stream);
+    std::string bytes = stream.str();
+
+    my_stl::Set<long long> wrong_type;
+    std::stringstream typed(bytes);
+    EXPECT_THROW(wrong_type.load(typed), std::runtime_error);
+
+    std::string corrupt = bytes;
+    corrupt.back() ^= 1;
+    std::stringstream corrupted(corrupt);
+    my_stl::Set<int> target{7};
+    EXPECT_THROW(target.load(corrupted), std::runtime_error);
+    EXPECT_TRUE(target.empty());
+
+    std::stringstream truncated(bytes.substr(0, bytes.size() - 2));
+    EXPECT_THROW(target.load(truncated), std::runtime_error);
+
+    // Key counts that overflow when multiplied by the key size, or that
+    // no payload could hold.
+    auto with_count = [](std::string snapshot, std::uint64_t count) {
+        std::memcpy(snapshot.data() + offsetof(my_stl::io::FileHeader, count_),
+                    &count, sizeof(count));
+        return snapshot;
+    };
+    std::stringstream one;
+    my_stl::Set<int>{1}.save(one);
+    std::stringstream wrapped(with_count(one.str(), (1ull << 62) + 1));
+    EXPECT_THROW(target.load(wrapped), std::runtime_error);
+    std::stringstream no_strings;
+    my_stl::Set<std::string>().save(no_strings);
+    std::stringstream huge(with_count(no_strings.str(), 1ull << 63));
+    my_stl::Set<std::string> strings;
+    EXPECT_THROW(strings.load(huge), std::runtime_error);
+    EXPECT_TRUE(strings.empty());
+}
+
+TEST(TestTextSet, FormatAndParse) {
+    my_stl::Set<int> s{3, -1, 2};
+    std::stringstream default_out;
+    default_out << s;
+    EXPECT_EQ(default_out.str(), "-1, 2, 3, \n");
+
+    my_stl::io::TextFormat csv;
+    csv.delimiter_ = ",";
+    csv.trailing_delimiter_ = false;
+    csv.newline_ = false;
+    std::stringstream csv_out;
+    s.write_text(csv_out, csv);
+    EXPECT_EQ(csv_out.str(), "-1,2,3");
+
+    my_stl::Set<int> parsed;
+    parsed.read_text(csv_out, csv);
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), parsed.begin(), parsed.end()));
+    my_stl::Set<int> from_default;
+    from_default.read_text(default_out);
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), from_default.begin(),
+                           from_default.end()));
+
+    std::stringstream unsorted("5;+1;5; 3 ;-7");
+    my_stl::io::TextFormat semicolons;
+    semicolons.delimiter_ = ";";
+    parsed.read_text(unsorted, semicolons);
+    std::vector<int> want{-7, 1, 3, 5};
+    EXPECT_TRUE(
+        std::equal(parsed.begin(), parsed.end(), want.begin(), want.end()));
+
+    std::stringstream bad("1, x, 3");
+    EXPECT_THROW(parsed.read_text(bad), std::runtime_error);
+    EXPECT_TRUE(parsed.empty());
+}
+
+TEST(TestTextSet, LargeRoundTrip) {
+    my_stl::Set<long long> s;
+    for (long long i = 0; i < 3000; ++i) {
+        s.insert(i * 1000003 % 999983 - 500000);
+    }
+    my_stl::Set<double> doubles{0.1, -2.5, 1e300, 3.0};
+    my_stl::Set<std::string> strings{"b", "", "a c", "z"};
+
+    my_stl::io::TextFormat lines;
+    lines.delimiter_ = "\n";
+    lines.newline_ = false;
+    std::stringstream out;
+    std::stringstream doubles_out;
+    std::stringstream strings_out;
+    s.write_text(out, lines);
+    doubles.write_text(doubles_out);
+    strings.write_text(strings_out, lines);
+
+    my_stl::Set<long long> parsed;
+    my_stl::Set<double> parsed_doubles;
+    my_stl::Set<std::string> parsed_strings;
+    parsed.read_text(out, lines);
+    parsed_doubles.read_text(doubles_out);
+    parsed_strings.read_text(strings_out, lines);
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), parsed.begin(), parsed.end()));
+    EXPECT_TRUE(std::equal(doubles.begin(), doubles.end(),
+                           parsed_doubles.begin(), parsed_doubles.end()));
+    EXPECT_TRUE(std::equal(strings.begin(), strings.end(),
+                           parsed_strings.begin(), parsed_strings.end()));
+}
+
+namespace {
+// Ordered by operator< alone, with no operator==.
+struct LessOnly {
+    int value_;
+
+    bool operator<(const LessOnly& other) const {
+        return value_ < other.value_;
+    }
+};
+}  // namespace
+
+TEST(TestMethodsSet, LessOnlyKeys) {
+    my_stl::Set<LessOnly> s;
+    for (int i = 0; i < 50; ++i) s.insert(LessOnly{i % 25});
+    EXPECT_EQ(s.size(), 25);
+    EXPECT_FALSE(s.insert(LessOnly{3}).second);
+    EXPECT_EQ(s.erase(LessOnly{3}), 1);
+    EXPECT_EQ(s.erase(LessOnly{3}), 0);
+    EXPECT_EQ(s.size(), 24);
+    EXPECT_EQ(s.find(LessOnly{3}), s.end());
+}
+
+TEST(TestMethodsSet, EraseKeepsOtherIterators) {
+    my_stl::Set<int> s;
+    std::vector<my_stl::Set<int>::iterator> kept;
+    for (int i = 0; i < 200; ++i) {
+        auto it = s.insert(i).first;
+        if (i % 2 == 0) kept.push_back(it);
+    }
+    // Erasing a node with two children must not move its successor's key
+    // into it, which would leave iterators to the successor dangling.
+    for (int i = 1; i < 200; i += 2) EXPECT_EQ(s.erase(i), 1);
+    for (int i = 0; i < 100; ++i) EXPECT_EQ(*kept[i], 2 * i);
+    EXPECT_EQ(std::distance(s.begin(), s.end()), 100);
+}
+
+TEST(TestMethodsSet, TreeEraseOverloads) {
+    my_rbt::RBTree<int> tree{5, 1, 4, 2, 3};
+    EXPECT_EQ(*tree.Erase(tree.IterateTo(2)), 3);
+    EXPECT_EQ(tree.Erase(4), 1);
+    EXPECT_EQ(tree.Erase(4), 0);
+    EXPECT_EQ(tree.Erase(tree.begin(), tree.IterateTo(5)), tree.IterateTo(5));
+    EXPECT_EQ(tree.GetSize(), 1);
+    tree.Clear();
+    EXPECT_TRUE(tree.IsEmpty());
+}
+
+TEST(TestMethodsSet, RandomInsertErase) {
+    my_stl::Set<int> s;
+    std::set<int> std_set;
+    unsigned state = 12345;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1103515245u + 12345u;
+        int key = static_cast<int>((state >> 8) % 2000);
+        if ((state >> 16) & 1) {
+            EXPECT_EQ(s.insert(key).second, std_set.insert(key).second);
+        } else {
+            EXPECT_EQ(s.erase(key), std_set.erase(key));
+        }
+    }
+    EXPECT_EQ(s.size(), std_set.size());
+    EXPECT_TRUE(
+        std::equal(s.begin(), s.end(), std_set.begin(), std_set.end()));
+
+    auto it = s.begin();
+    while (it != s.end()) {
+        auto next = it;
+        ++next;
+        s.erase(it);
+        it = next;
+    }
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(TestStatsSet, CountsAndShape) {
+    static_assert(sizeof(my_stl::Set<int>) == sizeof(size_t) + sizeof(void*),
+                  "NullStats must not add to the tree");
+
+    my_stl::Set<int> plain{3, 1, 2};
+    EXPECT_EQ(plain.stats().comparisons_, 0);
+
+    my_stl::Set<int, my_rbt::stats::CountingStats> s;
+    for (int i = 0; i < 1023; ++i) s.insert(i);
+    my_rbt::stats::Counters c = s.stats();
+    EXPECT_EQ(c.allocations_, 1023);
+    EXPECT_EQ(c.frees_, 0);
+    EXPECT_GT(c.comparisons_, 0);
+    EXPECT_GT(c.rotations_left_, 0);
+    EXPECT_EQ(c.rotations_right_, 0);
+    EXPECT_GT(c.fix_insert_steps_, 0);
+    EXPECT_GE(c.searches_, 1023);
+
+    my_rbt::stats::Shape shape = s.shape();
+    EXPECT_EQ(shape.node_count_, 1023);
+    EXPECT_LE(shape.height_, 2 * shape.black_height_);
+    EXPECT_LE(shape.height_, 20);
+    EXPECT_LT(shape.average_depth_, shape.height_);
+
+    s.reset_stats();
+    EXPECT_NE(s.find(512), s.end());
+    c = s.stats();
+    EXPECT_EQ(c.searches_, 1);
+    EXPECT_EQ(c.comparisons_, c.search_path_total_ + 1);
+    EXPECT_LE(c.search_path_max_, shape.height_);
+
+    for (int i = 0; i < 1023; i += 2) s.erase(i);
+    c = s.stats();
+    EXPECT_EQ(c.frees_, 512);
+    EXPECT_GT(c.fix_remove_steps_, 0);
+    EXPECT_LE(s.shape().height_, 2 * s.shape().black_height_);
+
+    std::stringstream text;
+    text << s;
+    s.read_text(text);
+    shape = s.shape();
+    EXPECT_EQ(shape.node_count_, 511);
+    EXPECT_EQ(shape.height_, 9);
+    EXPECT_EQ(my_stl::Set<int>().shape().height_, 0);
+}
+
+TEST(TestReduceSet, MatchesLinearFold) {
+    my_stl::Set<std::string, my_rbt::stats::NullStats, Bytes> bytes;
+    my_stl::Set<std::string, my_rbt::stats::CountingStats, Initials> initials;
+    std::set<std::string> std_set;
+    unsigned state = 31337;
+    auto next = [&state](unsigned mod) {
+        state = state * 1103515245u + 12345u;
+        return (state >> 8) % mod;
+    };
+    for (int i = 0; i < 6000; ++i) {
+        std::string key(1 + next(12), static_cast<char>('a' + next(26)));
+        key += std::to_string(next(400));
+        if (i % 3 == 2) {
+            EXPECT_EQ(bytes.erase(key), std_set.erase(key));
+            initials.erase(key);
+        } else {
+            bytes.insert(key);
+            initials.insert(key);
+            std_set.insert(key);
+        }
+    }
+    ASSERT_EQ(bytes.size(), std_set.size());
+
+    for (int q = 0; q < 300; ++q) {
+        std::string lo(1, static_cast<char>('a' + next(26)));
+        std::string hi = lo + std::string(next(10), 'z');
+        if (q % 4 == 0) hi = std::string(1, static_cast<char>('a' + next(26)));
+        size_t total = 0;
+        std::string firsts;
+        for (auto it = std_set.lower_bound(lo);
+             it != std_set.end() && *it < hi; ++it) {
+            total += it->size();
+            firsts += it->front();
+        }
+        EXPECT_EQ(bytes.reduce(lo, hi), total);
+        initials.reset_stats();
+        EXPECT_EQ(initials.reduce(lo, hi), firsts);
+        EXPECT_LE(initials.stats().search_path_total_,
+                  3 * initials.shape().height_);
+    }
+    EXPECT_EQ(bytes.reduce("z", "a"), 0);
+
+    // Bulk load and copies rebuild the cached sums.
+    std::stringstream text;
+    text << bytes;
+    bytes.read_text(text);
+    my_stl::Set<std::string, my_rbt::stats::NullStats, Bytes> copy(bytes);
+    size_t total = 0;
+    for (const std::string& key : std_set) total += key.size();
+    EXPECT_EQ(copy.reduce("", "~"), total);
+    EXPECT_EQ(bytes.reduce("", "~"), total);
+}
+
+TEST(TestSmallSet, SwitchesRepresentation) {
+    typedef my_stl::Set<std::string, my_rbt::stats::CountingStats,
+                        my_rbt::augment::None, 8>
+        SmallSet;
+    SmallSet s;
+    std::set<std::string> std_set;
+    unsigned state = 2024;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1103515245u + 12345u;
+        // Sizes wander across the inline capacity and the shrink threshold.
+        unsigned spread = i % 2000 < 1000 ? 6 : 24;
+        std::string key = std::to_string((state >> 8) % spread);
+        if (state % 2 == 0) {
+            EXPECT_EQ(s.insert(key).second, std_set.insert(key).second);
+        } else {
+            EXPECT_EQ(s.erase(key), std_set.erase(key));
+        }
+        ASSERT_EQ(s.size(), std_set.size());
+    }
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), std_set.begin(), std_set.end()));
+
+    s.clear();
+    s.reset_stats();
+    for (int i = 7; i >= 0; --i) s.insert(std::to_string(i));
+    EXPECT_EQ(s.stats().allocations_, 0);
+    EXPECT_EQ(*s.begin(), "0");
+    EXPECT_EQ(*--s.end(), "7");
+    EXPECT_EQ(*s.lower_bound("35"), "4");
+    EXPECT_EQ(std::ranges::distance(s.range("2", "5")), 3);
+    EXPECT_EQ(s.count_range("2", "5"), 3);
+    EXPECT_EQ(s.find("9"), s.end());
+
+    SmallSet copy(s);
+    s.insert("8");
+    EXPECT_EQ(s.stats().allocations_, 9);
+    EXPECT_EQ(s.shape().node_count_, 9);
+    EXPECT_EQ(copy.size(), 8);
+    EXPECT_EQ(copy.shape().node_count_, 0);
+
+    // Back inline at N / 2 keys; erase still hands out the next key.
+    for (int i = 0; i < 4; ++i) s.erase(std::to_string(i));
+    auto next = s.find("4");
+    s.erase(next);
+    EXPECT_EQ(s.shape().node_count_, 0);
+    EXPECT_EQ(*s.begin(), "5");
+    copy = s;
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), copy.begin(), copy.end()));
+
+    std::stringstream text;
+    text << copy;
+    s.read_text(text);
+    EXPECT_EQ(s.size(), 4);
+}
+
+TEST(TestFilteredSet, ShortCircuitsMisses) {
+    typedef my_stl::Set<int, my_rbt::stats::CountingStats,
+                        my_rbt::augment::None, 0,
+                        my_stl::filter::BlockedBloom<int>>
+        FilteredSet;
+    FilteredSet s;
+    std::set<int> std_set;
+    unsigned state = 39;
+    for (int i = 0; i < 50000; ++i) {
+        state = state * 1103515245u + 12345u;
+        int key = static_cast<int>((state >> 8) % 4096);
+        // Erase-heavy phases let stale bits pile up between rebuilds.
+        if (state % 3 != 0 || i % 10000 < 2000) {
+            EXPECT_EQ(s.erase(key), std_set.erase(key));
+        } else {
+            EXPECT_EQ(s.insert(key).second, std_set.insert(key).second);
+        }
+        ASSERT_EQ(s.contains(key), std_set.count(key) == 1);
+    }
+    for (int key = 0; key < 4096; ++key) {
+        ASSERT_EQ(s.contains(key), std_set.count(key) == 1) << key;
+    }
+
+    s.clear();
+    for (int i = 0; i < 10000; ++i) s.insert(2 * i);
+    s.reset_stats();
+    int misses = 0;
+    for (int i = 0; i < 10000; ++i) {
+        misses += s.find(2 * i + 1) == s.end();
+    }
+    EXPECT_EQ(misses, 10000);
+    EXPECT_LT(s.stats().searches_, 100);
+
+    FilteredSet copy(s);
+    s.clear();
+    EXPECT_FALSE(s.contains(0));
+    EXPECT_TRUE(copy.contains(19998));
+    std::stringstream buffer;
+    copy.save(buffer);
+    s.load(buffer);
+    EXPECT_TRUE(s.contains(19998));
+    EXPECT_EQ(s.find(19999), s.end());
+}
+
+TEST(TestFingerSearch, MatchesRootSearch) {
+    my_stl::Set<int, my_rbt::stats::CountingStats> s;
+    std::vector<int> keys;
+    for (int i = 0; i < 4000; ++i) {
+        s.insert(3 * i);
+        keys.push_back(3 * i);
+    }
+    unsigned state = 40;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1103515245u + 12345u;
+        auto finger = s.find(keys[(state >> 8) % keys.size()]);
+        if (i % 7 == 0) finger = s.end();
+        int key = static_cast<int>((state >> 4) % 12100) - 50;
+        ASSERT_EQ(s.lower_bound(finger, key), s.lower_bound(key)) << key;
+        ASSERT_EQ(s.find(finger, key), s.find(key)) << key;
+    }
+
+    // A merge-join walk: each step is a short hop from the previous one.
+    s.reset_stats();
+    auto it = s.begin();
+    for (int key = 0; key < 12000; key += 2) {
+        it = s.lower_bound(it, key);
+    }
+    my_rbt::stats::Counters counters = s.stats();
+    EXPECT_EQ(counters.searches_, 6000);
+    EXPECT_LT(counters.search_path_total_, 6000 * 4);
+}
+
+TEST(TestFingerSearch, CachedFinger) {
+    typedef my_stl::Set<int, my_rbt::stats::NullStats, my_rbt::augment::None,
+                        8, my_stl::filter::None, true>
+        FingerSet;
+    static_assert(sizeof(FingerSet) > sizeof(my_stl::Set<int>));
+    FingerSet s;
+    std::set<int> std_set;
+    unsigned state = 41;
+    int cursor = 0;
+    for (int i = 0; i < 30000; ++i) {
+        state = state * 1103515245u + 12345u;
+        cursor = (cursor + static_cast<int>((state >> 8) % 9) - 3) & 255;
+        int key = i % 3000 < 1500 ? cursor % 12 : cursor;
+        switch (state % 4) {
+            case 0:
+                s.insert(key);
+                std_set.insert(key);
+                break;
+            case 1:
+                s.erase(key);
+                std_set.erase(key);
+                break;
+            case 2: {
+                auto it = s.lower_bound(key);
+                auto expected = std_set.lower_bound(key);
+                ASSERT_EQ(it == s.end(), expected == std_set.end());
+                if (expected != std_set.end()) {
+                    ASSERT_EQ(*it, *expected);
+                }
+                break;
+            }
+            default:
+                ASSERT_EQ(s.contains(key), std_set.count(key) == 1);
+        }
+    }
+    FingerSet copy(s);
+    EXPECT_TRUE(std::equal(copy.begin(), copy.end(), std_set.begin(),
+                           std_set.end()));
+}
+
+namespace {
+// Applies batches of ops to set and, one by one, to a std::set, and checks
+// that the per-op results and the contents agree.
+template <class SetType>
+void CheckBatches(SetType& set, std::size_t initial, std::size_t batch) {
+    std::set<int> std_set;
+    for (std::size_t i = 0; i < initial; ++i) {
+        set.insert(static_cast<int>(i * 4));
+        std_set.insert(static_cast<int>(i * 4));
+    }
+    unsigned state = 99;
+    for (int round = 0; round < 4; ++round) {
+        std::vector<my_stl::BatchOp<int>> ops;
+        std::vector<bool> expected;
+        for (std::size_t i = 0; i < batch; ++i) {
+            state = state * 1103515245u + 12345u;
+            int key = static_cast<int>((state >> 8) % (initial * 4 + 40));
+            bool insert = state % 3 != 0;
+            ops.push_back({key, insert});
+            expected.push_back(insert ? std_set.insert(key).second
+                                      : std_set.erase(key) == 1);
+        }
+        ASSERT_EQ(set.apply_batch(ops), expected);
+        ASSERT_EQ(set.size(), std_set.size());
+        ASSERT_TRUE(std::equal(set.begin(), set.end(), std_set.begin(),
+                               std_set.end()));
+    }
+    for (int key : {1, 2, 3, 4}) {
+        ASSERT_EQ(set.contains(key), std_set.count(key) == 1);
+    }
+}
+}  // namespace
+
+TEST(TestBatchSet, MatchesOneByOne) {
+    // Batches up to four times the set take finger descents, the rest a
+    // merge and rebuild.
+    for (std::size_t batch : {10, 5000, 30000}) {
+        my_stl::Set<int> plain;
+        CheckBatches(plain, 5000, batch);
+        my_stl::Set<int, my_rbt::stats::NullStats, my_rbt::augment::None, 0,
+                    my_stl::filter::BlockedBloom<int>>
+            filtered;
+        CheckBatches(filtered, 5000, batch);
+    }
+    typedef my_stl::Set<int, my_rbt::stats::NullStats, my_rbt::augment::None,
+                        8>
+        SmallSet;
+    SmallSet large;
+    CheckBatches(large, 200, 6);
+    SmallSet small;
+    CheckBatches(small, 3, 40);
+
+    my_stl::Set<int> empty;
+    EXPECT_TRUE(empty.apply_batch({}).empty());
+    std::vector<my_stl::BatchOp<int>> same = {
+        {7, true}, {7, true}, {7, false}, {7, false}, {7, true}};
+    EXPECT_EQ(empty.apply_batch(same),
+              std::vector<bool>({true, false, true, false, true}));
+    EXPECT_EQ(empty.size(), 1);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "sharded_set.h"
+
+TEST(TestShardedSet, MatchesStdSet) {
+    my_stl::ShardedSet<int> s(8);
+    std::set<int> std_set;
+    unsigned state = 5;
+    for (int i = 0; i < 120000; ++i) {
+        state = state * 1103515245u + 12345u;
+        int key = static_cast<int>((state >> 8) % 100000);
+        if (state % 10 < 8) {
+            ASSERT_EQ(s.insert(key), std_set.insert(key).second);
+        } else {
+            ASSERT_EQ(s.erase(key), std_set.erase(key));
+        }
+    }
+    size_t peak = s.shard_count();
+    EXPECT_GE(peak, 4);
+    // Emptying most of the key range merges the shards that held it.
+    for (int key = 0; key < 80000; ++key) {
+        ASSERT_EQ(s.erase(key), std_set.erase(key));
+    }
+    EXPECT_LT(s.shard_count(), peak);
+    EXPECT_EQ(s.size(), std_set.size());
+    EXPECT_TRUE(std::equal(s.begin(), s.end(), std_set.begin(),
+                           std_set.end()));
+    for (int key = 0; key < 100000; key += 997) {
+        EXPECT_EQ(s.contains(key), std_set.count(key) == 1);
+        auto it = s.lower_bound(key);
+        auto expected = std_set.lower_bound(key);
+        ASSERT_EQ(it == s.end(), expected == std_set.end());
+        if (expected != std_set.end()) {
+            EXPECT_EQ(*it, *expected);
+        }
+        EXPECT_EQ(s.find(key) != s.end(), s.contains(key));
+    }
+
+    my_stl::ShardedSet<int> copy(s);
+    std::vector<int> keys;
+    copy.for_each([&keys](int key) { keys.push_back(key); });
+    EXPECT_TRUE(std::equal(keys.begin(), keys.end(), std_set.begin(),
+                           std_set.end()));
+    s.clear();
+    EXPECT_TRUE(s.empty());
+    EXPECT_EQ(s.begin(), s.end());
+}
+
+TEST(TestShardedSet, ConcurrentWriters) {
+    my_stl::ShardedSet<int> s(4);
+    const int kThreads = 4;
+    const int kPerThread = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&s, t] {
+            // Interleaved ranges, so threads share shards and splits.
+            for (int i = 0; i < kPerThread; ++i) s.insert(i * kThreads + t);
+            for (int i = 0; i < kPerThread; i += 2) {
+                s.erase(i * kThreads + t);
+            }
+            for (int i = 1; i < kPerThread; i += 2) {
+                EXPECT_TRUE(s.contains(i * kThreads + t));
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    EXPECT_EQ(s.size(), kThreads * kPerThread / 2);
+    EXPECT_GT(s.shard_count(), 1);
+    int previous = -1;
+    size_t count = 0;
+    for (int key : s) {
+        EXPECT_LT(previous, key);
+        EXPECT_EQ(key / kThreads % 2, 1);
+        previous = key;
+        ++count;
+    }
+    EXPECT_EQ(count, s.size());
+}
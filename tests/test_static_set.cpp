@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <string_view>
+
+#include "static_set.h"
+
+namespace {
+constexpr my_stl::StaticSet<std::string_view, 8> kReserved{
+    {"while", "if", "else", "for", "return", "if", "do", "else"}};
+
+constexpr my_stl::StaticSet<int, 10> kPrimes{
+    {29, 2, 23, 3, 19, 5, 17, 7, 13, 11}};
+
+static_assert(kReserved.size() == 6);
+static_assert(kReserved.contains("return"));
+static_assert(!kReserved.contains("goto"));
+static_assert(*kReserved.begin() == "do");
+static_assert(*kReserved.lower_bound("f") == "for");
+static_assert(kReserved.upper_bound("while") == kReserved.end());
+static_assert(kPrimes.find(4) == kPrimes.end());
+static_assert(*kPrimes.find(13) == 13);
+}  // namespace
+
+TEST(TestStaticSet, MatchesStdSet) {
+    const int input[] = {14, 3, 77, 3, 50, 91, 8, 14, 60, 1, 42, 77, 0};
+    my_stl::StaticSet<int, std::size(input)> set(input);
+    std::set<int> std_set(std::begin(input), std::end(input));
+    EXPECT_EQ(set.size(), std_set.size());
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), std_set.begin(),
+                           std_set.end()));
+    for (int key = -2; key < 100; ++key) {
+        EXPECT_EQ(set.contains(key), std_set.count(key) == 1);
+        auto it = set.lower_bound(key);
+        auto expected = std_set.lower_bound(key);
+        ASSERT_EQ(it == set.end(), expected == std_set.end());
+        if (expected != std_set.end()) {
+            EXPECT_EQ(*it, *expected);
+        }
+    }
+    auto last = set.end();
+    EXPECT_EQ(*--last, 91);
+
+    std::array<std::string_view, 8> words{};
+    std::copy(kReserved.begin(), kReserved.end(), words.begin());
+    EXPECT_TRUE(std::is_sorted(words.begin(), words.begin() + 6));
+    EXPECT_FALSE(kReserved.empty());
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "my_set.h"
+#include "set_trace.h"
+#include "traced_set.h"
+
+TEST(TestTraceHistogram, Buckets) {
+    using my_stl::trace::Histogram;
+    for (std::uint64_t v : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 17ull,
+                            1000ull, 123456789ull, ~0ull}) {
+        std::size_t b = Histogram::BucketOf(v);
+        ASSERT_LT(b, Histogram::kBucketCount);
+        EXPECT_LE(Histogram::BucketFloor(b), v);
+        if (b + 1 < Histogram::kBucketCount) {
+            EXPECT_GT(Histogram::BucketFloor(b + 1), v);
+        }
+    }
+
+    Histogram h;
+    EXPECT_EQ(h.Percentile(0.5), 0);
+    for (std::uint64_t v = 1; v <= 1000; ++v) h.Record(v);
+    EXPECT_EQ(h.Count(), 1000);
+    EXPECT_EQ(h.Sum(), 500500);
+    EXPECT_EQ(h.Max(), 1000);
+    EXPECT_NEAR(h.Percentile(0.5), 500, 500 / 8);
+    EXPECT_NEAR(h.Percentile(0.99), 990, 990 / 8);
+    EXPECT_EQ(h.Percentile(1.0), 1000);
+}
+
+TEST(TestTracedSet, RecordsOperations) {
+    my_stl::trace::Recorder recorder(2, 16);
+    my_stl::TracedSet<int> s(&recorder);
+    for (int i = 0; i < 10; ++i) s.insert(i);
+    EXPECT_NE(s.find(3), s.end());
+    EXPECT_EQ(s.lower_bound(20), s.end());
+    EXPECT_EQ(s.erase(3), 1);
+    my_stl::TracedSet<int> copy(s);
+    copy.clear();
+
+    using my_stl::trace::Op;
+    EXPECT_EQ(recorder.Latency(Op::kInsert).Count(), 10);
+    EXPECT_EQ(recorder.Latency(Op::kFind).Count(), 1);
+    EXPECT_EQ(recorder.Latency(Op::kLowerBound).Count(), 1);
+    EXPECT_EQ(recorder.Latency(Op::kErase).Count(), 1);
+    EXPECT_EQ(recorder.Latency(Op::kCopy).Count(), 1);
+    EXPECT_EQ(recorder.Latency(Op::kClear).Count(), 1);
+    EXPECT_EQ(recorder.EventCount(), 8);
+    EXPECT_EQ(s.size(), 9);
+    EXPECT_EQ(copy.recorder(), &recorder);
+
+    std::stringstream json;
+    recorder.WriteJson(json);
+    EXPECT_NE(json.str().find("\"insert\": {\"count\": 10"),
+              std::string::npos);
+    std::stringstream chrome;
+    recorder.WriteChromeTrace(chrome);
+    EXPECT_NE(chrome.str().find("\"ph\": \"X\""), std::string::npos);
+
+    recorder.Reset();
+    s.set_recorder(nullptr);
+    s.insert(100);
+    EXPECT_EQ(recorder.Latency(Op::kInsert).Count(), 0);
+    EXPECT_EQ(recorder.EventCount(), 0);
+
+    EXPECT_EQ(my_stl::TracedSet<int>().recorder(),
+              &my_stl::trace::Recorder::Global());
+    static_assert(sizeof(my_stl::TracedSet<int>) ==
+                  sizeof(my_stl::Set<int>) + sizeof(void*));
+}